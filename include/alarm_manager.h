@@ -0,0 +1,97 @@
+#ifndef ALARM_MANAGER_H
+#define ALARM_MANAGER_H
+
+#include <stdint.h>
+#include "chambers.h"
+
+/*
+ * The buzzer and what makes it sound. Each source raises its alarm for the
+ * chambers it concerns; the most urgent one not acknowledged or snoozed
+ * plays its own pattern, generated by the LEDC peripheral: the CPU only
+ * reprograms it when the sounding alarm changes, and the pattern goes on
+ * through light sleep.
+ *
+ * Owned by the control task, except alarmDump().
+ */
+
+/** Alarm sources, most urgent first. */
+enum AlarmSource : uint8_t
+{
+  ALARM_OVER_TEMP,        // a reading well above the target
+  ALARM_SENSOR_LOST,      // no reading within the sensor timeout, the failsafe drives the heater
+  ALARM_HUMIDIFIER_STUCK, // on for long without reaching the target: tank empty or humidifier stuck
+  ALARM_TURN,             // the primary chamber's eggs are due to be turned
+  ALARM_SOURCE_COUNT,
+  ALARM_NONE = ALARM_SOURCE_COUNT
+};
+
+enum AlarmEventKind : uint8_t
+{
+  ALARM_RAISED,
+  ALARM_CLEARED,
+  ALARM_ACKNOWLEDGED,
+  ALARM_SNOOZED
+};
+
+/** An entry of the event log. */
+struct AlarmEvent
+{
+  uint32_t time;       // unix timestamp, 0 if the clock was unknown
+  uint8_t source;      // AlarmSource
+  uint8_t kind;        // AlarmEventKind
+  ChamberMask chambers; // concerned by the event
+};
+
+/** Drives the buzzer on `pin`, silent until an alarm is raised. */
+void alarmBegin(uint8_t pin);
+
+/**
+ * @brief Sets the chambers whose condition for `source` currently holds.
+ *
+ * @details A chamber raises the alarm as soon as it appears. It clears it
+ * once gone for ALARM_CLEAR_DELAY, so a flapping condition neither
+ * restarts the pattern nor floods the log. Takes effect on alarmStep().
+ */
+void alarmSet(AlarmSource source, ChamberMask chambers);
+
+/**
+ * @brief Applies the conditions set since the last step: logs raises and
+ * clears, ends snoozes that ran out and reprograms the buzzer if another
+ * alarm is to sound.
+ *
+ * @param unixTime Stamped on the events, 0 if unknown.
+ */
+void alarmStep(unsigned long now, uint32_t unixTime);
+
+/**
+ * @brief Tells when alarmStep() next has something to do without a new
+ * condition: a snooze or a clear running out.
+ *
+ * @return false if only a new condition can change anything.
+ */
+bool alarmNextStep(unsigned long &at);
+
+/** @return The alarm the buzzer plays, ALARM_NONE when silent. */
+AlarmSource alarmSounding();
+
+/**
+ * Silences `source` for the chambers it is raised for; a chamber raising
+ * it again after it cleared sounds again.
+ */
+void alarmAcknowledge(AlarmSource source);
+
+/** Silences `source` for `ms`, without acknowledging it. */
+void alarmSnooze(AlarmSource source, unsigned long ms);
+
+/** @return Short name of `source`, for the log and telemetry. */
+const char *alarmName(AlarmSource source);
+
+/**
+ * @brief Prints the event log, oldest first, and the alarms raised now.
+ *
+ * @details Meant for the console: entries are read while the control task
+ * may add more, so the oldest one can be overwritten mid-dump.
+ */
+void alarmDump();
+
+#endif
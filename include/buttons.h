@@ -0,0 +1,51 @@
+#ifndef BUTTONS_H
+#define BUTTONS_H
+
+#include <stdint.h>
+
+enum ButtonId : uint8_t
+{
+  BUTTON_RESET, // turn acknowledge, cycle start
+  BUTTON_PAUSE, // humidifier pause/hold
+  BUTTON_COUNT
+};
+
+enum ButtonGesture : uint8_t
+{
+  BUTTON_CLICK,  // one short press, reported once no second press followed
+  BUTTON_DOUBLE, // two short presses in quick succession
+  BUTTON_LONG    // held down, reported while still held
+};
+
+struct ButtonEvent
+{
+  ButtonId button;
+  ButtonGesture gesture;
+};
+
+/**
+ * @brief Sets up both buttons (active LOW, internal pull-ups).
+ *
+ * @details Each edge only restarts a one-shot esp_timer from the GPIO
+ * interrupt; the level is sampled once it has been stable for the debounce
+ * time, and the gesture timers run on the same timer task. Nothing is
+ * polled, so a press is caught whatever the tasks are busy with.
+ *
+ * @param onChange Called from the timer task after every debounced press
+ * or release and every queued event, e.g. to wake the task reading them.
+ */
+void buttonsBegin(void (*onChange)());
+
+/** @brief Pops the oldest gesture. @return false if there is none. */
+bool buttonsPoll(ButtonEvent &event);
+
+/** @return Whether the button is held down, debounced. */
+bool buttonDown(ButtonId button);
+
+/**
+ * @brief Re-checks both levels, for edges whose interrupt was off, e.g.
+ * during light sleep.
+ */
+void buttonsResync();
+
+#endif
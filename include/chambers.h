@@ -0,0 +1,104 @@
+#ifndef CHAMBERS_H
+#define CHAMBERS_H
+
+#include <stdint.h>
+
+/** Most chambers one controller drives, each on its own sensor, heater and humidifier pin. */
+#ifndef MAX_CHAMBERS
+#define MAX_CHAMBERS 8
+#endif
+
+/** One bit per chamber, bit i for chamber i. */
+typedef uint8_t ChamberMask;
+static_assert(MAX_CHAMBERS <= 8 * sizeof(ChamberMask), "ChamberMask is too narrow for MAX_CHAMBERS");
+
+#define CHAMBER_BIT(i) ((ChamberMask)1 << (i))
+
+/** A pin left out of the configuration. */
+#define NO_PIN ((uint8_t)0xFF)
+
+struct ChamberPins
+{
+  uint8_t sensor;     // DHT22 data line, NO_PIN for a sensor on the I2C bus
+  uint8_t heater;     // relay
+  uint8_t humidifier; // MOSFET
+};
+
+/**
+ * Control state of every chamber, one array per field: a sweep over the
+ * chambers walks each field contiguously, and the on/off states are bits
+ * of a mask. Chamber 0 is the primary one, which the LCD, the buttons, the
+ * turning alarm, the history and the PID belong to.
+ *
+ * Owned by the control task.
+ */
+struct Chambers
+{
+  uint8_t count;
+
+  // wiring
+  uint8_t sensorPin[MAX_CHAMBERS];
+  uint8_t heaterPin[MAX_CHAMBERS];
+  uint8_t humidifierPin[MAX_CHAMBERS];
+
+  // latest readings
+  float temp[MAX_CHAMBERS];           // C, NAN before the first reading
+  float humidity[MAX_CHAMBERS];       // %RH
+  unsigned long readAt[MAX_CHAMBERS]; // millis() of the last good reading, 0 if none
+
+  // failsafe, see chambersSweep()
+  float estimate[MAX_CHAMBERS];            // C
+  unsigned long estimatedAt[MAX_CHAMBERS]; // in ms
+
+  // setpoints of the current phase
+  float tempTarget[MAX_CHAMBERS];
+  float tempHyst[MAX_CHAMBERS];
+  float humidityTarget[MAX_CHAMBERS];
+  float humidityHyst[MAX_CHAMBERS];
+
+  // cycle
+  uint32_t incubationStart[MAX_CHAMBERS]; // unix timestamp, 0 when idle
+  uint8_t day[MAX_CHAMBERS];              // 0 until known
+  uint8_t profile[MAX_CHAMBERS];          // ProfileId, see profiles.h
+
+  ChamberMask running;        // regulated by the sweep
+  ChamberMask heaterOn;
+  ChamberMask humidifierOn;   // humidity demand, also while held
+  ChamberMask humidifierHeld; // humidifier kept off (pause button)
+  ChamberMask sensorOk;       // a reading within the sensor timeout
+  ChamberMask modelled;       // failsafe estimate kept by the caller
+  ChamberMask externalHeater; // heater decided by the caller while the sensor is ok
+  ChamberMask heaterOut;      // pins as last written by chambersSweep()
+  ChamberMask humidifierOut;
+};
+
+extern Chambers chambers;
+
+/**
+ * @brief Adds a chamber, its pins set as outputs and driven low.
+ *
+ * @param reserved Pins taken by something else (buttons, bus, buzzer).
+ * @return Its index, or -1 if MAX_CHAMBERS are configured, its heater or
+ * humidifier pin is NO_PIN, or a pin is taken.
+ */
+int8_t chambersAdd(const ChamberPins &pins, const uint8_t *reserved, uint8_t reservedCount);
+
+/**
+ * @brief Regulates every running chamber in one pass.
+ *
+ * @details A chamber's sensor is ok while its last reading is younger than
+ * `sensorTimeout`. Then the heater follows the reading by hysteresis around
+ * the target, unless the chamber is in `externalHeater`, and so does the
+ * humidifier unless held. Without a reading the heater follows the failsafe
+ * estimate instead: the caller's for chambers in `modelled`, otherwise the
+ * last reading extrapolated at `gainPerSecond` while heating and
+ * `lossPerSecond` while not. The humidifier is then left as it was.
+ *
+ * Pins are only written for the chambers whose output changed, heater bits
+ * set by the caller included.
+ *
+ * @return The chambers whose heater switched.
+ */
+ChamberMask chambersSweep(unsigned long now, unsigned long sensorTimeout, float gainPerSecond, float lossPerSecond);
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <stdint.h>
+#include <atomic>
+
+/*
+ * Lock-free primitives for passing data between the control and service
+ * tasks (see tasks.h). Neither blocks nor disables interrupts, so the
+ * control task can never be held up by the other core.
+ */
+
+/**
+ * Bounded queue for exactly one producer task and one consumer task.
+ * N must be a power of two.
+ */
+template <typename T, uint16_t N>
+class SpscQueue
+{
+  static_assert(N && (N & (N - 1)) == 0, "queue size must be a power of two");
+
+public:
+  /** Producer side. @return false, dropping the item, if the queue is full. */
+  bool push(const T &item)
+  {
+    uint16_t h = head.load(std::memory_order_relaxed);
+    if ((uint16_t)(h - tail.load(std::memory_order_acquire)) == N)
+      return false;
+    items[h % N] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** Consumer side. @return false if the queue is empty. */
+  bool pop(T &item)
+  {
+    uint16_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire))
+      return false;
+    item = items[t % N];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  T items[N];
+  std::atomic<uint16_t> head{0};
+  std::atomic<uint16_t> tail{0};
+};
+
+/**
+ * Latest value of a state struct, written by one task and read by any.
+ *
+ * The writer fills the inactive buffer and flips; a reader copies the
+ * active one and retries if a publish started meanwhile, which is rare as
+ * it needs the writer to publish twice during one copy.
+ */
+template <typename T>
+class Snapshot
+{
+public:
+  /** Writer side. */
+  void publish(const T &value)
+  {
+    uint8_t next = !active.load(std::memory_order_relaxed);
+    sequence.fetch_add(1);
+    buffers[next] = value;
+    active.store(next);
+    sequence.fetch_add(1);
+  }
+
+  /**
+   * Copies the latest published value into `out`.
+   * @return A number that changes with every publish.
+   */
+  uint32_t read(T &out) const
+  {
+    uint32_t before, after;
+    do
+    {
+      before = sequence.load();
+      out = buffers[active.load()];
+      after = sequence.load();
+    } while (before != after);
+    return after;
+  }
+
+private:
+  T buffers[2] = {};
+  std::atomic<uint8_t> active{0};
+  std::atomic<uint32_t> sequence{0};
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <stdint.h>
+#include "chambers.h"
+#include "heater_control.h"
+#include "sample_filter.h"
+#include "turner.h"
+
+/*
+ * config.json, parsed once. The settings are kept on LittleFS as a binary
+ * image of Config (/config.bin) tagged with a hash of the JSON they came
+ * from: while the hash matches, a boot reads the image straight into
+ * Config instead of parsing the JSON. Editing config.json, or uploading a
+ * new file system image, changes the hash, and the next boot parses it
+ * again and rewrites the image.
+ *
+ * The image holds the structure as laid out by the compiler, and the
+ * defaults of pins.h, profiles and filters filled in, so it is only good
+ * for the firmware that wrote it: it is tagged with a hash of the build
+ * (FIRMWARE_BUILD), and a new firmware parses config.json again on its
+ * first boot. CONFIG_VERSION and the size guard a build that keeps an
+ * older identifier.
+ */
+
+/** Bump whenever Config or ChamberConfig change. */
+#define CONFIG_VERSION 3
+
+struct ChamberConfig
+{
+  uint8_t sensor;           // SensorType, SENSOR_TYPE_COUNT if the name is unknown
+  uint8_t sensorAddress;    // on the I2C bus, 0 for a DHT22
+  ChamberPins pins;         // NO_PIN where left out, the primary's default to pins.h
+  uint8_t profile;          // ProfileId, PROFILE_COUNT if the name is unknown
+  uint32_t incubationStart; // unix timestamp, 0 to keep the chamber idle
+  uint16_t heaterWatts;     // for the energy of the day's figures, 0 if unknown
+  uint16_t humidifierWatts;
+};
+
+/** Everything config.json sets, with the defaults of the keys left out filled in. */
+struct Config
+{
+  // seeds, the state journal keeps the runtime values
+  uint32_t incubationStart;
+  uint32_t lastTurn;
+
+  // targets, on top of each chamber's profile (see profiles.h)
+  float tempOffset;     // C
+  float tempHyst;       // C, NAN for the profile's
+  float humidityOffset; // %RH
+  float humidityHyst;   // %RH, NAN for the profile's
+  uint8_t turnsPerDay;  // 0 for the primary chamber's profile's
+  TurnerConfig turner;  // motor of the primary chamber's tray, TURNER_NONE to turn by hand
+
+  uint8_t heaterMode; // HeaterMode
+  PidConfig pid;
+  float tempLossPerSecond; // failsafe rates until the thermal model has learned
+  float tempGainPerSecond;
+  FilterConfig filter;
+
+  bool telemetry;
+  uint16_t telemetryPort;
+
+  uint8_t chamberCount; // listed in config.json, at least 1 and at most MAX_CHAMBERS
+  ChamberConfig chambers[MAX_CHAMBERS];
+};
+
+enum ConfigLoad
+{
+  CONFIG_MISSING, // config.json could not be read or parsed
+  CONFIG_PARSED,  // from config.json, image rewritten
+  CONFIG_CACHED   // from the image
+};
+
+/**
+ * @brief Loads the configuration, from the image if it was made from the
+ * current config.json, otherwise by parsing it and rewriting the image.
+ *
+ * @details Only hashes config.json on the cached path; a damaged or stale
+ * image is simply rebuilt. Meant for setup(), before the tasks start.
+ */
+ConfigLoad configLoad(Config &config);
+
+#endif
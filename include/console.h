@@ -0,0 +1,20 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+/**
+ * @brief Reads serial commands, one per line, without blocking.
+ *
+ * @details Meant to be called on every service step. Known commands:
+ * - `probes`: dumps the latency probes (see probes.h)
+ * - `probes reset`: clears them
+ * - `tasks`: prints the task report now
+ * - `sensors`: failed conversions and rejected readings of each sensor
+ * - `alarms`: the alarm event log (see alarm_manager.h)
+ * - `wifi`: connection latency of each path and radio time (see wifi_manager.h)
+ * - `turner`: the egg turner's motor, tray side, motions and failures (see turner.h)
+ * - `days`: the stored daily figures, then each chamber's day so far (see day_stats.h)
+ * - `help`: lists the commands
+ */
+void consolePoll();
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef DAY_STATS_H
+#define DAY_STATS_H
+
+#include <stdint.h>
+#include "chambers.h"
+
+/*
+ * What each chamber's day cost and how well it held its band: heater and
+ * humidifier on-time and switches, the temperature and humidity range and
+ * mean, and the time the readings spent outside target ± hysteresis.
+ *
+ * Every figure is a running sum, count or extreme, so a chamber takes the
+ * same few bytes however long its day and however often it switches. An
+ * interval is added when it ends: at an actuator transition, a reading
+ * that crosses the band, a rollover or a checkpoint, never per control
+ * step.
+ *
+ * Updated by the control task. Each closed day is queued to the service
+ * task and appended to /days.bin (the previous file kept as /days.prev);
+ * the day in progress is checkpointed to /today.bin every hour, and picked
+ * up again after a reboot on the same day. The service task reads the
+ * figures through a snapshot.
+ */
+
+/** One chamber's day, as stored in /days.bin and /today.bin. */
+struct DayStats
+{
+  uint8_t magic;             // DAY_STATS_MAGIC, anything else is no record
+  uint8_t chamber;
+  uint8_t day;               // incubation day, 0 while idle (never stored)
+  uint8_t reserved;
+  uint32_t start;            // unix timestamp of the rollover, 0 if the clock was unknown
+  uint32_t trackedMs;        // time accounted, the whole day unless the device was off
+  uint32_t heaterOnMs;
+  uint32_t humidifierOnMs;
+  uint32_t tempOutMs;        // last reading outside the temperature band
+  uint32_t humidityOutMs;    // likewise for humidity
+  uint16_t heaterSwitches;   // on and off each count
+  uint16_t humidifierSwitches;
+  int16_t tempMin;           // 0.1 C, INT16_MAX before the first reading
+  int16_t tempMax;           // 0.1 C, INT16_MIN before the first reading
+  int16_t humidityMin;       // 0.1 %RH, likewise
+  int16_t humidityMax;
+  int32_t tempSum;           // 0.1 C, over `readings`
+  int32_t humiditySum;       // 0.1 %RH
+  uint32_t readings;
+};
+
+#define DAY_STATS_MAGIC 0xD5
+
+/**
+ * Receives the days streamed by dayStatsRead().
+ * @return false to stop the stream early.
+ */
+typedef bool (*DayStatsCallback)(const DayStats &stats, void *context);
+
+/**
+ * @brief Starts `count` chambers on day 0, or on the day checkpointed in
+ * /today.bin: a reboot carries on with the day's figures so far, without
+ * the time the device was off.
+ */
+void dayStatsBegin(uint8_t count);
+
+/** Sets a chamber's heater and humidifier power, 0 if unknown, for the energy figures. */
+void dayStatsPower(uint8_t chamber, uint16_t heaterWatts, uint16_t humidifierWatts);
+
+/**
+ * @brief Follows the actuators of every chamber.
+ *
+ * @details Cheap to call on every control step: only a chamber whose
+ * heater or humidifier changed is brought up to date.
+ */
+void dayStatsActuators(unsigned long now, ChamberMask heater, ChamberMask humidifier);
+
+/**
+ * @brief Adds a chamber's accepted reading, outside its temperature or
+ * humidity band or not.
+ */
+void dayStatsReading(uint8_t chamber, unsigned long now, float temp, float humidity, bool tempOut, bool humidityOut);
+
+/**
+ * @brief Closes the chamber's day and starts `day`, if it is another.
+ *
+ * @details A closed day other than 0 is printed and queued for
+ * dayStatsMaintain(). The actuators and the band carry over.
+ *
+ * @param unixTime Start of the new day, 0 if unknown.
+ */
+void dayStatsRollover(uint8_t chamber, unsigned long now, uint32_t unixTime, uint8_t day);
+
+/** @brief Queues every chamber's day in progress for /today.bin. */
+void dayStatsCheckpoint(unsigned long now);
+
+/** @brief Publishes the figures for the other tasks, if they changed since the last call. */
+void dayStatsPublish();
+
+/**
+ * @brief Stores the days queued by the control task, for the service task.
+ *
+ * @details Closed days are appended to /days.bin, moved to /days.prev
+ * beyond about 16 KB; the latest checkpoints replace /today.bin through
+ * /today.tmp and a rename.
+ */
+void dayStatsMaintain();
+
+/**
+ * @return The chamber's day as last published, brought up to `now`, for
+ * the service task.
+ */
+DayStats dayStatsToday(uint8_t chamber, unsigned long now);
+
+/**
+ * @brief Streams the stored days, oldest first, one record at a time.
+ *
+ * @return The number of days passed to `callback`.
+ */
+uint32_t dayStatsRead(DayStatsCallback callback, void *context);
+
+/**
+ * @brief Prints one day, e.g. "⚡ Chamber 0 day 5: heater 34.2% (8.21 h,
+ * 412 switches, 328 Wh), ...".
+ */
+void dayStatsPrint(const DayStats &stats);
+
+/** @brief Prints the stored days, then each chamber's day so far. */
+void dayStatsReport();
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef DEADLINES_H
+#define DEADLINES_H
+
+#include <stdint.h>
+
+/**
+ * Pending deadlines of one task, as a binary min-heap keyed by millis().
+ *
+ * Each of the N timer ids is either pending with one due time or absent.
+ * set() arms or moves a timer, expire() drops every timer that is due, and
+ * untilNext() tells how long the task may sleep. Comparisons use the
+ * signed difference to `now`, so millis() wrapping is harmless as long as
+ * no deadline is more than 24 days out.
+ */
+template <uint8_t N>
+class Deadlines
+{
+public:
+  Deadlines()
+  {
+    for (uint8_t id = 0; id < N; id++)
+      slot[id] = ABSENT;
+  }
+
+  /** Arms timer `id` for millis() == `due`, replacing its previous due time. */
+  void set(uint8_t id, unsigned long due)
+  {
+    if (slot[id] == ABSENT)
+    {
+      slot[id] = count;
+      heap[count++] = {due, id};
+    }
+    else
+      heap[slot[id]].due = due;
+    siftUp(slot[id]);
+    siftDown(slot[id]);
+  }
+
+  void cancel(uint8_t id)
+  {
+    uint8_t index = slot[id];
+    if (index == ABSENT)
+      return;
+    slot[id] = ABSENT;
+    if (index == --count)
+      return;
+    place(index, heap[count]);
+    siftUp(index);
+    siftDown(index);
+  }
+
+  bool pending(uint8_t id) const { return slot[id] != ABSENT; }
+
+  /** Drops every timer due at `now`; the step that just ran has handled them. */
+  void expire(unsigned long now)
+  {
+    while (count && (long)(now - heap[0].due) >= 0)
+      cancel(heap[0].id);
+  }
+
+  /** @return ms from `now` to the earliest deadline, 0 if due, `idle` if none. */
+  unsigned long untilNext(unsigned long now, unsigned long idle) const
+  {
+    if (!count)
+      return idle;
+    long left = (long)(heap[0].due - now);
+    return left > 0 ? (unsigned long)left : 0;
+  }
+
+private:
+  static const uint8_t ABSENT = 0xFF;
+
+  struct Entry
+  {
+    unsigned long due;
+    uint8_t id;
+  };
+
+  Entry heap[N];
+  uint8_t slot[N]; // heap index of each id
+  uint8_t count = 0;
+
+  static bool before(const Entry &a, const Entry &b) { return (long)(a.due - b.due) < 0; }
+
+  void place(uint8_t index, const Entry &entry)
+  {
+    heap[index] = entry;
+    slot[entry.id] = index;
+  }
+
+  void siftUp(uint8_t index)
+  {
+    Entry entry = heap[index];
+    while (index > 0 && before(entry, heap[(index - 1) / 2]))
+    {
+      place(index, heap[(index - 1) / 2]);
+      index = (index - 1) / 2;
+    }
+    place(index, entry);
+  }
+
+  void siftDown(uint8_t index)
+  {
+    Entry entry = heap[index];
+    for (;;)
+    {
+      uint8_t child = 2 * index + 1;
+      if (child >= count)
+        break;
+      if (child + 1 < count && before(heap[child + 1], heap[child]))
+        child++;
+      if (!before(heap[child], entry))
+        break;
+      place(index, heap[child]);
+      index = child;
+    }
+    place(index, entry);
+  }
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef DHT_READER_H
+#define DHT_READER_H
+
+#include <stdint.h>
+
+/** Outcome of a DHT22 conversion, as returned by dhtPoll() and dhtDecode(). */
+enum DhtStatus
+{
+  DHT_IDLE,      // no conversion in progress
+  DHT_PENDING,   // conversion started, frame not complete yet
+  DHT_OK,        // sample decoded
+  DHT_NO_REPLY,  // sensor did not answer the start pulse
+  DHT_BAD_FRAME, // pulse train could not be decoded
+  DHT_CHECKSUM   // frame decoded but the checksum does not match
+};
+
+struct DhtSample
+{
+  float temperature; // C
+  float humidity;    // %RH
+};
+
+/** Longest pulse train a DHT22 frame produces: response + 40 bits + tail. */
+#define DHT_MAX_PULSES 88
+
+/** Sensors on separate data lines, numbered from 0. */
+#define DHT_MAX_SENSORS 8
+
+/**
+ * @brief Prepares the data line of `sensor` (idle high through the pull-up).
+ */
+void dhtBegin(uint8_t sensor, uint8_t pin);
+
+/**
+ * @brief Starts a conversion without waiting for it.
+ *
+ * @details Pulls the data line low; a one-shot esp_timer releases it after
+ * the start pulse and arms a GPIO edge interrupt that timestamps the
+ * sensor's reply. The frame is decoded later by dhtPoll().
+ *
+ * Each sensor has its own line, timer and edge buffer, so conversions may
+ * overlap; staggering them keeps the interrupt latency, and so the edge
+ * timestamps, clean.
+ *
+ * @return false if a conversion is already in progress on `sensor`.
+ */
+bool dhtStart(uint8_t sensor);
+
+/**
+ * @brief Sets a function the edge interrupt calls once a whole frame has
+ * been captured, on any sensor, e.g. to wake the task that collects it.
+ */
+void dhtOnFrame(void (*callback)());
+
+/**
+ * @brief Collects the result of the conversion started by dhtStart().
+ *
+ * @details Meant to be called from the main loop. Returns DHT_PENDING until
+ * the whole frame is in or the reply window has passed, then decodes the
+ * captured edges once and returns the outcome; afterwards DHT_IDLE until
+ * the next dhtStart().
+ */
+DhtStatus dhtPoll(uint8_t sensor, DhtSample &out);
+
+/**
+ * @brief Decodes a DHT22 pulse train.
+ *
+ * @details `pulses` holds alternating LOW/HIGH durations in microseconds,
+ * starting with a LOW pulse. The sensor's 80/80 us response is located
+ * first, then the 40 data bits are read from the HIGH pulse widths (~26 us
+ * for 0, ~70 us for 1). Pure function, independent of the hardware.
+ */
+DhtStatus dhtDecode(const uint16_t *pulses, uint8_t count, DhtSample &out);
+
+/** Number of conversions that ended in anything but DHT_OK, all sensors. */
+unsigned long dhtErrorCount();
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef FNV1A_H
+#define FNV1A_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * FNV-1a, the check of the records kept across a reset or on flash (config
+ * image, retained clock, retained network). A record is hashed field by
+ * field, so its padding does not count.
+ */
+
+#define FNV1A_INIT 2166136261u
+
+/** @return `hash` carried on over `length` bytes at `data`, FNV1A_INIT to start. */
+inline uint32_t fnv1a(uint32_t hash, const void *data, size_t length)
+{
+  const uint8_t *bytes = (const uint8_t *)data;
+  while (length--)
+    hash = (hash ^ *bytes++) * 16777619u;
+  return hash;
+}
+
+#endif
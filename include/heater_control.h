@@ -0,0 +1,71 @@
+#ifndef HEATER_CONTROL_H
+#define HEATER_CONTROL_H
+
+#include <stdint.h>
+
+/** How the heater relay is driven while the sensor is healthy. */
+enum HeaterMode
+{
+  HEATER_HYSTERESIS, // on below target - hysteresis, off above target + hysteresis
+  HEATER_PID         // PID duty cycle, time-proportioned over a relay window
+};
+
+struct PidConfig
+{
+  float kp;                  // duty per C of error
+  float ki;                  // duty per C*s
+  float kd;                  // duty per C/s
+  uint16_t windowSeconds;    // relay period the duty is spread over
+  uint16_t minSwitchSeconds; // shortest on or off time the relay is given
+};
+
+/**
+ * @brief Sets up the PID controller.
+ *
+ * @details Gains of zero in `config` mean "not configured": the gains found
+ * by an earlier autotune are taken from the state journal, and if there are
+ * none, an autotune runs the first time the chamber reaches its target.
+ */
+void pidBegin(const PidConfig &config);
+
+/**
+ * @brief Decides whether the heater should be on.
+ *
+ * @details The PID output is recomputed whenever `sampleAt` moves on, i.e.
+ * once per sensor reading, and turned into an on-time at the start of each
+ * relay window: on for `duty * window`, then off, so the relay switches at
+ * most twice per window. On-times shorter than the minimum switch time are
+ * dropped, off-times shorter than it are filled in.
+ *
+ * During an autotune the relay instead toggles around the target
+ * (relay-feedback test): from the amplitude and period of the resulting
+ * oscillation the ultimate gain and period of the chamber are estimated and
+ * turned into PID gains, which are journaled.
+ *
+ * @param temp Latest temperature reading, in C.
+ * @param sampleAt millis() of that reading.
+ * @param target Temperature setpoint, in C.
+ * @param heaterOn Current relay state.
+ */
+bool pidHeaterDemand(float temp, unsigned long sampleAt, float target, bool heaterOn);
+
+/**
+ * @brief Tells when pidHeaterDemand() would next change its answer without
+ * a new sample: at the end of the on-time or of the relay window.
+ *
+ * @return false if only a new sample can change it (autotune, no window yet).
+ */
+bool pidNextSwitch(unsigned long &at);
+
+/**
+ * @brief Restarts the relay-feedback autotune, discarding current gains.
+ */
+void pidStartAutotune();
+
+/** @return true while an autotune is running or waiting to start. */
+bool pidAutotuning();
+
+/** @return The gains in use, all zero until known. */
+PidConfig pidConfig();
+
+#endif
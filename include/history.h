@@ -0,0 +1,100 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+
+#define HISTORY_SAMPLE 0    // temperature/humidity reading
+#define HISTORY_ACTUATORS 1 // heater/humidifier switched
+
+#define HISTORY_HEATER 0x01
+#define HISTORY_HUMIDIFIER 0x02
+
+/** One decoded history entry. */
+struct HistoryEntry
+{
+  uint32_t time;    // unix timestamp
+  uint8_t kind;     // HISTORY_SAMPLE or HISTORY_ACTUATORS
+  uint8_t state;    // HISTORY_HEATER | HISTORY_HUMIDIFIER, for HISTORY_ACTUATORS
+  int16_t temp;     // in 0.1 C, for HISTORY_SAMPLE
+  uint16_t humidity; // in 0.1 %RH, for HISTORY_SAMPLE
+};
+
+/**
+ * Receives entries streamed by historyRead().
+ * @return false to stop the stream early.
+ */
+typedef bool (*HistoryCallback)(const HistoryEntry &entry, void *context);
+
+/**
+ * @brief Prepares the history store.
+ *
+ * @details The history of a cycle is sized for about 92 KB on flash: while
+ * it runs ahead of that budget for the time the cycle has run, readings
+ * within a deadband of the recorded value (up to 0.3 C / 1.5 %RH) are
+ * recorded unchanged; while it does not, every reading is kept as is. The
+ * heater/humidifier switches are always recorded, so the budget only
+ * bounds the readings: in the simulation every profile ends at 92-96 KB
+ * except under `pid` with its default 120 s window, where the duck cycle
+ * takes 100 KB and the goose cycle 105 KB. A cycle that runs past its days
+ * keeps growing at its budget rate.
+ *
+ * @param intervalSeconds The usual gap between two samples; such gaps are
+ * encoded in a single bit.
+ * @param cycleDays The days the current cycle runs, which the budget is
+ * spread over.
+ */
+void historyBegin(uint8_t intervalSeconds, uint8_t cycleDays);
+
+/**
+ * @brief Records a sensor reading taken at unix time `time`.
+ *
+ * @details Meant for the control task: the entry is only queued, without
+ * blocking, and stored by historyMaintain(). Nothing is recorded while the
+ * time is unknown (`time` is 0). The reading is kept in steps of 0.1 C and
+ * 0.5 %RH, and a value within the current deadband of the last recorded one
+ * is recorded unchanged.
+ */
+void historyAddSample(uint32_t time, float temp, float humidity);
+
+/**
+ * @brief Records heater/humidifier transitions, like historyAddSample().
+ *
+ * @details Cheap to call on every control step: only a change from the last
+ * recorded state produces an entry.
+ */
+void historyTrackActuators(uint32_t time, bool heater, bool humidifier);
+
+/**
+ * @brief Starts a new history, keeping the previous one as /history.prev.
+ *
+ * @details Queued like the entries; those recorded before it still go into
+ * the previous history. The new history starts with every reading kept.
+ *
+ * @param cycleDays The days the new cycle runs, see historyBegin().
+ */
+void historyRotate(uint8_t cycleDays);
+
+/**
+ * @brief Stores the queued entries, for the service task.
+ *
+ * @details Entries collect in a fixed RAM ring buffer. Every 512 entries
+ * (about 75 minutes) the ring is delta-encoded into one block appended to
+ * /history.bin.
+ */
+void historyMaintain();
+
+/**
+ * @brief Streams every entry with `from <= time <= to`, oldest first.
+ *
+ * @details Blocks are read and decoded one at a time into a static buffer,
+ * and blocks outside the range are skipped without decoding, so the whole
+ * history never has to fit in memory. Entries still in RAM come last.
+ *
+ * @return The number of entries passed to `callback`.
+ */
+uint32_t historyRead(uint32_t from, uint32_t to, HistoryCallback callback, void *context);
+
+/** @return Size of the flushed history on flash, in bytes. */
+uint32_t historyBytes();
+
+#endif
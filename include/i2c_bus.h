@@ -0,0 +1,47 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The Wire bus shared by the LCD (service task) and the I2C sensors
+ * (control task).
+ *
+ * Every call below is one bus transaction, or a write and a read joined by
+ * a repeated start, taken under a mutex on the ESP32 so the two tasks never
+ * interleave bytes. Callers batch their bytes into as few transactions as
+ * possible and never hold the bus across a wait: the LCD sends a redraw in
+ * chunks of at most I2C_BUFFER_LENGTH bytes and the sensors release the bus
+ * while converting, so either side waits at most for one transaction of
+ * the other (about 11 ms for a full LCD chunk at the default 100 kHz, 3 ms
+ * at 400 kHz).
+ */
+
+struct I2cBusStats
+{
+  uint32_t transactions;
+  uint32_t failures;         // NACKed or timed out
+  uint32_t maxBusyMicros;    // longest single transaction, what the other task may wait
+  uint32_t maxWaitMicros;    // longest wait for the other task's transaction
+  uint64_t waitMicros;       // total time spent waiting for the bus
+};
+
+/** @brief Starts Wire on SDA_PIN/SCL_PIN and creates the bus mutex. */
+void i2cBusBegin();
+
+/** @return Whether the device at `address` acknowledged all `length` bytes. */
+bool i2cWrite(uint8_t address, const uint8_t *data, size_t length);
+
+/** @return Whether the device at `address` returned all `length` bytes. */
+bool i2cRead(uint8_t address, uint8_t *data, size_t length);
+
+/**
+ * @brief Writes `reg` (a register address or command) and reads `length`
+ * bytes back after a repeated start, as one locked transaction.
+ */
+bool i2cReadRegister(uint8_t address, uint8_t reg, uint8_t *data, size_t length);
+
+I2cBusStats i2cBusStats();
+
+#endif
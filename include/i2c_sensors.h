@@ -0,0 +1,81 @@
+#ifndef I2C_SENSORS_H
+#define I2C_SENSORS_H
+
+#include <stdint.h>
+#include "sensors.h"
+
+/*
+ * Drivers of the I2C temperature/humidity sensors, see sensors.h.
+ *
+ * Each conversion is two short transactions on i2c_bus.h, a command and,
+ * once the conversion time has passed, the read back; the bus is free in
+ * between. The decoders are pure functions of the bytes read.
+ */
+
+#define SHT3X_ADDRESS 0x44  // 0x45 with ADDR high
+#define SHT4X_ADDRESS 0x44  // 0x45 and 0x46 on the -B/-C parts
+#define BME280_ADDRESS 0x76 // 0x77 with SDO high
+
+#define SHT3X_CONVERSION_MS 16 // single shot, high repeatability: 15.5 ms max
+#define SHT4X_CONVERSION_MS 9  // high precision: 8.3 ms max
+#define BME280_CONVERSION_MS 7 // forced mode, x1 temperature and humidity, no pressure: 6.4 ms max
+
+/** Length of a SHT3x/SHT4x reply: temperature, CRC, humidity, CRC. */
+#define SHT_FRAME_LENGTH 6
+/** Length of a BME280 temperature + humidity burst, registers 0xFA to 0xFE. */
+#define BME280_FRAME_LENGTH 5
+
+/** BME280 trimming parameters (datasheet 4.2.2), read once from the part. */
+struct Bme280Calibration
+{
+  uint16_t t1;
+  int16_t t2, t3;
+  uint8_t h1;
+  int16_t h2;
+  uint8_t h3;
+  int16_t h4, h5;
+  int8_t h6;
+};
+
+/** @return CRC-8 of the Sensirion parts: polynomial 0x31, initial value 0xFF. */
+uint8_t sensirionCrc(const uint8_t *data, uint8_t length);
+
+/** @brief Sends the single-shot measurement command, no clock stretching. */
+bool sht3xStart(uint8_t address);
+bool sht4xStart(uint8_t address);
+
+/**
+ * @brief Reads a SHT3x/SHT4x reply; the part NACKs until it is done.
+ * @return false if it did not answer.
+ */
+bool shtRead(uint8_t address, uint8_t frame[SHT_FRAME_LENGTH]);
+
+/** @return false if a CRC does not match. */
+bool sht3xDecode(const uint8_t frame[SHT_FRAME_LENGTH], SensorSample &out);
+bool sht4xDecode(const uint8_t frame[SHT_FRAME_LENGTH], SensorSample &out);
+
+/**
+ * @brief Checks the chip ID, reads the calibration and sets humidity
+ * oversampling x1; the part then sleeps until bme280Start().
+ */
+bool bme280Begin(uint8_t address, Bme280Calibration &calibration);
+
+/** @brief Starts one forced-mode conversion, temperature and humidity only. */
+bool bme280Start(uint8_t address);
+
+/** @brief Reads the raw temperature and humidity of the last conversion. */
+bool bme280Read(uint8_t address, uint8_t frame[BME280_FRAME_LENGTH]);
+
+/**
+ * @brief Unpacks a frame read by bme280Read() and compensates it.
+ * @return false for the reset values a part that never converted returns.
+ */
+bool bme280Decode(const uint8_t frame[BME280_FRAME_LENGTH], const Bme280Calibration &calibration, SensorSample &out);
+
+/**
+ * @brief Compensates the raw 20-bit temperature and 16-bit humidity with
+ * the datasheet's 32-bit integer formulas (4.2.3).
+ */
+void bme280Compensate(const Bme280Calibration &calibration, int32_t rawTemp, int32_t rawHumidity, SensorSample &out);
+
+#endif
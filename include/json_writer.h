@@ -0,0 +1,68 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Receives a full buffer from a JsonWriter.
+ * @return false to abort, e.g. when the peer went away.
+ */
+typedef bool (*JsonSink)(const char *data, size_t length, void *context);
+
+/**
+ * Streaming JSON serializer over a caller-provided buffer.
+ *
+ * Values are appended as they come and the buffer is handed to the sink
+ * whenever it fills up, so a document of any length is written with no
+ * heap and no document tree, in the buffer's size. Commas are tracked per
+ * nesting level, up to 32 levels. After a sink failure every call is a
+ * no-op and ok() turns false.
+ */
+class JsonWriter
+{
+public:
+  JsonWriter(char *buffer, size_t size, JsonSink sink, void *context);
+
+  void beginObject();
+  void endObject();
+  void beginArray();
+  void endArray();
+
+  /** Starts a member of the current object; the value follows. */
+  void key(const char *name);
+
+  void value(const char *text);
+  void value(bool flag);
+  void value(int32_t number);
+  void value(uint32_t number);
+  /** A number given in tenths, e.g. 375 for 37.5; INT32_MIN (no reading) is written as null. */
+  void tenths(int32_t value);
+  void null();
+
+  /** Hands what is buffered to the sink. @return ok() */
+  bool flush();
+  bool ok() const { return !failed; }
+  /** @return Bytes produced so far, flushed or not. */
+  size_t written() const { return total + length; }
+
+private:
+  char *buffer;
+  size_t size;
+  size_t length = 0;
+  size_t total = 0;
+  JsonSink sink;
+  void *context;
+  uint32_t hasItems = 0; // bit n: level n already holds a value
+  uint8_t depth = 0;
+  bool afterKey = false;
+  bool failed = false;
+
+  void put(char c);
+  void put(const char *text);
+  void separate();
+  void open(char bracket);
+  void close(char bracket);
+};
+
+#endif
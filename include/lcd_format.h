@@ -0,0 +1,84 @@
+#ifndef LCD_FORMAT_H
+#define LCD_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LCD_COLS 16
+#define LCD_ROWS 2
+
+/** One display row, space padded, without a terminating nul. */
+typedef char LcdRow[LCD_COLS];
+
+/** Stands for "no reading" in formatTenths(). */
+#define LCD_NO_VALUE INT32_MIN
+
+/*
+ * Fixed-point field writers for LcdRow. Each writes a fixed number of
+ * characters at a column given as a template argument, so a field that
+ * would run past the row fails to compile instead of overflowing at run
+ * time. None allocates, calls printf or touches floats, and each takes the
+ * same few divisions by constants whatever the value.
+ *
+ * The templates only check the bounds; the writing itself is done by the
+ * write* functions of lcd_format.cpp, shared by all columns.
+ */
+
+void writeTwoDigits(char *out, uint32_t value);
+void writeTimer(char *out, uint32_t seconds);
+void writeTenths(char *out, int32_t tenths);
+void writeCount(char *out, uint32_t value);
+
+/** Fills the whole row with spaces. */
+inline void formatClear(LcdRow &row)
+{
+  for (uint8_t i = 0; i < LCD_COLS; i++)
+    row[i] = ' ';
+}
+
+/** Writes a string literal at column Col. */
+template <uint8_t Col, size_t N>
+inline void formatText(LcdRow &row, const char (&text)[N])
+{
+  static_assert(Col + N - 1 <= LCD_COLS, "text runs past the end of the row");
+  for (size_t i = 0; i < N - 1; i++)
+    row[Col + i] = text[i];
+}
+
+/** Writes `value` as two digits, "99" if larger. */
+template <uint8_t Col>
+inline void formatTwoDigits(LcdRow &row, uint32_t value)
+{
+  static_assert(Col + 2 <= LCD_COLS, "field runs past the end of the row");
+  writeTwoDigits(row + Col, value);
+}
+
+/** Writes a duration in seconds as HH:MM:SS (8 chars), 99:59:59 at most. */
+template <uint8_t Col>
+inline void formatTimer(LcdRow &row, uint32_t seconds)
+{
+  static_assert(Col + 8 <= LCD_COLS, "field runs past the end of the row");
+  writeTimer(row + Col, seconds);
+}
+
+/**
+ * Writes a value given in tenths right-aligned in 4 chars: "37.5", " 5.2",
+ * "-4.0", or " 100" / " -12" once the decimal no longer fits, and "--.-"
+ * beyond that or for LCD_NO_VALUE.
+ */
+template <uint8_t Col>
+inline void formatTenths(LcdRow &row, int32_t tenths)
+{
+  static_assert(Col + 4 <= LCD_COLS, "field runs past the end of the row");
+  writeTenths(row + Col, tenths);
+}
+
+/** Writes `value` right-aligned in 4 chars, "9999" if larger. */
+template <uint8_t Col>
+inline void formatCount(LcdRow &row, uint32_t value)
+{
+  static_assert(Col + 4 <= LCD_COLS, "field runs past the end of the row");
+  writeCount(row + Col, value);
+}
+
+#endif
@@ -1,38 +1,71 @@
 #ifndef LCD_MANAGER_H
 #define LCD_MANAGER_H
 
-/**
- * Converts a time duration in seconds to a formatted string (HH:MM:SS).
- * 
- * @return A pointer to a statically allocated string representing the formatted time.
- */
-char* formatTimer();
+#include <stdint.h>
+#include "shared_state.h"
+#include "day_stats.h"
 
+#define LCD_ADDRESS 0x27 // https://learn.adafruit.com/scanning-i2c-addresses/arduino
 
-/**
- * Formats current temperature, target temperature, and humidity into a string
- * suitable for LCD display. The format is "xx.x/xx.xC xx.x%".
- * @return A pointer to a statically allocated 17 character string.
- */
-char* formatSensorMsg();
+// The PCF8574 on the usual backpacks is rated for standard-mode 100 kHz.
+// A build whose backpack has been checked at 400 kHz can raise it
+// (-D LCD_I2C_CLOCK=400000), cutting a full LCD chunk from about 12 ms on
+// the bus to 3 ms.
+#ifndef LCD_I2C_CLOCK
+#define LCD_I2C_CLOCK 100000
+#endif
 
+#define LCD_RESET_RETRY 5000 // in ms, between two resets of a display that does not answer
 
+#define LCD_DAY_SCREENS 3 // see updateDayLCD()
+
+/**
+ * Initialises the 16x2 LCD (4-bit mode, display on, cleared) on the already
+ * started Wire bus and switches the bus to LCD_I2C_CLOCK.
+ *
+ * A write the backpack does not acknowledge drops the rest of that frame,
+ * and the next lcdType() or updateLCD() resets and redraws the display,
+ * since the cells marked as sent may not be on the glass and a cut-short
+ * transfer may leave the controller between two nibbles.
+ */
+void lcdBegin();
 
 /**
  * Displays two lines of text on the LCD.
  *
+ * Rows are padded to 16 characters and compared with a shadow copy of what
+ * is already on the display; only the characters that changed are sent,
+ * batched into as few I2C transactions as possible.
+ *
  * @param line1 The text to display on the first row of the LCD. If empty, the row is not updated.
  * @param line2 The text to display on the second row of the LCD. If empty, the row is not updated.
  */
 void lcdType(const char* line1, const char* line2);
 
 /**
- * Updates the LCD display with the current temperature, target temperature, and
- * humidity as well as the current incubation day and a turning timer if
- * applicable. If the incubation cycle is complete, it displays "Incubation Ended"
- * and if there is no internet connection, it displays " Internet Error". If the
- * current day is greater than 22, it displays "     Idle.." and "Press Btn Start!".
+ * @return Average number of bytes sent to the LCD over I2C per second, over
+ * the window since the previous call (at least one second long).
+ */
+unsigned long lcdBytesPerSecond();
+
+/**
+ * Updates the LCD display with the temperature, target temperature, and
+ * humidity of a control task snapshot as well as its incubation day and a
+ * turning timer if applicable, against the length of the primary chamber's
+ * profile. The day after the cycle it displays "Incubation Ended", and if the
+ * clock was never set, " Internet Error". Later, or before a cycle, it
+ * displays "     Idle.." and "Press Btn Start!".
+ * Both rows are assembled in place by the fixed-point writers of lcd_format.h.
+ */
+void updateLCD(const ControlState &state);
+
+/**
+ * Displays one of the LCD_DAY_SCREENS screens of a chamber's day so far:
+ * the heater's and humidifier's share of the day and switches ("Heat 34.2%
+ * 1234x"), the minimum, mean and maximum temperature and humidity
+ * ("37.1/37.5/37.9C"), and the share of the day each spent outside its
+ * band ("T  3.1%  H 12.4%").
  */
-void updateLCD();
+void updateDayLCD(const DayStats &stats, uint8_t screen);
 
 #endif
\ No newline at end of file
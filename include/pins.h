@@ -0,0 +1,21 @@
+#ifndef PINS_H
+#define PINS_H
+
+/* Pins */
+#define TEMP_RELAY_PIN 17
+#define RESET_BUTTON_PIN 19
+#define DHT22_PIN 23
+#define SDA_PIN 21
+#define SCL_PIN 22
+#define BUZZER_BJT_PIN 5
+#define HUMIDIFIER_MOSFET_PIN 18
+#define HUMIDIFIER_PAUSE_BUTTON_PIN 4
+#define HUMIDIFIER_STATE_LED_PIN 16
+
+/* Egg turner, taken only when config.json fits a motor (see turner.h) */
+#define TURNER_STEP_PIN 32
+#define TURNER_DIR_PIN 33
+#define TURNER_ENABLE_PIN 13
+#define TURNER_END_STOP_PIN 34 // input only, the switch needs an external pull-up
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+
+/** Time spent awake and in light sleep, the inputs of a battery estimate. */
+struct PowerStats
+{
+  uint64_t awakeMs;
+  uint64_t asleepMs;
+  uint32_t wakeups;  // light sleeps ended, by timer or by a wake source
+};
+
+/**
+ * @brief Registers the wake sources of light sleep.
+ *
+ * @details Each pin wakes the chip when its level changes from the one it
+ * has when the sleep starts, so buttons wake it on press and on release.
+ * Serial input on UART0 wakes it as well, for the console.
+ *
+ * @param onPinWake Called after a sleep ended by one of the pins: their
+ * edge interrupts are off while asleep, so the edge itself is not seen.
+ */
+void powerBegin(const uint8_t *wakePins, uint8_t count, void (*onPinWake)());
+
+/**
+ * @brief Light-sleeps for up to `ms` or until a wake source fires.
+ *
+ * @details Returns once awake again. Elsewhere (the native build) nothing
+ * sleeps: the sleep is only booked, from now until the next powerAwake().
+ */
+void powerSleep(uint32_t ms);
+
+/** @brief Ends a booked sleep of the native build; nothing on the ESP32. */
+void powerAwake();
+
+/** @return Totals since boot. */
+PowerStats powerStats();
+
+/**
+ * @brief Prints the awake share and wakeups since the previous report.
+ *
+ * @details The awake share is the proxy for the average current: roughly
+ * awake% * awake current + (100 - awake%) * light-sleep current.
+ */
+void powerReport();
+
+#endif
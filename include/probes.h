@@ -0,0 +1,109 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+#include <stdint.h>
+
+/*
+ * Latency probes around the sections of the control and service steps.
+ *
+ * Each probe keeps a log2 histogram of its durations (bin b counts the
+ * runs that took 2^b to 2^(b+1) ns), a count, a total and a maximum, from
+ * which the "probes" serial command prints mean, p99 and max. Building
+ * with PROBES_DISABLED (the release environment) turns PROBE() into
+ * nothing and leaves only a stub dump.
+ *
+ * Durations come from the CPU cycle counter on the ESP32 and from the
+ * host's steady clock in the native build.
+ */
+
+enum ProbeId
+{
+  PROBE_CONTROL_STEP, // whole control step
+  PROBE_BUTTONS,      // reset and pause button gestures
+  PROBE_SENSOR,       // sensor collection (DHT22 decode, I2C read) and model update
+  PROBE_REGULATION,   // heater, humidifier and failsafe decisions
+  PROBE_SERVICE_STEP, // whole service step
+  PROBE_WIFI,         // WiFi state and NTP sync
+  PROBE_LCD,          // frame formatting and I2C transfer
+  PROBE_JOURNAL,      // state journal appends and compaction
+  PROBE_HISTORY,      // history ring and block writes
+  PROBE_TELEMETRY,    // HTTP and WebSocket clients
+  PROBE_COUNT
+};
+
+#define PROBE_BINS 32
+
+struct ProbeStats
+{
+  uint32_t count;
+  uint32_t maxNs;
+  uint64_t totalNs;
+  uint32_t bins[PROBE_BINS];
+};
+
+#ifndef PROBES_DISABLED
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <Arduino.h>
+static inline uint32_t probeTicks() { return ESP.getCycleCount(); }
+static inline uint32_t probeTicksToNs(uint32_t ticks) { return (uint64_t)ticks * 1000 / (F_CPU / 1000000); }
+#else
+#include <chrono>
+static inline uint32_t probeTicks()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static inline uint32_t probeTicksToNs(uint32_t ticks) { return ticks; }
+#endif
+
+/** Adds one run of `ns` to a probe. Each probe must only be fed by one task. */
+void probeRecord(ProbeId id, uint32_t ns);
+
+/** Times the rest of the enclosing scope. */
+class ProbeScope
+{
+public:
+  explicit ProbeScope(ProbeId id) : id(id), start(probeTicks()) {}
+  ~ProbeScope() { probeRecord(id, probeTicksToNs(probeTicks() - start)); }
+
+private:
+  ProbeId id;
+  uint32_t start;
+};
+
+#define PROBE_JOIN(a, b) a##b
+#define PROBE_NAME(line) PROBE_JOIN(probeScope, line)
+#define PROBE(id) ProbeScope PROBE_NAME(__LINE__)(id)
+
+#else
+
+#define PROBE(id) \
+  do              \
+  {               \
+  } while (0)
+
+#endif
+
+/**
+ * @brief Prints every probe that ran: count, mean, p99, max and the
+ * non-empty histogram bins.
+ *
+ * @details Figures of the other task's probes are read while it keeps
+ * running, so a dump may be off by the run in progress.
+ */
+void probesDump();
+
+/** Clears all probes, e.g. before a measurement. */
+void probesReset();
+
+/**
+ * @return The smallest bin upper edge, in ns, below which at least
+ * `percent` of the runs of `id` fall (capped at the maximum), 0 if none.
+ */
+uint32_t probePercentile(ProbeId id, float percent);
+
+/** @return The figures of one probe since the last reset. */
+const ProbeStats &probeStats(ProbeId id);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef PROFILES_H
+#define PROFILES_H
+
+#include <stdint.h>
+
+/*
+ * Incubation profiles of the species the firmware knows: how many days the
+ * cycle runs, on which days the eggs are turned, and the temperature and
+ * humidity targets of every day. The day tables are expanded at compile
+ * time from a few points of each curve (profiles.cpp) and live in flash,
+ * so a new day costs the control task a table lookup.
+ *
+ * config.json only names a profile, for all chambers or per chamber, and
+ * overrides a few of its values.
+ */
+
+enum ProfileId : uint8_t
+{
+  PROFILE_CHICKEN,
+  PROFILE_DUCK,
+  PROFILE_QUAIL,
+  PROFILE_GOOSE,
+  PROFILE_COUNT
+};
+
+/** Targets of one day of the cycle. */
+struct ProfileDay
+{
+  float temp;     // C
+  float humidity; // %RH
+};
+
+struct Profile
+{
+  const char *name; // as in config.json
+  uint8_t days;     // hatch is due by the end of this day
+  uint8_t turnFirst; // first and last day the eggs are turned, lockdown follows
+  uint8_t turnLast;
+  uint8_t turnsPerDay; // a divisor of 24
+  float tempHyst;      // C
+  float humidityHyst;  // %RH
+  const ProfileDay *schedule; // `days` entries, day 1 first
+};
+
+extern const Profile PROFILES[PROFILE_COUNT];
+
+/** @return The profile called `name` in config.json, PROFILE_COUNT if none is. */
+ProfileId profileId(const char *name);
+
+/**
+ * @return The targets of `day` of `profile`: those of day 1 while the day is
+ * not known yet (0), those of the last day once the hatch is due.
+ */
+inline const ProfileDay &profileDay(const Profile &profile, uint8_t day)
+{
+  return profile.schedule[day <= 1 ? 0 : day >= profile.days ? profile.days - 1 : day - 1];
+}
+
+/** @return Whether the eggs are turned on `day`. */
+inline bool profileTurning(const Profile &profile, uint8_t day)
+{
+  return day >= profile.turnFirst && day <= profile.turnLast;
+}
+
+#endif
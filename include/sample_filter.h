@@ -0,0 +1,59 @@
+#ifndef SAMPLE_FILTER_H
+#define SAMPLE_FILTER_H
+
+#include <stdint.h>
+#include "sensors.h"
+
+/*
+ * Cleans up sensor readings before the heater and humidifier see them.
+ *
+ * Each chamber's readings go through three stages, each of which can be
+ * turned off in config.json:
+ * - plausibility: a reading outside the sensor's range, or further from
+ *   the last accepted one than the chamber can move in the time between
+ *   them, is rejected and counted
+ * - median of the accepted readings of the last few seconds, so a single
+ *   spike that got through never reaches the output
+ * - exponential moving average with a time constant in seconds
+ *
+ * Both windows are spans of time rather than counts of readings, so a
+ * sensor read every second and one read every 10 s are treated alike: a
+ * 3 s median takes the middle of three I2C readings and leaves a DHT22's
+ * alone instead of delaying it by 10 s, which costs the hysteresis more
+ * than the spikes it removes.
+ *
+ * All state is in fixed arrays, FILTER_MAX_WINDOW readings per chamber.
+ */
+
+/** Most readings the median is taken over, however long its span. */
+#define FILTER_MAX_WINDOW 5
+
+struct FilterConfig
+{
+  uint8_t medianSeconds; // span of the median, 0 turns it off
+  float maxTempRate;     // C/s a reading may move from the last accepted one, 0 turns it off
+  float maxHumidityRate; // %RH/s, likewise
+  float emaSeconds;      // time constant of the moving average, 0 turns it off
+};
+
+/** @brief Sets the stages up for every chamber and empties their windows. */
+void filterBegin(const FilterConfig &config);
+
+/**
+ * @brief Passes a reading of `chamber` taken at `now` (millis()) through
+ * the stages.
+ *
+ * @details After FILTER_MAX_REJECTS rejections in a row the reading is
+ * taken as the new normal and the chamber's window started over, so a
+ * genuine jump (a lid opened, a sensor replaced) is followed within a few
+ * readings. So is a reading after a minute without any.
+ *
+ * @return false if the reading was rejected; otherwise true with `sample`
+ * replaced by the filtered one.
+ */
+bool filterApply(uint8_t chamber, unsigned long now, SensorSample &sample);
+
+/** @return Readings of `chamber` rejected since boot. */
+uint32_t filterRejected(uint8_t chamber);
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef SENSORS_H
+#define SENSORS_H
+
+#include <stdint.h>
+
+/*
+ * Temperature/humidity sensors behind one interface, one per chamber.
+ *
+ * Each type has a driver: the DHT22 on its own data line (dht_reader.h),
+ * or a SHT3x, SHT4x or BME280 on the shared I2C bus (i2c_sensors.h). All of
+ * them convert in the background: sensorStart() sends the request and
+ * returns, sensorPoll() collects the result once it is ready. The I2C parts
+ * answer in under 20 ms and are read every second, the DHT22 every 10 s.
+ */
+
+/** Sensors, numbered from 0 like the chambers they belong to. */
+#define MAX_SENSORS 8
+
+enum SensorType
+{
+  SENSOR_DHT22,
+  SENSOR_SHT3X,
+  SENSOR_SHT4X,
+  SENSOR_BME280,
+  SENSOR_TYPE_COUNT
+};
+
+/** Outcome of a conversion, as returned by sensorPoll(). */
+enum SensorStatus
+{
+  SENSOR_IDLE,    // no conversion in progress
+  SENSOR_PENDING, // started, result not ready yet
+  SENSOR_OK,      // sample collected
+  SENSOR_FAILED   // no answer, bad frame or checksum
+};
+
+struct SensorSample
+{
+  float temperature; // C
+  float humidity;    // %RH
+};
+
+/** @return The type called `name` in config.json, SENSOR_TYPE_COUNT if none is. */
+SensorType sensorType(const char *name);
+
+/** @return Whether sensors of `type` sit on the I2C bus rather than a data pin. */
+bool sensorOnBus(SensorType type);
+
+/** @return The I2C address `type` answers on with its address pin low. */
+uint8_t sensorDefaultAddress(SensorType type);
+
+/**
+ * @brief Sets `sensor` up as a `type` on data pin, or at I2C address,
+ * `pinOrAddress`.
+ *
+ * @details Nothing is sent on the bus yet; a part that needs configuring
+ * (the BME280's calibration) is set up by its first sensorStart(), and set
+ * up again after a failed conversion, so one plugged in late still works.
+ *
+ * @return false if `sensor` is out of range or another sensor already uses
+ * that address.
+ */
+bool sensorBegin(uint8_t sensor, SensorType type, uint8_t pinOrAddress);
+
+/**
+ * @brief Starts a conversion without waiting for it.
+ * @return false if it could not be started (no answer, or one in progress).
+ */
+bool sensorStart(uint8_t sensor);
+
+/**
+ * @brief Collects the conversion started by sensorStart().
+ *
+ * @details SENSOR_PENDING until sensorConversionTime() has passed (or, for
+ * the DHT22, the frame is in), then the outcome once, then SENSOR_IDLE.
+ */
+SensorStatus sensorPoll(uint8_t sensor, SensorSample &out);
+
+/** @return ms between two conversions of `sensor`. */
+uint16_t sensorPeriod(uint8_t sensor);
+
+/** @return Longest a conversion of `sensor` takes, in ms. */
+uint16_t sensorConversionTime(uint8_t sensor);
+
+/** @return Its type as written in config.json. */
+const char *sensorName(uint8_t sensor);
+
+/** @return Conversions of `sensor` that failed since boot. */
+unsigned long sensorErrors(uint8_t sensor);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef SHARED_STATE_H
+#define SHARED_STATE_H
+
+#include <stdint.h>
+#include "channel.h"
+#include "chambers.h"
+
+/** What the control task publishes for the display and telemetry. */
+struct ControlState
+{
+  float temp;     // C, NAN before the first reading
+  float humidity; // %RH
+  float tempTarget;
+  bool isSensorOk;
+  bool heaterOn;
+  bool humidifierOn;
+  bool humidifierPaused;
+  uint8_t currentDay;
+  uint8_t profile; // ProfileId, see profiles.h
+  uint32_t timeInSeconds; // until the next egg turn
+  uint32_t incubationStart; // unix timestamp, 0 when idle
+  uint32_t samplesRejected; // by the sample filter since boot
+  uint8_t alarm;            // AlarmSource sounding, ALARM_NONE when silent
+  uint8_t tray;             // TurnerSide, where the turner rests or is headed
+  bool trayMoving;
+
+  // every chamber, the fields above being chamber 0's (see chambers.h)
+  uint8_t chamberCount;
+  ChamberMask chamberRunning;
+  ChamberMask chamberSensorOk;
+  ChamberMask chamberHeater;
+  ChamberMask chamberHumidifier;
+  int16_t chamberTemp[MAX_CHAMBERS];     // 0.1 C, INT16_MIN before the first reading
+  int16_t chamberHumidity[MAX_CHAMBERS]; // 0.1 %RH, likewise
+  uint8_t chamberDay[MAX_CHAMBERS];
+  uint32_t chamberRejected[MAX_CHAMBERS];
+};
+
+/** What the service task publishes about the clock, see time_manager.h. */
+struct ServiceState
+{
+  uint8_t clockSource;   // ClockSource
+  uint32_t syncCount;    // bumped whenever the clock is set or corrected
+  uint64_t clockUnixMs;  // unix time at clockUptime, in ms
+  uint64_t clockUptime;  // uptimeMillis() when it was set
+  int32_t clockDriftPpb; // how fast the uptime runs, corrected for
+};
+
+/** One-off requests from the control task to the display. */
+enum UiEvent : uint8_t
+{
+  UI_INTERNET_REQUIRED, // a cycle cannot start without the time
+  UI_DAY_STATS          // the primary chamber's figures for the day so far, see day_stats.h
+};
+
+extern Snapshot<ControlState> controlState;
+extern Snapshot<ServiceState> serviceState;
+extern SpscQueue<UiEvent, 4> uiEvents;
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef STATE_JOURNAL_H
+#define STATE_JOURNAL_H
+
+#include <stdint.h>
+#include "chambers.h"
+
+/** Runtime values kept in the journal. */
+enum StateKey
+{
+  STATE_INCUBATION_START = 1, // unix timestamp, 0 when idle
+  STATE_LAST_TURN,            // unix timestamp of the last egg turn
+  STATE_CURRENT_DAY,          // last known incubation day
+  STATE_HUMIDIFIER_PAUSED,    // 1 while the humidifier is on hold
+  STATE_PID_KP,               // autotuned gains, as float bit patterns
+  STATE_PID_KI,
+  STATE_PID_KD,
+  STATE_MODEL_GAIN,           // fitted thermal model, as float bit patterns
+  STATE_MODEL_LOSS,
+  STATE_MODEL_OFFSET,
+  STATE_CHAMBER_DAY,          // last known day of chamber 1, chamber i at STATE_CHAMBER_DAY + i - 1
+  STATE_CLOCK = STATE_CHAMBER_DAY + MAX_CHAMBERS - 1, // unix time checkpoint, see time_manager.h
+  STATE_CLOCK_DRIFT,          // measured clock drift in ppb, as int32_t
+  STATE_KEY_COUNT
+};
+
+/**
+ * @brief Replays the state journal from LittleFS.
+ *
+ * @details The journal is an append-only file of small CRC-protected
+ * records; the last valid record of each key wins. Replay stops at the
+ * first damaged record, so a write torn by a power loss only loses that
+ * last update.
+ *
+ * @return The number of valid records found.
+ */
+uint16_t journalBegin();
+
+/**
+ * @return The journaled value of `key`, or `fallback` if it was never set.
+ */
+uint32_t journalGet(StateKey key, uint32_t fallback);
+
+/**
+ * @brief Persists a runtime value as one record (8 bytes).
+ *
+ * @details Does nothing if the value is unchanged. Safe for the control
+ * task: the record is only queued, journalGet() sees the new value at
+ * once and journalMaintain() appends it to flash later. Only one task may
+ * call it.
+ */
+void journalSet(StateKey key, uint32_t value);
+
+/**
+ * @brief Appends the queued records, and compacts the journal once it has
+ * grown past its limit.
+ *
+ * @details Compaction rewrites the current values into a fresh file and
+ * atomically renames it over the journal. Meant for the service task, so
+ * no flash write ever delays the control task.
+ */
+void journalMaintain();
+
+#endif
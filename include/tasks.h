@@ -0,0 +1,80 @@
+#ifndef TASKS_H
+#define TASKS_H
+
+#include <stdint.h>
+
+enum TaskId
+{
+  TASK_CONTROL, // sensor, heater, humidifier, buttons, turn alarm
+  TASK_SERVICE, // WiFi, NTP, LCD, flash
+  TASK_COUNT
+};
+
+struct TaskStats
+{
+  const char *name;
+  uint8_t core;
+  float cpu;               // % of the last report window spent in the step
+  uint32_t maxStepMicros;  // longest single step since boot
+  uint32_t stackFree;      // bytes never touched so far, 0 if unknown
+};
+
+/**
+ * A task's step. Returns how many ms may pass before it needs to run again;
+ * it may be woken earlier through tasksWake().
+ */
+typedef uint32_t (*TaskStep)();
+
+/**
+ * @brief Starts the control and service tasks.
+ *
+ * @details On the ESP32 the control step runs in a task pinned to core 1
+ * above every other application task, and the service step on core 0, next
+ * to the WiFi stack. The two only exchange data through the lock-free
+ * channels of shared_state.h, so a slow WiFi or flash operation never
+ * delays a heater decision. The one thing they share is the I2C bus, taken
+ * a transaction at a time (i2c_bus.h): a sensor read waits at most for one
+ * LCD transfer.
+ *
+ * Neither task polls: each one blocks until the deadline its step returned
+ * (at most a second away) or until it is woken. When both are idle for
+ * long enough and sleep is allowed, the control task puts the chip into
+ * light sleep until the earliest deadline, see power.h.
+ *
+ * Elsewhere (the native build) no tasks are created and tasksRun() runs
+ * each step when it is due, the same code on a single thread.
+ */
+void tasksBegin(TaskStep controlStep, TaskStep serviceStep);
+
+/**
+ * @brief Body of the Arduino loop().
+ *
+ * @details Runs the steps that are due when there are no tasks to do it,
+ * and otherwise gives the loop task's core back.
+ */
+void tasksRun();
+
+/** @brief Runs `task`'s step as soon as possible, whatever its deadline. */
+void tasksWake(TaskId task);
+
+/** @brief tasksWake() for interrupt handlers. */
+void tasksWakeFromISR(TaskId task);
+
+/**
+ * @brief Allows or forbids light sleep, e.g. while the radio is in use.
+ */
+void tasksAllowSleep(bool allowed);
+
+/**
+ * @brief Prints CPU use, worst step time and stack headroom of each task,
+ * followed by the time spent in light sleep and the LCD's I2C traffic.
+ *
+ * @details Called every 10 minutes from the service task; each report
+ * starts a new measurement window.
+ */
+void tasksReport();
+
+/** @return Figures of the last report, refreshed by tasksReport(). */
+const TaskStats &taskStats(TaskId task);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef TELEMETRY_SERVER_H
+#define TELEMETRY_SERVER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "shared_state.h"
+
+#define TELEMETRY_MAX_WEBSOCKETS 6 // further upgrades get 503, the other slots stay free for requests
+
+struct TelemetryStats
+{
+  uint32_t requests;  // HTTP requests answered
+  uint32_t rejected;  // connections refused, every slot taken
+  uint32_t frames;    // WebSocket frames pushed
+  uint32_t bytesSent;
+  uint8_t clients;    // connections open now
+  uint8_t websockets; // of which WebSockets
+};
+
+/**
+ * @brief Enables the HTTP/WebSocket server on `port` (0 picks a free one).
+ *
+ * @details Nothing is opened yet: the listening socket follows the WiFi
+ * link, see telemetryPoll().
+ */
+void telemetryBegin(uint16_t port);
+
+/**
+ * @brief Serves the connected clients without waiting for any of them.
+ *
+ * @details For the service task. Opens the listening socket once `online`
+ * and closes every connection when the link goes down. Accepts new
+ * connections, answers complete requests and, when `sequence` moved on,
+ * pushes `state` to every WebSocket client.
+ *
+ * Endpoints:
+ * - `GET /`: a small live page using the WebSocket
+ * - `GET /api/state`: the current readings and relay state
+ * - `GET /api/history?from=&to=`: recorded entries between two unix
+ *   times, the last 24 hours by default, chunked
+ * - `GET /api/config`: config.json as stored
+ * - `GET /ws`: WebSocket, one state frame on connect and on every change
+ *
+ * Everything is written from fixed buffers through JsonWriter; the server
+ * allocates nothing, whatever the number of requests.
+ *
+ * @param unixTime Current unix time, 0 if unknown.
+ */
+void telemetryPoll(const ControlState &state, uint32_t sequence, bool online, uint32_t unixTime);
+
+/** @return The port listened on, 0 if not listening. */
+uint16_t telemetryPort();
+
+TelemetryStats telemetryStats();
+
+/** @return RAM the server reserves statically, in bytes. */
+size_t telemetryMemory();
+
+#endif
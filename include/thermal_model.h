@@ -0,0 +1,46 @@
+#ifndef THERMAL_MODEL_H
+#define THERMAL_MODEL_H
+
+/**
+ * @brief Sets up the chamber model used by the sensor failsafe.
+ *
+ * @details The model is first order with a lagging heater:
+ *
+ *   dT/dt = gain * heater + loss * (T - 37 C) + offset
+ *
+ * where `loss` is negative and `offset` is the heat loss at 37 C, which
+ * follows the room temperature. The parameters are fitted online by
+ * recursive least squares while the sensor is healthy, with a forgetting
+ * factor so a change of room temperature or egg load is picked up within
+ * hours, and are kept in the state journal. The offset's recent trend is
+ * extrapolated while the sensor is out, so a room that was warming up
+ * keeps warming up in the model.
+ *
+ * Until a fit is available the configured constant rates are used, as
+ * before: `gainPerSecond` while the heater is on, `lossPerSecond` while off.
+ *
+ * @param temp Starting estimate of the chamber temperature, in C.
+ */
+void thermalModelBegin(float gainPerSecond, float lossPerSecond, float temp);
+
+/**
+ * @brief Tells the model that the heater relay switched.
+ */
+void thermalModelHeater(bool on);
+
+/**
+ * @brief Feeds a healthy sensor reading: re-anchors the estimate and, once
+ * a minute, updates the fit.
+ */
+void thermalModelObserve(float temp);
+
+/**
+ * @return The modelled chamber temperature now, in C, extrapolated from the
+ * last reading through the heater switches since.
+ */
+float thermalModelEstimate();
+
+/** @return true once the fitted parameters are in use. */
+bool thermalModelLearned();
+
+#endif
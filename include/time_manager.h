@@ -1,28 +1,98 @@
 #ifndef TIME_MANAGER_H
 #define TIME_MANAGER_H
 
+#include <stdint.h>
+
+struct ServiceState;
+
+/*
+ * The device keeps its own wall clock: a unix time anchored to the 64-bit
+ * uptime, which runs on between NTP syncs and is corrected for the
+ * crystal's drift. NTP only corrects it, once at boot and then every few
+ * hours during a cycle, so a lost connection costs nothing but accuracy.
+ *
+ * Across a reset the clock is carried in RTC memory, which keeps its
+ * contents as long as the chip is powered. After a power loss it resumes
+ * from the checkpoint in the state journal, which is behind by however
+ * long the power was off, until the next NTP answer.
+ */
+
+/** Where the clock's time comes from, worst first. */
+enum ClockSource : uint8_t
+{
+  CLOCK_UNSET,     // never synced: no date, no cycle can start
+  CLOCK_ESTIMATED, // resumed from the journal after a power loss
+  CLOCK_NTP        // synced, and carried on from there
+};
+
+/** @return ms since boot, on a counter that does not wrap. */
+uint64_t uptimeMillis();
+
+/**
+ * @brief Sets the clock up at boot.
+ *
+ * @details After a reset the clock carried in RTC memory is resumed where
+ * it stopped; otherwise, after a power loss, from `checkpoint`, the latest
+ * unix time known to have passed (0 if none). Meant to be called from
+ * setup(), before publishTimeState().
+ *
+ * @param driftPpb Drift measured on an earlier boot, see clockDrift().
+ */
+void clockBegin(uint32_t checkpoint, int32_t driftPpb);
+
+/**
+ * @brief Notes that the device is still running, for the RTC copy of the
+ * clock. Cheap: meant to be called on every control step.
+ */
+void clockAlive();
+
+/** @return The unix time of `clock` at `uptime`, 0 while unset. */
+uint32_t clockUnix(const ServiceState &clock, uint64_t uptime);
+
+/** @return Unix time now, 0 while the clock is unset. Service task only. */
+uint32_t clockNow();
+
+ClockSource clockSource();
+
+/**
+ * @return ppb the uptime runs fast against NTP, as measured over the
+ * longest span between two syncs of this boot, once that is 6 hours.
+ */
+int32_t clockDrift();
+
+/**
+ * @brief Starts synchronizing the device's time with an NTP server.
+ *
+ * @details Configures SNTP with "pool.ntp.org" and "time.nist.gov" and
+ * returns immediately; the request is answered in the background and
+ * picked up by handleTimeSync().
+ */
+void startTimeSync();
+
 /**
- * Synchronizes the device's time with an NTP server.
- * 
- * This function attempts to configure and synchronize the time using NTP servers
- * "pool.ntp.org" and "time.nist.gov". It retries up to 20 times with a 500ms delay
- * between attempts if the initial synchronization fails. If successful, it updates
- * various time-related variables including the current day and time since the last
- * egg turn. If it fails, it marks the device as offline for time synchronization.
- * It also disconnects from WiFi after a successful sync to save power.
+ * @brief Advances a time sync started by startTimeSync(), never blocking.
+ *
+ * @details Meant to be called on every loop pass. Once SNTP reports the
+ * clock as set, it waits for the next second to start, re-anchors the
+ * device's clock on that edge, reports how far off it
+ * was, updates the drift estimate and disconnects from WiFi to save power
+ * unless the telemetry server keeps it online. If no answer arrives within
+ * 10 seconds, the device is marked offline for time synchronization.
+ *
+ * @return true on the pass where the sync finished, successfully or not.
  */
-void syncTime();
+bool handleTimeSync();
 
 /**
- * @brief Retrieves the current Unix timestamp.
- * 
- * @details Attempts to fetch the current local time and convert it to
- * a Unix timestamp, representing seconds since 00:00:00 UTC, January 1, 1970.
- * If the local time retrieval fails, it sets the time synchronization flag
- * to false and returns 0.
- * 
- * @return Current Unix timestamp in seconds, or 0 if the time is not synchronized.
+ * @brief Publishes the clock as a ServiceState snapshot (see
+ * shared_state.h), if it changed.
+ *
+ * @details The control task never calls into SNTP; it reads the clock
+ * from the last published anchor with clockUnix() instead. Meant to be
+ * called on every service step, after handleWifi() and handleTimeSync().
+ *
+ * @return true if something was published.
  */
-unsigned long getUnixTimestamp();
+bool publishTimeState();
 
-#endif
\ No newline at end of file
+#endif
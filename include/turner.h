@@ -0,0 +1,122 @@
+#ifndef TURNER_H
+#define TURNER_H
+
+#include <stdint.h>
+
+/*
+ * The egg turner: a tray tilted from one side to the other by a stepper, or
+ * by a DC motor with a fixed travel time. One side has an end-stop switch,
+ * "home"; the other is reached by counting steps or time. Every other turn
+ * ends on the switch, which confirms it and takes up any step lost on the
+ * way out.
+ *
+ * The motion runs on a one-shot esp_timer, the hardware timer the buttons
+ * and the DHT22 reader already use: each callback drives the next edge of
+ * the step pulse, with a linear ramp at both ends of the travel, or checks
+ * the end-stop and the travel time of a DC motor. The control task only
+ * starts a motion and collects its result.
+ *
+ * Owned by the control task, except turnerMoving().
+ */
+
+enum TurnerMotor : uint8_t
+{
+  TURNER_NONE, // turned by hand, on the turn alarm
+  TURNER_STEPPER,
+  TURNER_DC
+};
+
+struct TurnerConfig
+{
+  uint8_t motor;        // TurnerMotor
+  uint16_t travelSteps; // stepper, from one side to the other
+  uint16_t stepHz;      // stepper, top speed
+  uint16_t rampSteps;   // stepper, to reach it and to stop
+  uint16_t travelMs;    // DC motor, from one side to the other
+};
+
+struct TurnerPins
+{
+  uint8_t step;    // stepper only
+  uint8_t dir;     // HIGH towards home
+  uint8_t enable;  // a stepper driver's active-low EN, a DC bridge's active-high one
+  uint8_t endStop; // closed (LOW) on the home side
+};
+
+enum TurnerResult : uint8_t
+{
+  TURNER_IDLE,   // nothing started since the last result
+  TURNER_BUSY,   // moving
+  TURNER_DONE,   // arrived, checked against the end-stop
+  TURNER_FAILED  // the end-stop disagrees: jammed tray, stalled motor or broken switch
+};
+
+/** Where the tray rests. */
+enum TurnerSide : uint8_t
+{
+  TURNER_HOME,    // tilted onto the end-stop
+  TURNER_AWAY,    // tilted the other way
+  TURNER_LEVEL,   // flat, for the hatch
+  TURNER_UNKNOWN  // after boot off the end-stop, or after a failure
+};
+
+/** Totals since boot, for the console and the simulator. */
+struct TurnerStats
+{
+  uint32_t turns;       // completed, levelling included
+  uint32_t failures;
+  uint32_t steps;       // stepper edges driven
+  uint32_t lastMoveMs;  // duration of the last motion
+};
+
+/**
+ * @brief Sets the motor up, idle, on `pins`; nothing for TURNER_NONE.
+ *
+ * @details The tray is taken to be home if the end-stop is closed,
+ * anywhere otherwise: the first turn then looks for the switch.
+ */
+void turnerBegin(const TurnerConfig &config, const TurnerPins &pins);
+
+/** @return Whether a motor is fitted. */
+bool turnerFitted();
+
+/**
+ * @brief Tilts the tray to the other side; from an unknown side or level,
+ * to the home side.
+ *
+ * @return false if a motion is under way or no motor is fitted.
+ */
+bool turnerTurn();
+
+/** @brief Takes the tray to level for the hatch, homing it first if need be. */
+bool turnerLevel();
+
+/** @return Where the tray rests, or was last headed while moving. */
+TurnerSide turnerSide();
+
+/** @return Short name of `side`, for the log and telemetry. */
+const char *turnerSideName(TurnerSide side);
+
+/**
+ * @brief Collects the result of the last motion.
+ *
+ * @return TURNER_BUSY while moving, TURNER_DONE or TURNER_FAILED once, and
+ * TURNER_IDLE after that.
+ */
+TurnerResult turnerPoll();
+
+/** @return Whether the motor is driven, from any task: light sleep would stop it. */
+bool turnerMoving();
+
+/**
+ * @brief Sets the callback run when a motion ends, from the timer task,
+ * e.g. to wake the task collecting the result.
+ */
+void turnerOnStop(void (*onStop)());
+
+TurnerStats turnerStats();
+
+/** @brief Prints the motor, the side and the totals. */
+void turnerReport();
+
+#endif
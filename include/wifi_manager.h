@@ -1,12 +1,56 @@
 #ifndef WIFI_MANAGER_H
 #define WIFI_MANAGER_H
 
+#include <stdint.h>
+
+#define WIFI_SSID_MAX 32 // bytes, as 802.11 allows
+#define WIFI_PWD_MAX 64  // a WPA2 passphrase, or the key in hex
+
+/*
+ * The network of the last connection (access point, channel and IP lease
+ * with its granted time) is kept in RTC memory. The next wifiConnect()
+ * joins that access point on its channel, without a scan, and reuses the
+ * lease up to its T1, half the granted time, instead of asking DHCP again;
+ * if that does not connect quickly it falls back to a full scan and DHCP.
+ * A link that stays up on a reused lease goes back to DHCP at T1.
+ */
+
+/** How a connection attempt found the network. */
+enum WifiPath
+{
+  WIFI_PATH_CACHED, // the remembered access point and channel
+  WIFI_PATH_SCAN,   // a full scan, after a cached attempt failed or without one
+  WIFI_PATH_COUNT
+};
+
+/** Connection latency and radio time since boot. */
+struct WifiStats
+{
+  uint32_t connects[WIFI_PATH_COUNT];
+  uint32_t connectMs[WIFI_PATH_COUNT];    // summed, from wifiConnect() to the link
+  uint32_t maxConnectMs[WIFI_PATH_COUNT];
+  uint32_t fallbacks;                     // cached attempts that had to scan
+  uint32_t leaseReuses;                   // connects without DHCP
+  uint64_t radioOnMs;                     // from wifiConnect() to wifiDisconnect()
+};
+
 /**
- * @brief Tries to connect to WiFi using the stored SSID and password.
+ * @brief Reads the SSID and password from `path` (/wifi.json) into storage
+ * of the WiFi manager's own, where they stay for every later wifiConnect().
+ *
+ * @return false if the file is missing, not valid JSON, or a value is too
+ * long; the credentials are then left empty.
+ */
+bool wifiLoadCredentials(const char *path);
+
+/**
+ * @brief Tries to connect to WiFi using the SSID and password loaded by
+ * wifiLoadCredentials().
  *
  * @details
- * Sets WiFi mode to WIFI_STA, begins the connection with the stored SSID
- * and password, performs a network scan, and enables auto reconnect.
+ * Sets WiFi mode to WIFI_STA and begins the connection with the stored
+ * SSID and password: straight to the remembered access point if there is
+ * one, with a network scan otherwise, and enables auto reconnect.
  * Sets `isWifiConnecting` to true. Call this function to start a connection
  * attempt.
  */
@@ -32,11 +76,24 @@ void wifiDisconnect();
 
 void onWiFiConnected();
 
+/**
+ * Forgets the remembered network, so the next attempt scans and asks DHCP;
+ * for a link that connected but does not work, e.g. a stale lease.
+ */
+void wifiForgetNetwork();
+
+/** @return Totals since boot. */
+WifiStats wifiStats();
+
+/** Prints the connection latency of each path and the radio time on serial. */
+void wifiReport();
+
 /**
  * @brief Checks WiFi status and calls onWiFiConnected() if status has
  *        changed to connected, or handles disconnection.
  *
- * @details This function is meant to be called in the main loop.
+ * @details This function is meant to be called in the main loop. Also
+ * falls back to a scan when the remembered network does not answer.
  */
 void handleWifi();
 
@@ -0,0 +1,122 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+/*
+ * Host-native stand-in for the ESP32 Arduino core.
+ *
+ * Only the subset used by the firmware is provided. Time is virtual: millis()
+ * and micros() read the simulator clock, and delay() advances it instead of
+ * sleeping, so a 21-day incubation can be replayed in seconds of wall time.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <ctime>
+
+using std::fabs;
+using std::fmod;
+using std::isnan;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+
+#define PI 3.1415926535897932384626433832795
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+#define digitalPinToInterrupt(p) (p)
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+/* esp32-hal-time */
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char *server1,
+                const char *server2 = nullptr, const char *server3 = nullptr);
+bool getLocalTime(struct tm *info, uint32_t ms = 5000);
+
+class Print;
+
+class Printable
+{
+public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print &p) const = 0;
+};
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size)
+  {
+    size_t n = 0;
+    while (size--)
+      n += write(*buffer++);
+    return n;
+  }
+
+  size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int n) { return printf_("%d", n); }
+  size_t print(unsigned int n) { return printf_("%u", n); }
+  size_t print(long n) { return printf_("%ld", n); }
+  size_t print(unsigned long n) { return printf_("%lu", n); }
+  size_t print(double n, int digits = 2) { return printf_("%.*f", digits, n); }
+  size_t print(const Printable &p) { return p.printTo(*this); }
+
+  size_t println() { return print("\r\n"); }
+  template <typename T>
+  size_t println(T v)
+  {
+    size_t n = print(v);
+    return n + println();
+  }
+  size_t println(double v, int digits)
+  {
+    size_t n = print(v, digits);
+    return n + println();
+  }
+
+private:
+  size_t printf_(const char *fmt, ...);
+};
+
+class HardwareSerial : public Print
+{
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  size_t write(uint8_t c) override;
+  using Print::write;
+  int available();
+  int read();
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef SIM_LITTLEFS_H
+#define SIM_LITTLEFS_H
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs
+{
+
+struct FileData;
+
+/**
+ * Handle to a file of the in-memory flash image. Reads see a snapshot taken
+ * at open(); writes are committed to the image on close().
+ */
+class File : public Print
+{
+public:
+  File() {}
+  File(const std::string &path, FileData *data, bool writable, bool append);
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t size) override;
+  using Print::write;
+  int available();
+  int read();
+  size_t read(uint8_t *buf, size_t size);
+  size_t readBytes(char *buf, size_t size) { return read((uint8_t *)buf, size); }
+  bool seek(uint32_t pos);
+  size_t position() const { return pos; }
+  size_t size() const { return buffer.size(); }
+  void close();
+  operator bool() const { return data != nullptr; }
+
+private:
+  FileData *data = nullptr;
+  std::string path;
+  std::vector<uint8_t> buffer;
+  size_t pos = 0;
+  bool writable = false;
+};
+
+/**
+ * In-memory LittleFS. begin() seeds the image from the project's data/
+ * directory, the same files "Upload File System Image" would flash.
+ */
+class LittleFSFS
+{
+public:
+  bool begin(bool formatOnFail = false);
+  File open(const char *path, const char *mode = FILE_READ);
+  bool exists(const char *path);
+  bool remove(const char *path);
+  bool rename(const char *from, const char *to);
+
+  unsigned long bytesWritten = 0;
+  unsigned long writeOps = 0;
+};
+
+}
+
+using fs::File;
+extern fs::LittleFSFS LittleFS;
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+#include <Arduino.h>
+
+typedef enum
+{
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum
+{
+  WIFI_OFF = 0,
+  WIFI_STA = 1
+} wifi_mode_t;
+
+class IPAddress : public Printable
+{
+public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : octets{a, b, c, d} {}
+  explicit IPAddress(uint32_t address)
+      : octets{(uint8_t)address, (uint8_t)(address >> 8), (uint8_t)(address >> 16), (uint8_t)(address >> 24)} {}
+  uint8_t operator[](int i) const { return octets[i]; }
+  operator uint32_t() const
+  {
+    return octets[0] | (uint32_t)octets[1] << 8 | (uint32_t)octets[2] << 16 | (uint32_t)octets[3] << 24;
+  }
+  size_t printTo(Print &p) const override;
+
+private:
+  uint8_t octets[4];
+};
+
+/**
+ * Simulated station interface. Association succeeds a virtual delay after
+ * begin() while the simulated network is up (see sim/src/sim_main.cpp):
+ * shorter given the access point's channel and BSSID, never with stale ones.
+ */
+class WiFiClass
+{
+public:
+  bool mode(wifi_mode_t m);
+  wl_status_t begin(const char *ssid, const char *passphrase = nullptr, int32_t channel = 0,
+                    const uint8_t *bssid = nullptr, bool connect = true);
+  bool config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress());
+  bool disconnect(bool wifioff = false);
+  bool setAutoReconnect(bool autoReconnect);
+  int16_t scanNetworks(bool async = false);
+  wl_status_t status();
+  IPAddress localIP();
+  IPAddress gatewayIP();
+  IPAddress subnetMask();
+  IPAddress dnsIP(uint8_t index = 0);
+  uint8_t *BSSID();
+  int32_t channel();
+  /** Host build only: the DHCP lease (T0) of the link in s, 0 with a static IP; lwIP's on the ESP32. */
+  uint32_t dhcpLeaseTime();
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include <Arduino.h>
+
+#define I2C_BUFFER_LENGTH 128
+
+/**
+ * Simulated I2C master. Writes and reads are delivered to the devices
+ * attached with sim::attachI2c() and the virtual clock is charged the time
+ * the transfer takes on the wire at the configured bus clock.
+ */
+class TwoWire
+{
+public:
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+  bool setClock(uint32_t frequency);
+  uint32_t getClock() { return clock; }
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  size_t write(const uint8_t *data, size_t len);
+  uint8_t endTransmission(bool sendStop = true);
+  size_t requestFrom(uint8_t address, size_t len, bool sendStop = true);
+  int available() { return readLength - readAt; }
+  int read() { return readAt < readLength ? readBuffer[readAt++] : -1; }
+
+  unsigned long bytesSent = 0; // both directions, including address bytes
+  unsigned long transactions = 0;
+  uint64_t busMicros = 0;      // time the bus was busy
+
+private:
+  uint32_t clock = 100000;
+  uint8_t address = 0;
+  uint8_t buffer[I2C_BUFFER_LENGTH];
+  size_t length = 0;
+  uint8_t readBuffer[I2C_BUFFER_LENGTH];
+  size_t readLength = 0;
+  size_t readAt = 0;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef SIM_ESP_SNTP_H
+#define SIM_ESP_SNTP_H
+
+typedef enum
+{
+  SNTP_SYNC_STATUS_RESET,
+  SNTP_SYNC_STATUS_COMPLETED,
+  SNTP_SYNC_STATUS_IN_PROGRESS
+} sntp_sync_status_t;
+
+/**
+ * Reports COMPLETED once after the simulated NTP answer to the latest
+ * configTime() has arrived, then RESET again (same as ESP-IDF).
+ */
+sntp_sync_status_t sntp_get_sync_status(void);
+
+#endif
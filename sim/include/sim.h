@@ -0,0 +1,237 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <cstddef>
+#include <cstdint>
+#include "sensors.h"
+
+/*
+ * Simulator core shared by the Arduino stubs and the plant model.
+ */
+namespace sim
+{
+
+/** Virtual time since power-on, in microseconds. */
+extern uint64_t nowMicros;
+
+/** Unix time at virtual power-on; what NTP will report. */
+extern uint32_t epochAtBoot;
+
+/**
+ * ppm the device's uptime counter (esp_timer_get_time()) runs fast against
+ * true time, as an off-tolerance crystal would; negative runs slow.
+ */
+extern int32_t clockPpm;
+
+/** Whether the simulated access point is reachable. */
+extern bool networkUp;
+
+/** Whether NTP servers answer once associated; false models a bad uplink. */
+extern bool ntpUp;
+
+/**
+ * Virtual delays of a connection: the scan, skipped when WiFi.begin() is
+ * given the channel and BSSID, the association, and DHCP, skipped with a
+ * static IP from WiFi.config().
+ */
+extern uint32_t wifiScanMs;
+extern uint32_t wifiAssociateMs;
+extern uint32_t wifiDhcpMs;
+
+/** Lease time the simulated router grants over DHCP, in s. */
+extern uint32_t wifiLeaseS;
+
+/** Channel and last BSSID byte of the simulated access point; bumped when it moves. */
+extern uint8_t apChannel;
+extern uint8_t apId;
+
+/** Virtual delay between configTime() and the first NTP answer. */
+extern uint32_t ntpLatencyMs;
+
+/** Whether the sensors answer; false simulates disconnected ones. */
+extern bool sensorUp;
+
+/**
+ * Share of conversions that come out wrong but well-formed, checksum
+ * included, as a marginal supply or cable makes a real sensor do now and
+ * then. 0 (the default) leaves every reading clean.
+ */
+extern float sensorGlitchRate;
+
+/**
+ * Advances the virtual clock; used by delay() and by the run loop. Events
+ * scheduled inside the interval fire in order, each with the clock set to
+ * its own due time.
+ */
+void advance(uint64_t us);
+
+typedef void (*EventFn)(void *arg);
+
+/** Queues fn(arg) to run at the given virtual time. */
+void schedule(uint64_t at, EventFn fn, void *arg);
+
+/** Drops every queued event with this callback and argument. */
+void cancel(EventFn fn, void *arg);
+
+/** Level of a pin as seen by digitalRead(); inputs idle HIGH (pull-ups). */
+int pinLevel(uint8_t pin);
+
+/** Drives an input pin from the outside, e.g. a simulated button press. */
+void setInput(uint8_t pin, int level);
+
+/** Number of LOW/HIGH transitions written to an output pin. */
+unsigned long pinToggles(uint8_t pin);
+
+/** Lets a simulated device follow pinMode()/digitalWrite() on its pin. */
+typedef void (*PinHook)(uint8_t pin, uint8_t mode, int level);
+void hookPin(uint8_t pin, PinHook hook);
+
+/** Receives the bytes of one I2C write transaction; false for a NACK. */
+typedef bool (*I2cWriteFn)(void *device, const uint8_t *data, size_t len);
+/** Fills a read transaction; returns the bytes acknowledged, 0 for a NACK. */
+typedef size_t (*I2cReadFn)(void *device, uint8_t *data, size_t len);
+void attachI2c(uint8_t address, void *device, I2cWriteFn onWrite, I2cReadFn onRead = nullptr);
+
+/** Connects an HD44780 display behind a PCF8574 backpack at this address. */
+void attachLcd(uint8_t address);
+
+/** Text currently shown on a row of the simulated display. */
+const char *lcdRow(uint8_t row);
+
+/**
+ * Share of writes the simulated backpack cuts short with a NACK after a
+ * random number of their bytes, as a noisy or overloaded bus does. 0 (the
+ * default) acknowledges every write.
+ */
+extern float lcdNackRate;
+
+/** Writes lcdNackRate has cut short. */
+extern unsigned long lcdNacks;
+
+struct Plant;
+
+/** Connects a simulated DHT22 to the given data pin, measuring `source`. */
+void attachDht22(uint8_t pin, Plant &source);
+
+/** Conversions the simulated DHT22s have answered. */
+extern unsigned long dhtFrames;
+
+/** Connects a simulated SHT3x, SHT4x or BME280 at this I2C address, measuring `source`. */
+void attachI2cSensor(SensorType type, uint8_t address, Plant &source);
+
+/** Conversions the simulated I2C sensors have completed. */
+extern unsigned long i2cSensorConversions;
+
+/** Motor sessions closer than this are one motion, e.g. homing then levelling. */
+static const uint64_t TRAY_MOTION_GAP_US = 10000000;
+static const int TRAY_MAX_MOTIONS = 256;
+
+struct TrayStats
+{
+  unsigned long steps;                // followed by the tray
+  int motions;
+  uint64_t startedAt[TRAY_MAX_MOTIONS]; // virtual time of the first step or DC tick, per motion
+};
+
+/**
+ * Connects a simulated egg tray to the turner's pins (pins.h), resting on
+ * the end-stop: moved by a stepper over `travel` steps, or by a DC motor
+ * over `travel` ms.
+ */
+void attachTray(bool dc, uint32_t travel);
+
+/** Where the tray is: 0 on the home side, 1 on the other. */
+float trayPosition();
+
+/** While set, the tray no longer follows the motor. */
+extern bool trayJammed;
+extern TrayStats trayStats;
+
+/**
+ * Lumped model of the incubator chamber.
+ *
+ * Air temperature follows a first-order balance between the heater, whose
+ * output lags the relay through the bulb's own thermal mass, and losses to a
+ * room whose temperature swings over the day. Relative humidity rises while
+ * the humidifier runs and decays towards the room's humidity through the
+ * ventilation holes.
+ */
+struct Plant
+{
+  uint8_t heaterPin;
+  uint8_t humidifierPin;
+
+  float roomTemp = 22.0;        // mean room temperature, C
+  float roomSwing = 2.0;        // daily room temperature amplitude, C
+  float roomHumidity = 45.0;    // %RH
+  float heaterGain = 0.03;      // C/s at full heater output
+  float heaterLag = 20.0;       // s, bulb warm-up time constant
+  float lossCoeff = 0.00129;    // 1/s towards room temperature
+  float humidifierGain = 0.04;  // %RH/s while the humidifier runs
+  float ventCoeff = 0.0014;     // 1/s towards room humidity
+
+  float temp = 22.0;
+  float humidity = 45.0;
+  float heaterOutput = 0.0;     // 0..1, lagged relay state
+
+  /** Integrates the model from its last update up to nowMicros. */
+  void update();
+  float ambient() const;
+
+  uint64_t lastUpdate = 0;
+};
+
+/** One model per simulated chamber; plant is the primary chamber's. */
+static const int MAX_PLANTS = 8;
+extern Plant plants[MAX_PLANTS];
+extern Plant &plant;
+
+/**
+ * Times the LCD row formatters against the former sprintf() path and
+ * checks both produce the same rows. @return 0 if they all match.
+ */
+int benchFormat();
+
+/**
+ * Load-tests the telemetry server over localhost sockets with `websockets`
+ * WebSocket clients connected. @return 0 if every reply was right.
+ */
+int benchTelemetry(int websockets);
+
+/**
+ * Times the control sweep and a DHT22 decode for 1 to MAX_CHAMBERS
+ * chambers and works out how many one core could keep up with.
+ */
+int benchChambers();
+
+/**
+ * Decodes recorded DHT22 pulse trains (good, negative, bad checksum,
+ * truncated, no reply) and checks status and values. @return 0 if all pass.
+ */
+int testDht();
+
+/**
+ * Times loading the configuration by parsing config.json and from its
+ * binary image, and checks both agree. @return 0 if they do.
+ */
+int benchConfig();
+
+/** Deterministic noise source so runs are repeatable for a given seed. */
+float gaussian();
+
+/** Uniform in [0, 1), from the same source. */
+float uniform();
+
+/**
+ * Glitches one conversion out of 1 / sensorGlitchRate: one of the two
+ * values is off by a flipped bit of its 0.1 resolution, 0.8 to 51.2.
+ */
+void glitch(float &temp, float &humidity);
+
+/** Readings glitch() has spoilt. */
+extern unsigned long sensorGlitches;
+void seed(uint32_t s);
+
+}
+
+#endif
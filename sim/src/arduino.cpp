@@ -0,0 +1,387 @@
+#include <Arduino.h>
+#include <esp_sntp.h>
+#include <esp_timer.h>
+#include <cstdarg>
+#include <queue>
+#include <vector>
+#include "sim.h"
+
+namespace sim
+{
+
+uint64_t nowMicros = 0;
+uint32_t epochAtBoot = 1760000000;
+int32_t clockPpm = 0;
+bool networkUp = true;
+bool ntpUp = true;
+uint32_t wifiScanMs = 2000;     // all channels
+uint32_t wifiAssociateMs = 150; // authentication and WPA2 handshake
+uint32_t wifiDhcpMs = 850;
+uint32_t wifiLeaseS = 86400; // a day, as most home routers grant
+uint8_t apChannel = 6;
+uint8_t apId = 1;
+uint32_t ntpLatencyMs = 800;
+bool sensorUp = true;
+float sensorGlitchRate = 0;
+
+static const uint8_t PIN_COUNT = 40;
+static uint8_t modes[PIN_COUNT];
+static uint8_t levels[PIN_COUNT];
+static unsigned long toggles[PIN_COUNT];
+static bool levelsInitialised = false;
+
+static void (*isrs[PIN_COUNT])(void);
+static void (*argIsrs[PIN_COUNT])(void *);
+static void *isrArgs[PIN_COUNT];
+static int isrModes[PIN_COUNT];
+static PinHook hooks[PIN_COUNT];
+
+static uint64_t ntpRequestedAt = 0;
+static bool ntpRequested = false;
+static bool clockSet = false;
+static bool syncCompleted = false;
+
+extern bool wifiAssociated();
+
+struct Event
+{
+  uint64_t at;
+  uint64_t order; // FIFO among events due at the same time
+  EventFn fn;
+  void *arg;
+  bool operator>(const Event &o) const { return at != o.at ? at > o.at : order > o.order; }
+};
+
+static std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+static uint64_t eventOrder = 0;
+
+void schedule(uint64_t at, EventFn fn, void *arg)
+{
+  events.push({at, eventOrder++, fn, arg});
+}
+
+void cancel(EventFn fn, void *arg)
+{
+  std::vector<Event> keep;
+  while (!events.empty())
+  {
+    if (events.top().fn != fn || events.top().arg != arg)
+      keep.push_back(events.top());
+    events.pop();
+  }
+  for (const Event &e : keep)
+    events.push(e);
+}
+
+static void backgroundTasks()
+{
+  // The SNTP client runs in the background on the real chip.
+  if (ntpRequested && ntpUp && wifiAssociated() &&
+      nowMicros - ntpRequestedAt >= (uint64_t)ntpLatencyMs * 1000)
+  {
+    clockSet = true;
+    syncCompleted = true;
+    ntpRequested = false;
+  }
+}
+
+void advance(uint64_t us)
+{
+  uint64_t target = nowMicros + us;
+  while (!events.empty() && events.top().at <= target)
+  {
+    Event e = events.top();
+    events.pop();
+    if (e.at > nowMicros)
+      nowMicros = e.at;
+    e.fn(e.arg);
+  }
+  nowMicros = target;
+  backgroundTasks();
+}
+
+static void initLevels()
+{
+  if (levelsInitialised)
+    return;
+  for (uint8_t i = 0; i < PIN_COUNT; i++)
+    levels[i] = HIGH;
+  levelsInitialised = true;
+}
+
+int pinLevel(uint8_t pin)
+{
+  initLevels();
+  return pin < PIN_COUNT ? levels[pin] : LOW;
+}
+
+static void fireIsr(uint8_t pin, int from, int to)
+{
+  if ((!isrs[pin] && !argIsrs[pin]) || from == to)
+    return;
+  int mode = isrModes[pin];
+  if (!(mode == CHANGE || (mode == RISING && to == HIGH) || (mode == FALLING && to == LOW)))
+    return;
+  if (isrs[pin])
+    isrs[pin]();
+  else
+    argIsrs[pin](isrArgs[pin]);
+}
+
+void setInput(uint8_t pin, int level)
+{
+  initLevels();
+  if (pin >= PIN_COUNT)
+    return;
+  int previous = levels[pin];
+  levels[pin] = level;
+  fireIsr(pin, previous, level);
+}
+
+void hookPin(uint8_t pin, PinHook hook)
+{
+  if (pin < PIN_COUNT)
+    hooks[pin] = hook;
+}
+
+unsigned long pinToggles(uint8_t pin)
+{
+  return pin < PIN_COUNT ? toggles[pin] : 0;
+}
+
+void requestNtp()
+{
+  ntpRequested = true;
+  ntpRequestedAt = nowMicros;
+}
+
+}
+
+using namespace sim;
+
+HardwareSerial Serial;
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  initLevels();
+  if (pin >= PIN_COUNT)
+    return;
+  uint8_t previousMode = modes[pin];
+  modes[pin] = mode;
+  if (mode == OUTPUT)
+    levels[pin] = LOW;
+  else if (mode == INPUT_PULLUP && previousMode == OUTPUT)
+    setInput(pin, HIGH); // released line floats back up
+  if (hooks[pin])
+    hooks[pin](pin, mode, levels[pin]);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  initLevels();
+  if (pin >= PIN_COUNT)
+    return;
+  uint8_t level = val ? HIGH : LOW;
+  if (levels[pin] != level)
+    toggles[pin]++;
+  levels[pin] = level;
+  if (hooks[pin])
+    hooks[pin](pin, modes[pin], level);
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode)
+{
+  if (pin >= PIN_COUNT)
+    return;
+  isrs[pin] = isr;
+  argIsrs[pin] = nullptr;
+  isrModes[pin] = mode;
+}
+
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode)
+{
+  if (pin >= PIN_COUNT)
+    return;
+  isrs[pin] = nullptr;
+  argIsrs[pin] = isr;
+  isrArgs[pin] = arg;
+  isrModes[pin] = mode;
+}
+
+void detachInterrupt(uint8_t pin)
+{
+  if (pin < PIN_COUNT)
+  {
+    isrs[pin] = nullptr;
+    argIsrs[pin] = nullptr;
+  }
+}
+
+int digitalRead(uint8_t pin)
+{
+  return pinLevel(pin);
+}
+
+// unsigned long is 64-bit on the host, so unlike on the ESP32 these do not
+// wrap: truncating them would break the firmware's unsigned interval maths.
+unsigned long millis()
+{
+  return (unsigned long)(nowMicros / 1000);
+}
+
+unsigned long micros()
+{
+  return (unsigned long)nowMicros;
+}
+
+void delay(uint32_t ms)
+{
+  // Step in small increments so background events (association, SNTP)
+  // resolve at the right moment, just like on the real scheduler.
+  while (ms--)
+    advance(1000);
+}
+
+void delayMicroseconds(uint32_t us)
+{
+  advance(us);
+}
+
+/* esp_timer */
+
+struct esp_timer
+{
+  esp_timer_cb_t callback;
+  void *arg;
+  uint64_t period; // 0 for one-shot
+};
+
+static void fireTimer(void *arg)
+{
+  esp_timer *timer = (esp_timer *)arg;
+  if (timer->period)
+    schedule(nowMicros + timer->period, fireTimer, timer);
+  timer->callback(timer->arg);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+  *out = new esp_timer{args->callback, args->arg, 0};
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs)
+{
+  cancel(fireTimer, timer);
+  timer->period = 0;
+  schedule(nowMicros + timeoutUs, fireTimer, timer);
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs)
+{
+  cancel(fireTimer, timer);
+  timer->period = periodUs;
+  schedule(nowMicros + periodUs, fireTimer, timer);
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+  cancel(fireTimer, timer);
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+  cancel(fireTimer, timer);
+  delete timer;
+  return ESP_OK;
+}
+
+int64_t esp_timer_get_time()
+{
+  return (int64_t)nowMicros + (int64_t)nowMicros * clockPpm / 1000000;
+}
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char *server1,
+                const char *server2, const char *server3)
+{
+  (void)gmtOffsetSec;
+  (void)daylightOffsetSec;
+  (void)server1;
+  (void)server2;
+  (void)server3;
+  requestNtp();
+}
+
+sntp_sync_status_t sntp_get_sync_status(void)
+{
+  if (!syncCompleted)
+    return ntpRequested ? SNTP_SYNC_STATUS_IN_PROGRESS : SNTP_SYNC_STATUS_RESET;
+  syncCompleted = false;
+  return SNTP_SYNC_STATUS_COMPLETED;
+}
+
+bool getLocalTime(struct tm *info, uint32_t ms)
+{
+  // Same contract as esp32-hal-time: poll every 10 ms until the clock has
+  // been set or the timeout expires.
+  uint32_t waited = 0;
+  while (!clockSet)
+  {
+    if (waited >= ms)
+      return false;
+    delay(10);
+    waited += 10;
+  }
+
+  time_t now = (time_t)epochAtBoot + (time_t)(nowMicros / 1000000);
+  gmtime_r(&now, info);
+  return true;
+}
+
+static bool lineStart = true;
+bool serialQuiet = false;
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  if (serialQuiet)
+    return 1;
+
+  if (lineStart)
+  {
+    uint64_t s = nowMicros / 1000000;
+    printf("[d%02u %02u:%02u:%02u] ", (unsigned)(s / 86400), (unsigned)(s / 3600 % 24),
+           (unsigned)(s / 60 % 60), (unsigned)(s % 60));
+    lineStart = false;
+  }
+  if (c == '\r')
+    return 1;
+  putchar(c);
+  if (c == '\n')
+    lineStart = true;
+  return 1;
+}
+
+int HardwareSerial::available()
+{
+  return 0;
+}
+
+int HardwareSerial::read()
+{
+  return -1;
+}
+
+size_t Print::printf_(const char *fmt, ...)
+{
+  char buffer[64];
+  va_list args;
+  va_start(args, fmt);
+  int len = vsnprintf(buffer, sizeof(buffer), fmt, args);
+  va_end(args);
+  if (len < 0)
+    return 0;
+  return write((const uint8_t *)buffer, (size_t)len < sizeof(buffer) ? len : sizeof(buffer) - 1);
+}
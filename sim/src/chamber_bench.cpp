@@ -0,0 +1,115 @@
+/*
+ * Cost of servicing N chambers, run with --bench-chambers: times the
+ * control sweep (chambers.h) and the decode of one DHT22 frame, the CPU
+ * work each reading brings, for 1 to MAX_CHAMBERS chambers, and works out
+ * how many chambers one core keeps up with at the control cadence.
+ */
+
+#include <Arduino.h>
+#include <chrono>
+#include "chambers.h"
+#include "dht_reader.h"
+#include "sim.h"
+
+extern Chambers chambers;
+
+namespace sim
+{
+
+static const int BENCH_SWEEPS = 2000000;
+static const int BENCH_DECODES = 1000000;
+static const unsigned long CADENCE_MS = 10000; // one reading per chamber, as DHT_DELAY
+static const unsigned long STEPS_PER_CADENCE = 10; // countdown ticks besides the readings
+static const double FRAME_MS = 8;               // start pulse and reply window, conversions run one at a time
+static const uint8_t GPIO_FREE = 20;           // ESP32 GPIOs that can drive and read, without flash, input-only and UART0
+static const uint8_t GPIO_SHARED = 6;          // buttons, I2C, buzzer, pause LED
+
+/** Pulse train of a DHT22 frame reading `temp` and `humidity`. */
+static uint8_t framePulses(uint16_t *pulses, float temp, float humidity)
+{
+  uint16_t rawHumidity = lroundf(humidity * 10), rawTemp = lroundf(temp * 10);
+  uint8_t bytes[5] = {(uint8_t)(rawHumidity >> 8), (uint8_t)rawHumidity, (uint8_t)(rawTemp >> 8), (uint8_t)rawTemp, 0};
+  bytes[4] = bytes[0] + bytes[1] + bytes[2] + bytes[3];
+  uint8_t count = 0;
+  pulses[count++] = 80;
+  pulses[count++] = 80;
+  for (uint8_t bit = 0; bit < 40; bit++)
+  {
+    pulses[count++] = 50;
+    pulses[count++] = bytes[bit / 8] & (0x80 >> (bit % 8)) ? 70 : 26;
+  }
+  pulses[count++] = 50;
+  return count;
+}
+
+int benchChambers()
+{
+  using Clock = std::chrono::steady_clock;
+
+  uint16_t pulses[DHT_MAX_PULSES];
+  uint8_t pulseCount = framePulses(pulses, 37.4f, 55.2f);
+  DhtSample sample;
+  Clock::time_point start = Clock::now();
+  unsigned long decoded = 0;
+  for (int i = 0; i < BENCH_DECODES; i++)
+  {
+    pulses[2 + 2 * 39 + 1] = i & 1 ? 70 : 26; // keep the compiler from hoisting it, checksum off every other frame
+    decoded += dhtDecode(pulses, pulseCount, sample) == DHT_OK;
+  }
+  double decodeNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / BENCH_DECODES;
+
+  printf("%-10s %12s %14s %22s\n", "Chambers", "Sweep", "Per chamber", "CPU per 10 s cadence");
+  double perChamberNs = 0;
+  for (uint8_t count = 1; count <= MAX_CHAMBERS; count++)
+  {
+    chambers = {};
+    for (uint8_t i = 0; i < count; i++)
+    {
+      chambersAdd({(uint8_t)(3 * i), (uint8_t)(3 * i + 1), (uint8_t)(3 * i + 2)}, nullptr, 0);
+      chambers.tempTarget[i] = 37.5f;
+      chambers.tempHyst[i] = 0.3f;
+      chambers.humidityTarget[i] = 55;
+      chambers.humidityHyst[i] = 2.5f;
+      chambers.day[i] = 1;
+    }
+    chambers.running = (ChamberMask)((1u << count) - 1);
+    // one chamber without a sensor, on the failsafe estimate
+    chambers.readAt[count - 1] = 0;
+
+    unsigned long now = 100000;
+    start = Clock::now();
+    for (int n = 0; n < BENCH_SWEEPS; n++)
+    {
+      // readings wander through the bands so relays do switch
+      uint8_t i = n % count;
+      if (i != count - 1 || count == 1)
+      {
+        chambers.temp[i] = 37.0f + (n >> 4 & 15) * 0.07f;
+        chambers.humidity[i] = 52.0f + (n >> 5 & 7) * 0.8f;
+        chambers.readAt[i] = now;
+      }
+      chambersSweep(now++, 60000, 0.01f, 0.02f);
+    }
+    double sweepNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / BENCH_SWEEPS;
+
+    // every reading wakes the control task for a decode and a sweep, and
+    // the countdown does once a second
+    double cadenceNs = (STEPS_PER_CADENCE + count) * sweepNs + count * decodeNs;
+    perChamberNs = cadenceNs / count;
+    printf("%-10u %9.1f ns %11.1f ns %14.2f us, %.5f%%\n", count, sweepNs, sweepNs / count, cadenceNs / 1000,
+           cadenceNs / (CADENCE_MS * 1e4));
+  }
+
+  printf("\n%-28s %.1f ns per frame (%lu good)\n", "DHT22 decode", decodeNs, decoded);
+  printf("%-28s %.1e chambers per core on this host at %lu s, extrapolated\n", "CPU bound", CADENCE_MS * 1e6 / perChamberNs,
+         CADENCE_MS / 1000);
+  printf("%-28s %.0f chambers, one %.0f ms conversion after the other\n", "DHT22 bound", CADENCE_MS / FRAME_MS,
+         FRAME_MS);
+  printf("%-28s %u chambers, 3 pins each next to %u shared ones\n", "GPIO bound (ESP32)", (GPIO_FREE - GPIO_SHARED) / 3,
+         GPIO_SHARED);
+  printf("%-28s %u chambers (ChamberMask is %u bits)\n", "Build limit", MAX_CHAMBERS, (unsigned)(8 * sizeof(ChamberMask)));
+  chambers = {};
+  return 0;
+}
+
+}
@@ -0,0 +1,70 @@
+/*
+ * Cost of loading the configuration at boot, run with --bench-config:
+ * times configLoad() parsing config.json against reading the binary image
+ * it leaves behind (config_store.h), and checks both give the same Config.
+ */
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <chrono>
+#include <string.h>
+#include "config_store.h"
+#include "sim.h"
+
+namespace sim
+{
+
+static const int BENCH_LOADS = 20000;
+
+/** @return Size of the file at `path` on the flash image, 0 if missing. */
+static size_t fileSize(const char *path)
+{
+  File file = LittleFS.open(path, FILE_READ);
+  size_t size = file ? file.size() : 0;
+  file.close();
+  return size;
+}
+
+int benchConfig()
+{
+  LittleFS.begin();
+  if (!LittleFS.exists("/config.json"))
+  {
+    printf("No data/config.json, run from the project directory\n");
+    return 1;
+  }
+
+  // a parse leaves the image, the next load reads it back
+  LittleFS.remove("/config.bin");
+  Config parsed, cached;
+  ConfigLoad first = configLoad(parsed);
+  ConfigLoad second = configLoad(cached);
+  bool same = first == CONFIG_PARSED && second == CONFIG_CACHED && !memcmp(&parsed, &cached, sizeof(Config));
+  printf("%-20s %s\n", "Output check", same ? "image matches config.json" : "image differs from config.json");
+  printf("%-20s config.json %zu bytes, config.bin %zu bytes (Config %zu)\n", "Flash read",
+         fileSize("/config.json"), fileSize("/config.bin"), sizeof(Config));
+
+  using Clock = std::chrono::steady_clock;
+  Config config;
+
+  double parseNs = 0;
+  for (int i = 0; i < BENCH_LOADS; i++)
+  {
+    LittleFS.remove("/config.bin");
+    Clock::time_point t0 = Clock::now();
+    configLoad(config);
+    parseNs += std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+  }
+  parseNs /= BENCH_LOADS;
+
+  Clock::time_point t0 = Clock::now();
+  for (int i = 0; i < BENCH_LOADS; i++)
+    configLoad(config);
+  double cachedNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / BENCH_LOADS;
+
+  printf("%-20s %.2f us per boot, image rewritten\n", "Parse config.json", parseNs / 1000);
+  printf("%-20s %.2f us per boot (%.1fx faster)\n", "Read image", cachedNs / 1000, parseNs / cachedNs);
+  return same ? 0 : 1;
+}
+
+}
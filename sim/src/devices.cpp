@@ -0,0 +1,269 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <LittleFS.h>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include "sim.h"
+
+/* WiFi */
+
+WiFiClass WiFi;
+
+namespace sim
+{
+
+static bool wifiOn = false;
+static uint64_t wifiBeganAt = 0;
+static uint32_t wifiDelayMs = 0;     // of the attempt in progress
+static bool wifiStaleAp = false;     // begun on a channel or BSSID the access point no longer has
+static IPAddress staticIp;           // from config(), 0 for DHCP
+static uint8_t bssid[6] = {0x24, 0x4b, 0xfe, 0x10, 0x20, 0};
+
+bool wifiAssociated()
+{
+  return wifiOn && networkUp && !wifiStaleAp && nowMicros - wifiBeganAt >= (uint64_t)wifiDelayMs * 1000;
+}
+
+}
+
+bool WiFiClass::mode(wifi_mode_t m)
+{
+  if (m == WIFI_OFF)
+    sim::wifiOn = false;
+  return true;
+}
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *passphrase, int32_t channel, const uint8_t *bssid,
+                             bool connect)
+{
+  (void)ssid;
+  (void)passphrase;
+  (void)connect;
+  bool direct = channel && bssid;
+  sim::wifiOn = true;
+  sim::wifiBeganAt = sim::nowMicros;
+  sim::wifiStaleAp = direct && (channel != sim::apChannel || bssid[5] != sim::apId);
+  sim::wifiDelayMs = (direct ? 0 : sim::wifiScanMs) + sim::wifiAssociateMs +
+                     ((uint32_t)sim::staticIp ? 0 : sim::wifiDhcpMs);
+  return WL_DISCONNECTED;
+}
+
+bool WiFiClass::config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1)
+{
+  (void)gateway;
+  (void)subnet;
+  (void)dns1;
+  sim::staticIp = local;
+  return true;
+}
+
+bool WiFiClass::disconnect(bool wifioff)
+{
+  if (wifioff)
+    sim::wifiOn = false;
+  return true;
+}
+
+bool WiFiClass::setAutoReconnect(bool autoReconnect)
+{
+  (void)autoReconnect;
+  return true;
+}
+
+int16_t WiFiClass::scanNetworks(bool async)
+{
+  (void)async;
+  return 1;
+}
+
+wl_status_t WiFiClass::status()
+{
+  if (!sim::wifiOn)
+    return WL_DISCONNECTED;
+  if (!sim::networkUp)
+    return WL_NO_SSID_AVAIL;
+  return sim::wifiAssociated() ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+IPAddress WiFiClass::localIP()
+{
+  if (!sim::wifiAssociated())
+    return IPAddress();
+  return (uint32_t)sim::staticIp ? sim::staticIp : IPAddress(192, 168, 1, 50);
+}
+
+IPAddress WiFiClass::gatewayIP()
+{
+  return sim::wifiAssociated() ? IPAddress(192, 168, 1, 1) : IPAddress();
+}
+
+IPAddress WiFiClass::subnetMask()
+{
+  return sim::wifiAssociated() ? IPAddress(255, 255, 255, 0) : IPAddress();
+}
+
+IPAddress WiFiClass::dnsIP(uint8_t index)
+{
+  (void)index;
+  return sim::wifiAssociated() ? IPAddress(192, 168, 1, 1) : IPAddress();
+}
+
+uint8_t *WiFiClass::BSSID()
+{
+  if (!sim::wifiAssociated())
+    return nullptr;
+  sim::bssid[5] = sim::apId;
+  return sim::bssid;
+}
+
+int32_t WiFiClass::channel()
+{
+  return sim::wifiAssociated() ? sim::apChannel : 0;
+}
+
+uint32_t WiFiClass::dhcpLeaseTime()
+{
+  return sim::wifiAssociated() && !(uint32_t)sim::staticIp ? sim::wifiLeaseS : 0;
+}
+
+size_t IPAddress::printTo(Print &p) const
+{
+  size_t n = 0;
+  for (int i = 0; i < 4; i++)
+  {
+    if (i)
+      n += p.print('.');
+    n += p.print((unsigned int)octets[i]);
+  }
+  return n;
+}
+
+/* LittleFS */
+
+fs::LittleFSFS LittleFS;
+
+namespace fs
+{
+
+struct FileData
+{
+  std::vector<uint8_t> bytes;
+};
+
+static std::map<std::string, FileData> image;
+static bool seeded = false;
+
+File::File(const std::string &path, FileData *data, bool writable, bool append)
+    : data(data), path(path), writable(writable)
+{
+  if (!writable || append)
+    buffer = data->bytes;
+  pos = append ? buffer.size() : 0;
+}
+
+size_t File::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buf, size_t size)
+{
+  if (!data || !writable)
+    return 0;
+  buffer.insert(buffer.end(), buf, buf + size);
+  pos = buffer.size();
+  LittleFS.bytesWritten += size;
+  return size;
+}
+
+int File::available()
+{
+  return data && !writable ? (int)(buffer.size() - pos) : 0;
+}
+
+int File::read()
+{
+  if (!data || pos >= buffer.size())
+    return -1;
+  return buffer[pos++];
+}
+
+size_t File::read(uint8_t *buf, size_t size)
+{
+  size_t n = 0;
+  while (n < size && pos < buffer.size())
+    buf[n++] = buffer[pos++];
+  return n;
+}
+
+bool File::seek(uint32_t p)
+{
+  if (p > buffer.size())
+    return false;
+  pos = p;
+  return true;
+}
+
+void File::close()
+{
+  if (data && writable)
+  {
+    image[path].bytes = buffer;
+    LittleFS.writeOps++;
+  }
+  data = nullptr;
+}
+
+bool LittleFSFS::begin(bool formatOnFail)
+{
+  (void)formatOnFail;
+  if (seeded)
+    return true;
+
+  const char *files[] = {"config.json", "wifi.json"};
+  for (const char *name : files)
+  {
+    std::ifstream in(std::string("data/") + name, std::ios::binary);
+    if (!in)
+      continue;
+    image["/" + std::string(name)].bytes.assign(std::istreambuf_iterator<char>(in), {});
+  }
+  seeded = true;
+  return true;
+}
+
+File LittleFSFS::open(const char *path, const char *mode)
+{
+  bool writable = mode[0] == 'w' || mode[0] == 'a';
+  auto it = image.find(path);
+  if (it == image.end())
+  {
+    if (!writable)
+      return File();
+    it = image.emplace(path, FileData()).first;
+  }
+  return File(path, &it->second, writable, mode[0] == 'a');
+}
+
+bool LittleFSFS::exists(const char *path)
+{
+  return image.count(path) != 0;
+}
+
+bool LittleFSFS::remove(const char *path)
+{
+  return image.erase(path) != 0;
+}
+
+bool LittleFSFS::rename(const char *from, const char *to)
+{
+  auto it = image.find(from);
+  if (it == image.end())
+    return false;
+  image[to] = it->second;
+  image.erase(from);
+  return true;
+}
+
+}
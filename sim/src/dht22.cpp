@@ -0,0 +1,116 @@
+#include <Arduino.h>
+#include "sim.h"
+
+/*
+ * Simulated DHT22 on a single-wire bus.
+ *
+ * Watches its data pin: once the host has held it low for at least 1 ms and
+ * released it, the sensor schedules its reply as real edges on the virtual
+ * clock (response, 40 data bits, tail), with a few microseconds of jitter, so
+ * the firmware's interrupt-driven capture and decoder run for real.
+ */
+
+namespace sim
+{
+
+unsigned long dhtFrames = 0;
+
+struct Dht22
+{
+  uint8_t pin;
+  Plant *source;
+  bool drivenLow;
+  uint64_t lowSince;
+};
+
+static Dht22 sensors[MAX_PLANTS];
+static uint8_t sensorCount = 0;
+
+static void lineLow(void *arg)
+{
+  setInput(((Dht22 *)arg)->pin, LOW);
+}
+
+static void lineHigh(void *arg)
+{
+  setInput(((Dht22 *)arg)->pin, HIGH);
+}
+
+static uint64_t jittered(uint64_t t, uint32_t us)
+{
+  float j = gaussian() * 1.5f;
+  return t + (uint64_t)(us + (j > -10 ? j : -10));
+}
+
+static void reply(Dht22 &sensor)
+{
+  Plant &plant = *sensor.source;
+  plant.update();
+  float t = plant.temp + gaussian() * 0.05f;
+  float h = plant.humidity + gaussian() * 0.3f;
+  glitch(t, h);
+  if (h > 99.9f)
+    h = 99.9f;
+  if (h < 0)
+    h = 0;
+
+  uint16_t rawHumidity = (uint16_t)lroundf(h * 10);
+  uint16_t rawTemp = (uint16_t)lroundf(fabsf(t) * 10);
+  if (t < 0)
+    rawTemp |= 0x8000;
+
+  uint8_t bytes[5] = {(uint8_t)(rawHumidity >> 8), (uint8_t)rawHumidity, (uint8_t)(rawTemp >> 8), (uint8_t)rawTemp, 0};
+  bytes[4] = bytes[0] + bytes[1] + bytes[2] + bytes[3];
+
+  uint64_t at = jittered(nowMicros, 30);
+  schedule(at, lineLow, &sensor);
+  at = jittered(at, 80);
+  schedule(at, lineHigh, &sensor);
+  at = jittered(at, 80);
+
+  for (uint8_t bit = 0; bit < 40; bit++)
+  {
+    bool one = bytes[bit / 8] & (0x80 >> (bit % 8));
+    schedule(at, lineLow, &sensor);
+    at = jittered(at, 50);
+    schedule(at, lineHigh, &sensor);
+    at = jittered(at, one ? 70 : 26);
+  }
+
+  schedule(at, lineLow, &sensor);
+  schedule(jittered(at, 50), lineHigh, &sensor);
+  dhtFrames++;
+}
+
+static void onDataPin(uint8_t pin, uint8_t mode, int level)
+{
+  Dht22 *sensor = sensors;
+  while (sensor < sensors + sensorCount && sensor->pin != pin)
+    sensor++;
+  if (sensor == sensors + sensorCount)
+    return;
+
+  if (mode == OUTPUT)
+  {
+    if (level == LOW && !sensor->drivenLow)
+      sensor->lowSince = nowMicros;
+    sensor->drivenLow = level == LOW;
+    return;
+  }
+
+  // line released by the host
+  bool started = sensor->drivenLow && nowMicros - sensor->lowSince >= 800;
+  sensor->drivenLow = false;
+  if (started && sensorUp)
+    reply(*sensor);
+}
+
+void attachDht22(uint8_t pin, Plant &source)
+{
+  if (sensorCount == MAX_PLANTS)
+    return;
+  sensors[sensorCount++] = {pin, &source, false, 0};
+  hookPin(pin, onDataPin);
+}
+
+}
@@ -0,0 +1,206 @@
+/*
+ * DHT22 capture check, run with --test-dht: replays edge captures on the
+ * simulated data line through the firmware's own path, that is the start
+ * pulse of dhtStart(), the timestamps of the edge interrupt and the framing
+ * and decoding of dhtPoll(), and checks the status and the values read
+ * from each.
+ *
+ * A capture lists the line's transitions in us, as a logic analyser
+ * exports them: the host pulling the line low and releasing it, then the
+ * sensor's 80/80 us response and 40 bits, each a ~50 us low and a 26 or
+ * 70 us high, then the tail. The sensor's edges are replayed from the
+ * firmware's actual release, as long after it as in the capture.
+ */
+
+#include <Arduino.h>
+#include <math.h>
+#include "dht_reader.h"
+#include "pins.h"
+#include "sim.h"
+
+namespace sim
+{
+
+#define DHT_TEST_TIMEOUT_US 20000 // a conversion still pending after this is a failure
+
+// 55.2 %RH, 37.4 C
+static const uint16_t GOOD[] = {
+    0, 1100, 1127, 1207, 1287, 1341, 1369, 1417, 1440, 1496, 1519, 1572,
+    1599, 1647, 1674, 1725, 1748, 1797, 1868, 1922, 1945, 1996, 2019, 2075,
+    2101, 2149, 2223, 2272, 2296, 2344, 2416, 2470, 2493, 2544, 2567, 2623,
+    2652, 2702, 2727, 2781, 2805, 2861, 2884, 2936, 2963, 3013, 3036, 3087,
+    3112, 3161, 3188, 3237, 3309, 3357, 3384, 3435, 3506, 3562, 3633, 3686,
+    3757, 3812, 3837, 3889, 3958, 4008, 4081, 4132, 4155, 4207, 4279, 4334,
+    4359, 4414, 4484, 4533, 4556, 4612, 4638, 4688, 4717, 4770, 4794, 4849,
+    4920, 4968,
+};
+
+// 48.5 %RH, -10.1 C: the sign bit set in the temperature's high byte
+static const uint16_t NEGATIVE[] = {
+    0, 1100, 1131, 1214, 1293, 1349, 1376, 1429, 1454, 1507, 1534, 1589,
+    1616, 1671, 1694, 1743, 1768, 1823, 1851, 1900, 1968, 2020, 2093, 2148,
+    2218, 2272, 2345, 2398, 2421, 2476, 2501, 2551, 2623, 2672, 2698, 2746,
+    2815, 2867, 2936, 2987, 3013, 3067, 3096, 3151, 3174, 3224, 3250, 3304,
+    3331, 3383, 3407, 3461, 3490, 3546, 3571, 3625, 3695, 3749, 3818, 3868,
+    3891, 3941, 3965, 4016, 4089, 4140, 4163, 4218, 4292, 4342, 4412, 4464,
+    4532, 4582, 4608, 4664, 4689, 4742, 4811, 4867, 4894, 4942, 5013, 5069,
+    5140, 5194,
+};
+
+// 54.0 %RH, 37.7 C, checksum off by 4
+static const uint16_t CHECKSUM[] = {
+    0, 1100, 1124, 1205, 1289, 1338, 1364, 1418, 1441, 1492, 1515, 1566,
+    1592, 1642, 1665, 1718, 1745, 1793, 1861, 1909, 1936, 1986, 2013, 2062,
+    2087, 2135, 2158, 2209, 2281, 2335, 2404, 2456, 2526, 2579, 2605, 2654,
+    2677, 2732, 2758, 2813, 2839, 2891, 2914, 2964, 2987, 3040, 3068, 3120,
+    3146, 3196, 3223, 3271, 3340, 3396, 3421, 3471, 3544, 3600, 3668, 3724,
+    3794, 3843, 3916, 3968, 3995, 4048, 4072, 4125, 4199, 4250, 4322, 4378,
+    4407, 4463, 4488, 4539, 4611, 4662, 4736, 4787, 4861, 4915, 4943, 4994,
+    5018, 5074,
+};
+
+// a frame cut after 22 bits, as when the line is disturbed
+static const uint16_t TRUNCATED[] = {
+    0, 1100, 1129, 1210, 1293, 1341, 1364, 1416, 1442, 1494, 1518, 1571,
+    1597, 1650, 1675, 1724, 1748, 1797, 1866, 1921, 1945, 1998, 2022, 2077,
+    2104, 2152, 2223, 2276, 2305, 2354, 2383, 2432, 2503, 2554, 2625, 2675,
+    2701, 2754, 2777, 2831, 2857, 2911, 2939, 2988, 3016, 3066, 3090, 3140,
+    3163, 3213,
+};
+
+// GOOD with a 2 us spike in bit 12's high, as from a relay switching nearby:
+// the two extra edges complete the frame early and split one bit in three
+static const uint16_t SPIKE[] = {
+    0, 1100, 1127, 1207, 1287, 1341, 1369, 1417, 1440, 1496, 1519, 1572,
+    1599, 1647, 1674, 1725, 1748, 1797, 1868, 1922, 1945, 1996, 2019, 2075,
+    2101, 2149, 2223, 2272, 2296, 2344, 2354, 2356, 2416, 2470, 2493, 2544,
+    2567, 2623, 2652, 2702, 2727, 2781, 2805, 2861, 2884, 2936, 2963, 3013,
+    3036, 3087, 3112, 3161, 3188, 3237, 3309, 3357, 3384, 3435, 3506, 3562,
+    3633, 3686, 3757, 3812, 3837, 3889, 3958, 4008, 4081, 4132, 4155, 4207,
+    4279, 4334, 4359, 4414, 4484, 4533, 4556, 4612, 4638, 4688, 4717, 4770,
+    4794, 4849, 4920, 4968,
+};
+
+// the host's start pulse and nothing after it
+static const uint16_t SILENT[] = {0, 1100};
+
+struct DhtCase
+{
+  const char *name;
+  const uint16_t *edges;
+  uint8_t count;
+  DhtStatus status;
+  bool signalled;    // the interrupt counts a whole frame
+  float temperature; // expected for DHT_OK
+  float humidity;
+};
+
+#define CAPTURE(edges) edges, sizeof(edges) / sizeof(edges[0])
+
+static const DhtCase CASES[] = {
+    {"good frame", CAPTURE(GOOD), DHT_OK, true, 37.4f, 55.2f},
+    {"negative temperature", CAPTURE(NEGATIVE), DHT_OK, true, -10.1f, 48.5f},
+    {"checksum error", CAPTURE(CHECKSUM), DHT_CHECKSUM, true, 0, 0},
+    {"truncated frame", CAPTURE(TRUNCATED), DHT_BAD_FRAME, false, 0, 0},
+    {"spike", CAPTURE(SPIKE), DHT_CHECKSUM, true, 0, 0},
+    {"no reply", CAPTURE(SILENT), DHT_NO_REPLY, false, 0, 0},
+};
+
+/** The capture being replayed on DHT22_PIN. */
+struct Replay
+{
+  const uint16_t *edges;
+  uint8_t count;
+  uint8_t next;         // index of the next edge, even ones falling
+  bool drivenLow;
+  uint64_t lowSince;    // when the host pulled the line low
+  uint32_t startPulse;  // how long it held it, in us
+};
+
+static Replay replay;
+static unsigned long framesSignalled = 0;
+
+static void replayEdge(void *)
+{
+  setInput(DHT22_PIN, replay.next % 2 ? HIGH : LOW);
+  replay.next++;
+}
+
+static void onLine(uint8_t pin, uint8_t mode, int level)
+{
+  if (mode == OUTPUT)
+  {
+    if (level == LOW && !replay.drivenLow)
+      replay.lowSince = nowMicros;
+    replay.drivenLow = level == LOW;
+    return;
+  }
+  if (!replay.drivenLow)
+    return;
+
+  // released by the host: the sensor's edges follow, timed as in the capture
+  replay.drivenLow = false;
+  replay.startPulse = nowMicros - replay.lowSince;
+  for (uint8_t i = 2; i < replay.count; i++)
+    schedule(nowMicros + replay.edges[i] - replay.edges[1], replayEdge, nullptr);
+}
+
+static void onFrame()
+{
+  framesSignalled++;
+}
+
+/** Runs one conversion against `test`'s capture, polling as the control task does. */
+static DhtStatus convert(const DhtCase &test, DhtSample &sample, bool &signalled)
+{
+  replay = {test.edges, test.count, 2, false, 0, 0};
+  unsigned long before = framesSignalled;
+  DhtStatus status = dhtStart(0) ? DHT_PENDING : DHT_IDLE;
+  for (uint32_t waited = 0; status == DHT_PENDING && waited < DHT_TEST_TIMEOUT_US; waited += 100)
+  {
+    advance(100);
+    status = dhtPoll(0, sample);
+  }
+  signalled = framesSignalled != before;
+  advance(DHT_TEST_TIMEOUT_US); // the rest of the capture plays out on the detached line
+  return status;
+}
+
+static const char *statusName(DhtStatus status)
+{
+  static const char *const NAMES[] = {"idle", "pending", "ok", "no reply", "bad frame", "checksum"};
+  return NAMES[status];
+}
+
+int testDht()
+{
+  hookPin(DHT22_PIN, onLine);
+  dhtBegin(0, DHT22_PIN);
+  dhtOnFrame(onFrame);
+
+  int failures = 0;
+  for (const DhtCase &test : CASES)
+  {
+    DhtSample sample = {NAN, NAN};
+    bool signalled;
+    DhtStatus status = convert(test, sample, signalled);
+    bool ok = status == test.status && signalled == test.signalled &&
+              (status != DHT_OK ||
+               (fabsf(sample.temperature - test.temperature) < 0.01f && fabsf(sample.humidity - test.humidity) < 0.01f));
+    printf("%-22s %-9s %-9s", test.name, statusName(status), signalled ? "signalled" : "timed out");
+    if (status == DHT_OK)
+      printf(" %5.1f C %5.1f %%RH", sample.temperature, sample.humidity);
+    printf("%s\n", ok ? "" : "  MISMATCH");
+    failures += !ok;
+  }
+
+  // the datasheet asks for at least 1 ms
+  bool pulseOk = replay.startPulse >= 1000;
+  printf("%-22s %u us%s\n", "start pulse", (unsigned)replay.startPulse, pulseOk ? "" : "  MISMATCH");
+  failures += !pulseOk;
+
+  printf("%d of %d checks failed\n", failures, (int)(sizeof(CASES) / sizeof(CASES[0])) + 1);
+  return failures ? 1 : 0;
+}
+
+}
@@ -0,0 +1,86 @@
+/*
+ * Microbenchmark of the LCD row formatters (lcd_format.h) against the
+ * sprintf() based formatting they replaced, run with --bench-lcd.
+ */
+
+#include <Arduino.h>
+#include <chrono>
+#include "lcd_format.h"
+#include "sim.h"
+
+namespace sim
+{
+
+static const int BENCH_ROUNDS = 2000000;
+
+// The previous formatSensorMsg()/formatTimer() bodies, kept for reference
+static void legacyRows(char *top, char *bottom, float temp, float target, float humidity, uint8_t day,
+                       uint32_t timeInSeconds)
+{
+  sprintf(top, "%.1f/%.1fC %.1f%%", temp, target, humidity);
+  char timer[10]; // up to 255 hours
+  snprintf(timer, sizeof(timer), "%02u:%02u:%02u", (unsigned)(uint8_t)(timeInSeconds / 3600), (unsigned)(timeInSeconds % 3600 / 60),
+          (unsigned)(timeInSeconds % 60));
+  sprintf(bottom, "%02u/21d %s", day, timer);
+}
+
+static void fixedRows(LcdRow &top, LcdRow &bottom, int32_t temp, int32_t target, int32_t humidity, uint8_t day,
+                      uint32_t timeInSeconds)
+{
+  formatTenths<0>(top, temp);
+  formatText<4>(top, "/");
+  formatTenths<5>(top, target);
+  formatText<9>(top, "C ");
+  formatTenths<11>(top, humidity);
+  formatText<15>(top, "%");
+  formatTwoDigits<0>(bottom, day);
+  formatText<2>(bottom, "/21d ");
+  formatTimer<7>(bottom, timeInSeconds);
+  bottom[15] = ' ';
+}
+
+int benchFormat()
+{
+  // Same rows for every reading the display can show during a cycle
+  unsigned long mismatches = 0, checked = 0;
+  for (int temp = 100; temp <= 999; temp += 7)
+    for (int humidity = 100; humidity <= 999; humidity += 13)
+    {
+      char top[40], bottom[40];
+      LcdRow fixedTop, fixedBottom;
+      uint32_t seconds = (temp * 37 + humidity) % 86400;
+      legacyRows(top, bottom, temp / 10.0f, 37.5f, humidity / 10.0f, temp % 22 + 1, seconds);
+      fixedRows(fixedTop, fixedBottom, temp, 375, humidity, temp % 22 + 1, seconds);
+      checked++;
+      if (memcmp(top, fixedTop, LCD_COLS) || memcmp(bottom, fixedBottom, 15))
+        mismatches++;
+    }
+  printf("%-20s %lu rows compared, %lu differ\n", "Output check", checked, mismatches);
+
+  using Clock = std::chrono::steady_clock;
+  volatile uint32_t sink = 0;
+
+  Clock::time_point t0 = Clock::now();
+  for (int i = 0; i < BENCH_ROUNDS; i++)
+  {
+    char top[40], bottom[40];
+    legacyRows(top, bottom, (350 + i % 40) / 10.0f, 37.5f, (550 + i % 90) / 10.0f, 5, i % 86400);
+    sink = sink + top[3] + bottom[14];
+  }
+  double legacyNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / BENCH_ROUNDS;
+
+  t0 = Clock::now();
+  for (int i = 0; i < BENCH_ROUNDS; i++)
+  {
+    LcdRow top, bottom;
+    fixedRows(top, bottom, 350 + i % 40, 375, 550 + i % 90, 5, i % 86400);
+    sink = sink + top[3] + bottom[14];
+  }
+  double fixedNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / BENCH_ROUNDS;
+
+  printf("%-20s %.1f ns per frame\n", "sprintf rows", legacyNs);
+  printf("%-20s %.1f ns per frame (%.0fx faster)\n", "Fixed-point rows", fixedNs, legacyNs / fixedNs);
+  return mismatches ? 1 : 0;
+}
+
+}
@@ -0,0 +1,107 @@
+#include <Arduino.h>
+#include "sim.h"
+
+/*
+ * Simulated 16x2 HD44780 character display behind a PCF8574 I2C backpack
+ * (P0 = RS, P2 = E, P3 = backlight, P4..P7 = D4..D7).
+ *
+ * Every byte written to the expander updates its outputs; the controller
+ * latches the data nibble on each falling edge of E. It starts in 8-bit
+ * mode, so the initialisation sequence is decoded the way the real part
+ * sees it, and switches to 4-bit transfers on the "function set 4-bit"
+ * command. A write cut short by lcdNackRate reaches the controller only up
+ * to the byte it stopped at.
+ */
+
+namespace sim
+{
+
+static const uint8_t RS = 0x01;
+static const uint8_t EN = 0x04;
+
+static uint8_t outputs = 0;
+static bool fourBit = false;
+static bool highNibbleDone = false;
+static uint8_t pending = 0;
+static uint8_t cursor = 0; // DDRAM address
+static char glass[2][17];
+
+float lcdNackRate = 0;
+unsigned long lcdNacks = 0;
+
+static void clearGlass()
+{
+  memset(glass, ' ', sizeof(glass));
+  glass[0][16] = glass[1][16] = '\0';
+  cursor = 0;
+}
+
+static void execute(uint8_t value, bool data)
+{
+  if (data)
+  {
+    uint8_t row = cursor >= 0x40 ? 1 : 0;
+    uint8_t col = cursor & 0x3F;
+    if (col < 16)
+      glass[row][col] = value;
+    cursor++;
+  }
+  else if (value & 0x80)
+    cursor = value & 0x7F; // set DDRAM address
+  else if (value == 0x01)
+    clearGlass();
+  else if ((value & 0xFE) == 0x02)
+    cursor = 0; // return home
+  else if ((value & 0xE0) == 0x20)
+    fourBit = !(value & 0x10); // function set, 8-bit (0x3x) or 4-bit (0x2x)
+}
+
+static void latch(uint8_t nibble, bool data)
+{
+  if (!fourBit)
+  {
+    execute(nibble << 4, data);
+    highNibbleDone = false;
+    return;
+  }
+
+  if (!highNibbleDone)
+  {
+    pending = nibble << 4;
+    highNibbleDone = true;
+    return;
+  }
+  highNibbleDone = false;
+  execute(pending | nibble, data);
+}
+
+static bool onWrite(void *, const uint8_t *data, size_t len)
+{
+  bool nack = lcdNackRate > 0 && uniform() < lcdNackRate;
+  if (nack)
+  {
+    len = uniform() * len;
+    lcdNacks++;
+  }
+  for (size_t i = 0; i < len; i++)
+  {
+    uint8_t next = data[i];
+    if ((outputs & EN) && !(next & EN))
+      latch(outputs >> 4, outputs & RS);
+    outputs = next;
+  }
+  return !nack;
+}
+
+void attachLcd(uint8_t address)
+{
+  clearGlass();
+  attachI2c(address, nullptr, onWrite);
+}
+
+const char *lcdRow(uint8_t row)
+{
+  return glass[row ? 1 : 0];
+}
+
+}
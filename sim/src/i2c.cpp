@@ -0,0 +1,113 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include "sim.h"
+
+/*
+ * Simulated I2C bus. A transfer costs nine clocks per byte (eight data bits
+ * plus ACK) and two for START/STOP, charged to the virtual clock since the
+ * Arduino Wire API blocks until the transfer is done.
+ */
+
+TwoWire Wire;
+
+namespace sim
+{
+
+struct I2cDevice
+{
+  uint8_t address;
+  void *device;
+  I2cWriteFn onWrite;
+  I2cReadFn onRead;
+};
+
+static const uint8_t MAX_DEVICES = 8;
+static I2cDevice devices[MAX_DEVICES];
+static uint8_t deviceCount = 0;
+
+void attachI2c(uint8_t address, void *device, I2cWriteFn onWrite, I2cReadFn onRead)
+{
+  if (deviceCount < MAX_DEVICES)
+    devices[deviceCount++] = {address, device, onWrite, onRead};
+}
+
+static I2cDevice *findDevice(uint8_t address)
+{
+  for (uint8_t i = 0; i < deviceCount; i++)
+    if (devices[i].address == address)
+      return &devices[i];
+  return nullptr;
+}
+
+/** Charges a transfer of `bytes` bytes, address included, to the clock. */
+static void transfer(TwoWire &wire, size_t bytes)
+{
+  uint64_t us = ((uint64_t)bytes * 9 + 2) * 1000000 / wire.getClock();
+  wire.bytesSent += bytes;
+  wire.transactions++;
+  wire.busMicros += us;
+  advance(us);
+}
+
+}
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency)
+{
+  (void)sda;
+  (void)scl;
+  if (frequency)
+    clock = frequency;
+  return true;
+}
+
+bool TwoWire::setClock(uint32_t frequency)
+{
+  clock = frequency;
+  return true;
+}
+
+void TwoWire::beginTransmission(uint8_t addr)
+{
+  address = addr;
+  length = 0;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+  if (length >= I2C_BUFFER_LENGTH)
+    return 0;
+  buffer[length++] = data;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t len)
+{
+  size_t n = 0;
+  while (n < len && write(data[n]))
+    n++;
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+  (void)sendStop;
+  sim::transfer(*this, length + 1);
+
+  sim::I2cDevice *device = sim::findDevice(address);
+  if (!device || !device->onWrite(device->device, buffer, length))
+    return 2; // address NACK
+  return 0;
+}
+
+size_t TwoWire::requestFrom(uint8_t addr, size_t len, bool sendStop)
+{
+  (void)sendStop;
+  readLength = readAt = 0;
+  if (len > I2C_BUFFER_LENGTH)
+    len = I2C_BUFFER_LENGTH;
+
+  sim::I2cDevice *device = sim::findDevice(addr);
+  readLength = device && device->onRead ? device->onRead(device->device, readBuffer, len) : 0;
+  sim::transfer(*this, readLength ? len + 1 : 1); // a NACKed address ends the transfer
+  return readLength;
+}
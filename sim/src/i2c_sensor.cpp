@@ -0,0 +1,214 @@
+#include <Arduino.h>
+#include "i2c_sensors.h"
+#include "sim.h"
+
+/*
+ * Simulated I2C temperature/humidity sensors.
+ *
+ * SHT3x and SHT4x: a measurement command samples the chamber model, and
+ * reads are NACKed until the conversion time has passed, then return the
+ * two words with their CRCs once. BME280: a register file with the chip
+ * ID, a set of trimming parameters and the data registers, which a write
+ * of forced mode to ctrl_meas refreshes once the conversion is done; the
+ * raw values are found by inverting the firmware's compensation.
+ *
+ * Nothing answers while sim::sensorUp is false.
+ */
+
+namespace sim
+{
+
+unsigned long i2cSensorConversions = 0;
+
+static const uint32_t SHT3X_CONVERSION_US = 12500; // typical, high repeatability
+static const uint32_t SHT4X_CONVERSION_US = 6900;
+static const uint32_t BME280_CONVERSION_US = 5800;
+
+/** Trimming parameters of one real part. */
+static const Bme280Calibration BME280_TRIM = {28485, 26735, 50, 75, 353, 0, 340, 0, 30};
+
+struct I2cSensor
+{
+  SensorType type;
+  Plant *source;
+  bool converting;
+  bool unread;       // SHT: a result waits to be read
+  uint64_t readyAt;  // in us
+  SensorSample sample;
+  uint8_t reply[SHT_FRAME_LENGTH];
+  uint8_t pointer;   // BME280 register address
+  uint8_t registers[256];
+};
+
+static I2cSensor sensors[MAX_PLANTS];
+static uint8_t sensorCount = 0;
+
+static SensorSample measure(Plant &plant, float tempNoise, float humidityNoise)
+{
+  plant.update();
+  SensorSample sample = {plant.temp + gaussian() * tempNoise, plant.humidity + gaussian() * humidityNoise};
+  glitch(sample.temperature, sample.humidity);
+  sample.humidity = constrain(sample.humidity, 0.0f, 100.0f);
+  return sample;
+}
+
+static void shtWord(uint8_t *out, float ticks)
+{
+  uint16_t word = (uint16_t)constrain(lroundf(ticks), 0L, 65535L);
+  out[0] = word >> 8;
+  out[1] = word;
+  out[2] = sensirionCrc(out, 2);
+}
+
+/** @return The smallest raw value in [0, top) whose compensated `field` reaches `value`. */
+template <typename Field>
+static int32_t invert(int32_t top, float value, Field field)
+{
+  int32_t low = 0, high = top - 1;
+  while (low < high)
+  {
+    int32_t mid = (low + high) / 2;
+    if (field(mid) < value)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+/** Latches a finished BME280 conversion into the data registers. */
+static void bmeLatch(I2cSensor &sensor)
+{
+  if (!sensor.converting || nowMicros < sensor.readyAt)
+    return;
+  sensor.converting = false;
+  SensorSample out;
+  int32_t rawTemp = invert(1 << 20, sensor.sample.temperature, [&](int32_t raw) {
+    bme280Compensate(BME280_TRIM, raw, 0, out);
+    return out.temperature;
+  });
+  int32_t rawHumidity = invert(1 << 16, sensor.sample.humidity, [&](int32_t raw) {
+    bme280Compensate(BME280_TRIM, rawTemp, raw, out);
+    return out.humidity;
+  });
+  uint8_t *data = sensor.registers + 0xFA;
+  data[0] = rawTemp >> 12;
+  data[1] = rawTemp >> 4;
+  data[2] = (rawTemp & 0x0F) << 4;
+  data[3] = rawHumidity >> 8;
+  data[4] = rawHumidity;
+  sensor.registers[0xF3] = 0; // not measuring
+  i2cSensorConversions++;
+}
+
+static bool onWrite(void *device, const uint8_t *data, size_t len)
+{
+  I2cSensor &sensor = *(I2cSensor *)device;
+  if (!sensorUp || !len)
+    return false;
+
+  switch (sensor.type)
+  {
+  case SENSOR_SHT3X:
+    if (len != 2 || data[0] != 0x24 || data[1] != 0x00 || sensor.converting)
+      return false;
+    sensor.sample = measure(*sensor.source, 0.02f, 0.1f);
+    shtWord(sensor.reply, (sensor.sample.temperature + 45) / 175 * 65535);
+    shtWord(sensor.reply + 3, sensor.sample.humidity / 100 * 65535);
+    sensor.readyAt = nowMicros + SHT3X_CONVERSION_US;
+    sensor.converting = true;
+    return true;
+
+  case SENSOR_SHT4X:
+    if (len != 1 || data[0] != 0xFD || sensor.converting)
+      return false;
+    sensor.sample = measure(*sensor.source, 0.01f, 0.08f);
+    shtWord(sensor.reply, (sensor.sample.temperature + 45) / 175 * 65535);
+    shtWord(sensor.reply + 3, (sensor.sample.humidity + 6) / 125 * 65535);
+    sensor.readyAt = nowMicros + SHT4X_CONVERSION_US;
+    sensor.converting = true;
+    return true;
+
+  default:
+    // register address, then register/value pairs
+    bmeLatch(sensor);
+    sensor.pointer = data[0];
+    for (size_t i = 0; i + 1 < len; i += 2)
+    {
+      uint8_t reg = data[i];
+      sensor.registers[reg] = data[i + 1];
+      if (reg == 0xF4 && (data[i + 1] & 0x03) == 0x01 && !sensor.converting)
+      {
+        sensor.sample = measure(*sensor.source, 0.01f, 0.2f);
+        sensor.readyAt = nowMicros + BME280_CONVERSION_US;
+        sensor.converting = true;
+        sensor.registers[0xF3] = 0x08; // measuring
+      }
+    }
+    return true;
+  }
+}
+
+static size_t onRead(void *device, uint8_t *data, size_t len)
+{
+  I2cSensor &sensor = *(I2cSensor *)device;
+  if (!sensorUp)
+    return 0;
+
+  if (sensor.type != SENSOR_BME280)
+  {
+    if (sensor.converting && nowMicros >= sensor.readyAt)
+    {
+      sensor.converting = false;
+      sensor.unread = true;
+      i2cSensorConversions++;
+    }
+    if (!sensor.unread)
+      return 0; // busy or nothing measured
+    sensor.unread = false;
+    size_t n = len < SHT_FRAME_LENGTH ? len : SHT_FRAME_LENGTH;
+    memcpy(data, sensor.reply, n);
+    return n;
+  }
+
+  bmeLatch(sensor);
+  for (size_t i = 0; i < len; i++)
+    data[i] = sensor.registers[(uint8_t)(sensor.pointer + i)];
+  return len;
+}
+
+void attachI2cSensor(SensorType type, uint8_t address, Plant &source)
+{
+  if (sensorCount == MAX_PLANTS)
+    return;
+  I2cSensor &sensor = sensors[sensorCount++];
+  sensor = {};
+  sensor.type = type;
+  sensor.source = &source;
+
+  if (type == SENSOR_BME280)
+  {
+    uint8_t *r = sensor.registers;
+    const Bme280Calibration &c = BME280_TRIM;
+    r[0xD0] = 0x60;
+    r[0x88] = c.t1;
+    r[0x89] = c.t1 >> 8;
+    r[0x8A] = c.t2;
+    r[0x8B] = c.t2 >> 8;
+    r[0x8C] = c.t3;
+    r[0x8D] = c.t3 >> 8;
+    r[0xA1] = c.h1;
+    r[0xE1] = c.h2;
+    r[0xE2] = c.h2 >> 8;
+    r[0xE3] = c.h3;
+    r[0xE4] = c.h4 >> 4;
+    r[0xE5] = (c.h4 & 0x0F) | (c.h5 & 0x0F) << 4;
+    r[0xE6] = c.h5 >> 4;
+    r[0xE7] = c.h6;
+    r[0xFA] = 0x80; // reset values
+    r[0xFD] = 0x80;
+  }
+  attachI2c(address, &sensor, onWrite, onRead);
+}
+
+}
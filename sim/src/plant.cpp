@@ -0,0 +1,77 @@
+#include <Arduino.h>
+#include "sim.h"
+
+namespace sim
+{
+
+Plant plants[MAX_PLANTS];
+Plant &plant = plants[0];
+
+static uint32_t rngState = 0x12345678;
+
+void seed(uint32_t s)
+{
+  rngState = s ? s : 1;
+}
+
+float uniform()
+{
+  // xorshift32
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return (rngState >> 8) * (1.0f / 16777216.0f);
+}
+
+float gaussian()
+{
+  // Irwin-Hall approximation, plenty for sensor noise.
+  float sum = 0;
+  for (int i = 0; i < 12; i++)
+    sum += uniform();
+  return sum - 6.0f;
+}
+
+unsigned long sensorGlitches = 0;
+
+void glitch(float &temp, float &humidity)
+{
+  if (sensorGlitchRate <= 0 || uniform() >= sensorGlitchRate)
+    return;
+  sensorGlitches++;
+  float error = 0.1f * (1 << (3 + (int)(uniform() * 7))) * (uniform() < 0.5f ? -1 : 1);
+  if (uniform() < 0.5f)
+    temp += error;
+  else
+    humidity += error;
+}
+
+float Plant::ambient() const
+{
+  double day = (double)nowMicros / 86400e6;
+  return roomTemp + roomSwing * sin(2 * M_PI * (day - 0.25));
+}
+
+void Plant::update()
+{
+  // Fixed 1 s integration steps keep the result independent of how often
+  // the firmware happens to look at the sensor.
+  const uint64_t STEP = 1000000;
+  bool heaterOn = pinLevel(heaterPin) == HIGH;
+  bool humidifierOn = pinLevel(humidifierPin) == HIGH;
+
+  while (nowMicros - lastUpdate >= STEP)
+  {
+    lastUpdate += STEP;
+    float dt = 1.0;
+
+    heaterOutput += ((heaterOn ? 1.0f : 0.0f) - heaterOutput) * dt / heaterLag;
+    temp += (heaterGain * heaterOutput - lossCoeff * (temp - ambient())) * dt;
+
+    humidity += ((humidifierOn ? humidifierGain : 0.0f) - ventCoeff * (humidity - roomHumidity)) * dt;
+    if (humidity > 99.9f)
+      humidity = 99.9f;
+  }
+}
+
+}
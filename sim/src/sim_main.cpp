@@ -0,0 +1,827 @@
+/*
+ * Host-native incubator simulation.
+ *
+ * Runs the unmodified firmware (setup()/loop()) against the chamber model in
+ * sim::plant on a virtual clock, with a simulated operator who starts the
+ * cycle and acknowledges every turning alarm. At the end it prints control
+ * quality and loop cost figures that can be compared between builds.
+ *
+ * Build and run from the project root:
+ *   pio run -e native && .pio/build/native/program [options]
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <Wire.h>
+#include <chrono>
+#include "dht_reader.h"
+#include "sensors.h"
+#include "sample_filter.h"
+#include "i2c_bus.h"
+#include "history.h"
+#include "heater_control.h"
+#include "thermal_model.h"
+#include "lcd_manager.h"
+#include "state_journal.h"
+#include "tasks.h"
+#include "power.h"
+#include "probes.h"
+#include "pins.h"
+#include "chambers.h"
+#include "profiles.h"
+#include "time_manager.h"
+#include "alarm_manager.h"
+#include "wifi_manager.h"
+#include "turner.h"
+#include "day_stats.h"
+#include "sim.h"
+
+void setup();
+void loop();
+
+extern bool serialQuiet;
+
+// firmware state observed by the harness
+extern HeaterMode heaterMode;
+extern Chambers chambers;
+extern bool timeSynced;
+extern unsigned long bootControlAt;
+extern byte intervalHours;
+
+struct Options
+{
+  float days = 0;           // the profile's cycle and a day when 0
+  uint32_t stepMs = 100;
+  uint32_t seed = 1;
+  uint32_t responseS = 60;  // operator reaction time to the turning alarm
+  int outageDay = 0;        // day on which the sensor drops out for a while
+  uint32_t outageMin = 15;
+  float glitchRate = 0;     // share of sensor readings that come out wrong
+  float lcdNackRate = 0;    // share of LCD writes cut short
+  bool noFilter = false;    // feed the readings to the control unfiltered
+  float roomTemp = NAN;     // overrides the chamber model's room temperature
+  bool offline = false;
+  int offlineFromDay = 0;   // the network goes away for good on that day
+  int dryTankDay = 0;       // the humidifier's tank runs dry on that day
+  int apMovedDay = 0;       // the access point changes channel and BSSID on that day
+  const char *turner = nullptr; // motor of the tray written into config.json, turned by hand if unset
+  int jamDay = 0;           // the tray jams for that day
+  int32_t clockPpm = 0;     // the device's uptime runs fast by that much
+  bool noNtp = false;
+  int resumeDay = 0;        // power up in the middle of a running cycle
+  int chambers = 1;         // chambers driven by the controller, each with its own model
+  const char *sensor = nullptr;     // primary chamber's sensor type, DHT22 if unset
+  const char *profile = nullptr;    // species profile to write into config.json
+  const char *historyCsv = nullptr; // export the recorded history
+  const char *control = nullptr;    // heater mode to write into config.json
+  float kp = 0, ki = 0, kd = 0;     // PID gains, autotuned if left at zero
+  uint32_t windowS = 0;
+  bool probes = false;              // dump the latency probes at the end
+  bool benchLcd = false;            // only run the LCD formatter benchmark
+  bool benchChambers = false;       // only run the chamber sweep benchmark
+  bool benchConfig = false;         // only run the config load benchmark
+  bool testDht = false;             // only check the DHT22 decoder
+  int benchHttp = -1;               // only load-test the telemetry server, with N WebSockets
+  float probeBudgetUs = 0;          // fail if the control step's p99 exceeds it
+};
+
+static void usage()
+{
+  printf("usage: program [--days N] [--step-ms N] [--seed N] [--response-s N]\n"
+         "               [--outage-day N] [--outage-min N] [--glitch-rate P] [--no-filter]\n"
+         "               [--lcd-nack-rate P]\n"
+         "               [--resume-day N] [--room-temp C] [--offline] [--no-ntp] [--quiet]\n"
+         "               [--offline-from-day N] [--clock-ppm N] [--dry-tank-day N]\n"
+         "               [--ap-moved-day N] [--turner stepper|dc] [--jam-day N]\n"
+         "               [--history-csv FILE] [--chambers N] [--sensor dht22|sht3x|sht4x|bme280]\n"
+         "               [--profile chicken|duck|quail|goose]\n"
+         "               [--control hysteresis|pid] [--kp N --ki N --kd N] [--window-s N]\n"
+         "               [--probes] [--probe-budget-us N] [--bench-lcd] [--bench-http N]\n"
+         "               [--bench-chambers] [--bench-config] [--test-dht]\n");
+}
+
+static bool parseArgs(int argc, char **argv, Options &opt)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    const char *a = argv[i];
+    const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!strcmp(a, "--quiet"))
+      serialQuiet = true;
+    else if (!strcmp(a, "--offline"))
+      opt.offline = true;
+    else if (!strcmp(a, "--no-ntp"))
+      opt.noNtp = true;
+    else if (!strcmp(a, "--no-filter"))
+      opt.noFilter = true;
+    else if (!strcmp(a, "--probes"))
+      opt.probes = true;
+    else if (!strcmp(a, "--bench-lcd"))
+      opt.benchLcd = true;
+    else if (!strcmp(a, "--bench-chambers"))
+      opt.benchChambers = true;
+    else if (!strcmp(a, "--bench-config"))
+      opt.benchConfig = true;
+    else if (!strcmp(a, "--test-dht"))
+      opt.testDht = true;
+    else if (v && !strcmp(a, "--bench-http"))
+      opt.benchHttp = atoi(argv[++i]);
+    else if (v && !strcmp(a, "--days"))
+      opt.days = atof(argv[++i]);
+    else if (v && !strcmp(a, "--step-ms"))
+      opt.stepMs = atoi(argv[++i]);
+    else if (v && !strcmp(a, "--seed"))
+      opt.seed = atoi(argv[++i]);
+    else if (v && !strcmp(a, "--response-s"))
+      opt.responseS = atoi(argv[++i]);
+    else if (v && !strcmp(a, "--outage-day"))
+      opt.outageDay = atoi(argv[++i]);
+    else if (v && !strcmp(a, "--outage-min"))
+      opt.outageMin = atoi(argv[++i]);
+    else if (v && !strcmp(a, "--glitch-rate"))
+      opt.glitchRate = atof(argv[++i]);
+    else if (v && !strcmp(a, "--lcd-nack-rate"))
+      opt.lcdNackRate = atof(argv[++i]);
+    else if (v && !strcmp(a, "--room-temp"))
+      opt.roomTemp = atof(argv[++i]);
+    else if (v && !strcmp(a, "--offline-from-day"))
+      opt.offlineFromDay = atoi(argv[++i]);
+    else if (v && !strcmp(a, "--ap-moved-day"))
+      opt.apMovedDay = atoi(argv[++i]);
+    else if (v && !strcmp(a, "--turner"))
+      opt.turner = argv[++i];
+    else if (v && !strcmp(a, "--jam-day"))
+      opt.jamDay = atoi(argv[++i]);
+    else if (v && !strcmp(a, "--dry-tank-day"))
+      opt.dryTankDay = atoi(argv[++i]);
+    else if (v && !strcmp(a, "--clock-ppm"))
+      opt.clockPpm = atoi(argv[++i]);
+    else if (v && !strcmp(a, "--resume-day"))
+      opt.resumeDay = atoi(argv[++i]);
+    else if (v && !strcmp(a, "--chambers"))
+      opt.chambers = atoi(argv[++i]);
+    else if (v && !strcmp(a, "--sensor"))
+      opt.sensor = argv[++i];
+    else if (v && !strcmp(a, "--profile"))
+      opt.profile = argv[++i];
+    else if (v && !strcmp(a, "--history-csv"))
+      opt.historyCsv = argv[++i];
+    else if (v && !strcmp(a, "--control"))
+      opt.control = argv[++i];
+    else if (v && !strcmp(a, "--kp"))
+      opt.kp = atof(argv[++i]);
+    else if (v && !strcmp(a, "--ki"))
+      opt.ki = atof(argv[++i]);
+    else if (v && !strcmp(a, "--kd"))
+      opt.kd = atof(argv[++i]);
+    else if (v && !strcmp(a, "--window-s"))
+      opt.windowS = atoi(argv[++i]);
+    else if (v && !strcmp(a, "--probe-budget-us"))
+      opt.probeBudgetUs = atof(argv[++i]);
+    else
+      return false;
+  }
+  return opt.stepMs > 0 && opt.chambers >= 1 && opt.chambers <= MAX_CHAMBERS &&
+         (!opt.sensor || sensorType(opt.sensor) != SENSOR_TYPE_COUNT) &&
+         (!opt.profile || profileId(opt.profile) != PROFILE_COUNT) &&
+         (!opt.turner || !strcmp(opt.turner, "stepper") || !strcmp(opt.turner, "dc"));
+}
+
+/**
+ * Presses a button for a while, then releases it, and leaves it alone for
+ * a second so the firmware can tell the click from a double press.
+ */
+struct Finger
+{
+  static const uint64_t SETTLE_US = 1000000;
+
+  uint8_t pin;
+  uint64_t pressAt = 0;
+  uint64_t releaseAt = 0;
+  bool pending = false;
+  bool turn = false; // press acknowledges a turning alarm
+
+  // flash written while handling turn presses
+  unsigned long flashAtPress = 0;
+  unsigned long turnFlashBytes = 0;
+  unsigned long turnPresses = 0;
+
+  void schedule(uint64_t at, uint32_t holdMs, bool isTurn)
+  {
+    pressAt = at;
+    releaseAt = at + (uint64_t)holdMs * 1000;
+    pending = true;
+    turn = isTurn;
+  }
+
+  void update()
+  {
+    if (!pending)
+      return;
+    if (sim::nowMicros >= releaseAt + SETTLE_US)
+    {
+      pending = false;
+      if (turn)
+      {
+        turnFlashBytes += LittleFS.bytesWritten - flashAtPress;
+        turnPresses++;
+      }
+    }
+    else if (sim::nowMicros >= releaseAt)
+      sim::setInput(pin, HIGH);
+    else if (sim::nowMicros >= pressAt && sim::pinLevel(pin) == HIGH)
+    {
+      flashAtPress = LittleFS.bytesWritten;
+      sim::setInput(pin, LOW);
+    }
+  }
+};
+
+struct HistoryTally
+{
+  FILE *csv;
+  unsigned long samples;
+  unsigned long transitions;
+};
+
+static bool tallyHistory(const HistoryEntry &entry, void *context)
+{
+  HistoryTally &tally = *(HistoryTally *)context;
+  if (entry.kind == HISTORY_SAMPLE)
+    tally.samples++;
+  else
+    tally.transitions++;
+  if (tally.csv && entry.kind == HISTORY_SAMPLE)
+    fprintf(tally.csv, "%u,sample,%.1f,%.1f\n", entry.time, entry.temp / 10.0, entry.humidity / 10.0);
+  else if (tally.csv)
+    fprintf(tally.csv, "%u,actuators,%d,%d\n", entry.time, !!(entry.state & HISTORY_HEATER),
+            !!(entry.state & HISTORY_HUMIDIFIER));
+  return true;
+}
+
+/** Primary chamber's stored days, added up. */
+struct DaysTally
+{
+  unsigned long days;
+  uint64_t trackedMs;
+  uint64_t heaterOnMs;
+};
+
+static bool tallyDays(const DayStats &stats, void *context)
+{
+  DaysTally &tally = *(DaysTally *)context;
+  if (stats.chamber != 0)
+    return true;
+  tally.days++;
+  tally.trackedMs += stats.trackedMs;
+  tally.heaterOnMs += stats.heaterOnMs;
+  return true;
+}
+
+/**
+ * Journals the runtime state of a cycle that had been running for `day`
+ * days when the device lost power, with the chamber still at temperature.
+ */
+static void resumeCycle(int day, const Profile &profile)
+{
+  LittleFS.begin();
+  journalBegin();
+  journalSet(STATE_INCUBATION_START, sim::epochAtBoot - (uint32_t)(day - 1) * 86400 - 3600);
+  journalSet(STATE_LAST_TURN, sim::epochAtBoot - 3600);
+  journalSet(STATE_CURRENT_DAY, day);
+  journalSet(STATE_CLOCK, sim::epochAtBoot - 60);
+
+  sim::plant.temp = profileDay(profile, day).temp;
+  sim::plant.humidity = profileDay(profile, day).humidity;
+}
+
+/**
+ * Wiring of the chambers after the primary one, on free pins (the last
+ * ones beyond what an ESP32 actually has).
+ */
+static const ChamberPins EXTRA_CHAMBER_PINS[MAX_CHAMBERS - 1] = {
+    {25, 26, 27}, {32, 33, 13}, {14, 2, 15}, {12, 0, 1}, {3, 6, 7}, {8, 9, 10}, {11, 20, 24}};
+
+/**
+ * Lists `count` chambers in config.json, the extra ones started at power-on,
+ * and connects a chamber model and DHT22 to each; their bulbs and walls
+ * differ by up to 10%.
+ */
+static void configureChambers(int count)
+{
+  LittleFS.begin();
+  JsonDocument doc;
+  File in = LittleFS.open("/config.json", FILE_READ);
+  deserializeJson(doc, in);
+  in.close();
+
+  JsonArray list = doc["chambers"].to<JsonArray>();
+  JsonObject primary = list.add<JsonObject>();
+  primary["sensor_pin"] = DHT22_PIN;
+  primary["heater_pin"] = TEMP_RELAY_PIN;
+  primary["humidifier_pin"] = HUMIDIFIER_MOSFET_PIN;
+  for (int i = 1; i < count; i++)
+  {
+    const ChamberPins &pins = EXTRA_CHAMBER_PINS[i - 1];
+    JsonObject chamber = list.add<JsonObject>();
+    chamber["sensor_pin"] = pins.sensor;
+    chamber["heater_pin"] = pins.heater;
+    chamber["humidifier_pin"] = pins.humidifier;
+    chamber["incubation_start_date"] = sim::epochAtBoot;
+
+    sim::Plant &plant = sim::plants[i];
+    plant.heaterPin = pins.heater;
+    plant.humidifierPin = pins.humidifier;
+    plant.roomTemp = sim::plant.roomTemp;
+    plant.heaterGain *= 1 + 0.1f * ((i % 3) - 1);
+    plant.lossCoeff *= 1 - 0.05f * ((i % 2) * 2 - 1);
+    sim::attachDht22(pins.sensor, plant);
+  }
+
+  File out = LittleFS.open("/config.json", FILE_WRITE);
+  serializeJson(doc, out);
+  out.close();
+}
+
+/**
+ * Puts a `name` sensor in the primary chamber, at its default address if
+ * it is an I2C one, and connects the simulated part to the bus.
+ */
+static void configureSensor(const char *name)
+{
+  LittleFS.begin();
+  JsonDocument doc;
+  File in = LittleFS.open("/config.json", FILE_READ);
+  deserializeJson(doc, in);
+  in.close();
+
+  JsonObject primary = doc["chambers"][0];
+  if (primary.isNull())
+    primary = doc["chambers"].to<JsonArray>().add<JsonObject>();
+  primary["sensor"] = name;
+
+  SensorType type = sensorType(name);
+  if (sensorOnBus(type))
+    sim::attachI2cSensor(type, sensorDefaultAddress(type), sim::plant);
+
+  File out = LittleFS.open("/config.json", FILE_WRITE);
+  serializeJson(doc, out);
+  out.close();
+}
+
+/** Selects the species profile `name` in config.json. */
+static void configureProfile(const char *name)
+{
+  LittleFS.begin();
+  JsonDocument doc;
+  File in = LittleFS.open("/config.json", FILE_READ);
+  deserializeJson(doc, in);
+  in.close();
+
+  doc["profile"] = name;
+
+  File out = LittleFS.open("/config.json", FILE_WRITE);
+  serializeJson(doc, out);
+  out.close();
+}
+
+/** Fits the tray with a `motor` in config.json and connects the simulated tray. */
+static void configureTurner(const char *motor)
+{
+  LittleFS.begin();
+  JsonDocument doc;
+  File in = LittleFS.open("/config.json", FILE_READ);
+  deserializeJson(doc, in);
+  in.close();
+
+  bool dc = !strcmp(motor, "dc");
+  JsonObject turning = doc["turning"];
+  turning["motor"] = motor;
+  if (dc)
+    turning["travel_seconds"] = 20;
+  else
+    turning["travel_steps"] = 1600;
+  sim::attachTray(dc, dc ? 20000 : 1600);
+
+  File out = LittleFS.open("/config.json", FILE_WRITE);
+  serializeJson(doc, out);
+  out.close();
+}
+
+/** Turns every stage of the sample filter off in config.json. */
+static void disableFilter()
+{
+  LittleFS.begin();
+  JsonDocument doc;
+  File in = LittleFS.open("/config.json", FILE_READ);
+  deserializeJson(doc, in);
+  in.close();
+
+  JsonObject filter = doc["filter"].to<JsonObject>();
+  filter["median_seconds"] = 0;
+  filter["max_temp_rate"] = 0;
+  filter["max_humidity_rate"] = 0;
+  filter["ema_seconds"] = 0;
+
+  File out = LittleFS.open("/config.json", FILE_WRITE);
+  serializeJson(doc, out);
+  out.close();
+}
+
+/** Control quality of one of the extra chambers. */
+struct ChamberTally
+{
+  bool warm = false; // reached its target once
+  double tempSq = 0, humSq = 0;
+  unsigned long samples = 0;
+  unsigned long heaterBase = 0;
+  uint64_t since = 0;
+};
+
+/**
+ * Rewrites the heater settings of config.json in the flash image.
+ */
+static void configureHeater(const Options &opt)
+{
+  LittleFS.begin();
+  JsonDocument doc;
+  File in = LittleFS.open("/config.json", FILE_READ);
+  deserializeJson(doc, in);
+  in.close();
+
+  JsonObject temperature = doc["temperature"];
+  temperature["control"] = opt.control;
+  JsonObject pid = temperature["pid"].to<JsonObject>();
+  pid["kp"] = opt.kp;
+  pid["ki"] = opt.ki;
+  pid["kd"] = opt.kd;
+  if (opt.windowS)
+    pid["window_seconds"] = opt.windowS;
+
+  File out = LittleFS.open("/config.json", FILE_WRITE);
+  serializeJson(doc, out);
+  out.close();
+}
+
+static void printTime(const char *label, uint64_t us)
+{
+  uint64_t s = us / 1000000;
+  printf("%-20s d%02u %02u:%02u:%02u\n", label, (unsigned)(s / 86400), (unsigned)(s / 3600 % 24),
+         (unsigned)(s / 60 % 60), (unsigned)(s % 60));
+}
+
+int main(int argc, char **argv)
+{
+  Options opt;
+  if (!parseArgs(argc, argv, opt))
+  {
+    usage();
+    return 1;
+  }
+
+  if (opt.benchLcd)
+    return sim::benchFormat();
+  if (opt.benchChambers)
+    return sim::benchChambers();
+  if (opt.benchConfig)
+    return sim::benchConfig();
+  if (opt.testDht)
+    return sim::testDht();
+  if (opt.benchHttp >= 0)
+    return sim::benchTelemetry(opt.benchHttp);
+
+  setenv("TZ", "UTC0", 1);
+  tzset();
+
+  sim::seed(opt.seed);
+  sim::networkUp = !opt.offline;
+  sim::ntpUp = !opt.noNtp;
+  sim::clockPpm = opt.clockPpm;
+  sim::sensorGlitchRate = opt.glitchRate;
+  sim::lcdNackRate = opt.lcdNackRate;
+  if (!isnan(opt.roomTemp))
+    sim::plant.roomTemp = opt.roomTemp;
+  sim::plant.heaterPin = TEMP_RELAY_PIN;
+  sim::plant.humidifierPin = HUMIDIFIER_MOSFET_PIN;
+  sim::attachDht22(DHT22_PIN, sim::plant);
+  sim::attachLcd(LCD_ADDRESS);
+
+  if (opt.control)
+    configureHeater(opt);
+  const Profile &profile = PROFILES[opt.profile ? profileId(opt.profile) : PROFILE_CHICKEN];
+  if (opt.profile)
+    configureProfile(opt.profile);
+  if (opt.resumeDay)
+    resumeCycle(opt.resumeDay, profile);
+  if (opt.chambers > 1)
+    configureChambers(opt.chambers);
+  if (opt.sensor)
+    configureSensor(opt.sensor);
+  if (opt.noFilter)
+    disableFilter();
+  if (opt.turner)
+    configureTurner(opt.turner);
+  ChamberTally extra[MAX_CHAMBERS];
+
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point wallStart = Clock::now();
+
+  unsigned long flashBase = LittleFS.bytesWritten, flashOpsBase = LittleFS.writeOps;
+  setup();
+
+  Finger reset{RESET_BUTTON_PIN};
+  bool started = false;
+
+  const float days = opt.days ? opt.days : profile.days + 1;
+  const uint64_t end = (uint64_t)(days * 86400.0) * 1000000;
+  const uint64_t step = (uint64_t)opt.stepMs * 1000;
+  const uint64_t outageStart = opt.outageDay ? (uint64_t)(opt.outageDay - 1) * 86400000000ULL + 43200000000ULL : 0;
+  const uint64_t outageEnd = outageStart + (uint64_t)opt.outageMin * 60000000;
+  const uint64_t offlineFrom = opt.offlineFromDay ? (uint64_t)(opt.offlineFromDay - 1) * 86400000000ULL : 0;
+  const uint64_t dryFrom = opt.dryTankDay ? (uint64_t)(opt.dryTankDay - 1) * 86400000000ULL : 0;
+  const uint64_t apMovedAt = opt.apMovedDay ? (uint64_t)(opt.apMovedDay - 1) * 86400000000ULL : 0;
+  const uint64_t jamFrom = opt.jamDay ? (uint64_t)(opt.jamDay - 1) * 86400000000ULL : 0;
+
+  uint64_t nextSample = 0;
+  uint64_t cycleStart = 0, warmStart = 0, hatchStart = 0;
+  double tempSq = 0, humSq = 0, tempMaxDev = 0;
+  double outageSq = 0, outageMaxDev = 0; // chamber temperature while the failsafe drives the heater
+  unsigned long outageSamples = 0;
+  unsigned long samples = 0, turns = 0;
+  unsigned long answered[ALARM_SOURCE_COUNT] = {}; // alarms acknowledged, besides the turns
+  unsigned long heaterBase = 0, humidifierBase = 0;
+  uint64_t heaterOnMicros = 0; // primary heater pin high, against the day stats
+  unsigned long loops = 0;
+  double loopNanos = 0, loopMaxNanos = 0;
+  uint64_t stallMax = 0; // virtual time spent inside a single loop() call
+  float hatchTarget = 0;
+  // turn timing: motions timed against the one before, unless a turn by hand
+  // came in between or turning was over
+  bool timed[sim::TRAY_MAX_MOTIONS] = {};
+  int motionsSeen = 0;
+  bool handTurn = false;
+
+  for (; sim::nowMicros < end; sim::advance(step))
+  {
+    for (int i = 0; i < opt.chambers; i++)
+      sim::plants[i].update();
+    sim::sensorUp = !(opt.outageDay && sim::nowMicros >= outageStart && sim::nowMicros < outageEnd);
+    if (opt.offlineFromDay && sim::nowMicros >= offlineFrom)
+      sim::networkUp = false;
+    if (opt.dryTankDay && sim::nowMicros >= dryFrom)
+      sim::plant.humidifierGain = 0;
+    sim::trayJammed = opt.jamDay && sim::nowMicros >= jamFrom && sim::nowMicros < jamFrom + 86400000000ULL;
+    if (opt.apMovedDay && sim::nowMicros >= apMovedAt && sim::apId == 1)
+    {
+      sim::apChannel = 11;
+      sim::apId = 2;
+    }
+
+    // operator: start a cycle as soon as the device can, then answer alarms
+    if (!started && !opt.resumeDay && timeSynced && !reset.pending)
+    {
+      reset.schedule(sim::nowMicros, 300, false);
+      started = true;
+    }
+    if (sim::pinLevel(BUZZER_BJT_PIN) == HIGH && !reset.pending)
+    {
+      bool turn = alarmSounding() == ALARM_TURN;
+      reset.schedule(sim::nowMicros + (uint64_t)opt.responseS * 1000000, 300, turn);
+      if (turn)
+      {
+        turns++;
+        handTurn = true;
+      }
+      else
+        answered[alarmSounding()]++;
+    }
+    reset.update();
+    for (; motionsSeen < sim::trayStats.motions; motionsSeen++)
+    {
+      timed[motionsSeen] = !handTurn && profileTurning(profile, chambers.day[0]);
+      handTurn = false;
+    }
+
+    // the LCD faults stop short of the end, so the display shown is the recovered one
+    if (opt.lcdNackRate > 0 && sim::nowMicros + (LCD_RESET_RETRY + 2000) * 1000ull >= end)
+      sim::lcdNackRate = 0;
+
+    uint64_t virtualStart = sim::nowMicros;
+    Clock::time_point t0 = Clock::now();
+    loop();
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+    if (sim::nowMicros - virtualStart > stallMax)
+      stallMax = sim::nowMicros - virtualStart;
+    loops++;
+    if (sim::pinLevel(TEMP_RELAY_PIN) == HIGH)
+      heaterOnMicros += step;
+    loopNanos += ns;
+    if (ns > loopMaxNanos)
+      loopMaxNanos = ns;
+
+    bool active = chambers.incubationStart[0] && chambers.day[0] && chambers.day[0] <= profile.days;
+    if (active && !cycleStart)
+    {
+      cycleStart = sim::nowMicros;
+      heaterBase = sim::pinToggles(TEMP_RELAY_PIN);
+      humidifierBase = sim::pinToggles(HUMIDIFIER_MOSFET_PIN);
+      hatchTarget = chambers.humidityTarget[0];
+    }
+    if (active && !hatchStart && chambers.day[0] > profile.turnLast && chambers.humidityTarget[0] != hatchTarget)
+      hatchStart = sim::nowMicros;
+
+    // control quality is judged from the first time the chamber reaches target
+    if (active && !warmStart && sim::plant.temp >= chambers.tempTarget[0])
+      warmStart = sim::nowMicros;
+
+    if (warmStart && active && sim::nowMicros >= nextSample)
+    {
+      double dt = sim::plant.temp - chambers.tempTarget[0];
+      double dh = sim::plant.humidity - chambers.humidityTarget[0];
+      tempSq += dt * dt;
+      humSq += dh * dh;
+      if (fabs(dt) > tempMaxDev)
+        tempMaxDev = fabs(dt);
+      if (!sim::sensorUp)
+      {
+        outageSq += dt * dt;
+        if (fabs(dt) > outageMaxDev)
+          outageMaxDev = fabs(dt);
+        outageSamples++;
+      }
+      samples++;
+      nextSample = sim::nowMicros + 1000000;
+
+      for (int i = 1; i < opt.chambers; i++)
+      {
+        const sim::Plant &plant = sim::plants[i];
+        ChamberTally &tally = extra[i];
+        if (!tally.warm && chambers.day[i] && plant.temp >= chambers.tempTarget[i])
+        {
+          tally.warm = true;
+          tally.since = sim::nowMicros;
+          tally.heaterBase = sim::pinToggles(plant.heaterPin);
+        }
+        if (!tally.warm || !chambers.day[i] || chambers.day[i] > PROFILES[chambers.profile[i]].days)
+          continue;
+        double dt = plant.temp - chambers.tempTarget[i];
+        double dh = plant.humidity - chambers.humidityTarget[i];
+        tally.tempSq += dt * dt;
+        tally.humSq += dh * dh;
+        tally.samples++;
+      }
+    }
+  }
+
+  double wall = std::chrono::duration<double>(Clock::now() - wallStart).count();
+  double activeHours = cycleStart ? (sim::nowMicros - cycleStart) / 3600e6 : 0;
+  unsigned long heaterSwitches = sim::pinToggles(TEMP_RELAY_PIN) - heaterBase;
+  unsigned long humidifierSwitches = sim::pinToggles(HUMIDIFIER_MOSFET_PIN) - humidifierBase;
+
+  printf("\n=== Simulation summary (seed %u) ===\n", opt.seed);
+  printf("%-20s %.2f days in %.2f s wall\n", "Simulated", sim::nowMicros / 86400e6, wall);
+  printf("%-20s %lu ms\n", "First control", bootControlAt);
+  if (cycleStart)
+    printTime("Cycle started", cycleStart);
+  if (warmStart)
+    printTime("Warmed up", warmStart);
+  if (hatchStart)
+    printTime("Hatch phase from", hatchStart);
+  if (samples)
+  {
+    printf("%-20s %.3f C (max %.2f C)\n", "Temperature RMS", sqrt(tempSq / samples), tempMaxDev);
+    printf("%-20s %.3f %%RH\n", "Humidity RMS", sqrt(humSq / samples));
+  }
+  if (outageSamples)
+    printf("%-20s %.3f C RMS (max %.2f C) over %lu min of failsafe\n", "Sensor outage", sqrt(outageSq / outageSamples),
+           outageMaxDev, outageSamples / 60);
+  printf("%-20s %s\n", "Thermal model", thermalModelLearned() ? "fitted" : "not fitted, using config rates");
+  static const char *const CLOCK_SOURCES[] = {"unset", "estimated", "NTP"};
+  if (clockSource() != CLOCK_UNSET)
+    printf("%-20s %s, %+lld s off true time, drift %+.1f ppm measured\n", "Clock", CLOCK_SOURCES[clockSource()],
+           (long long)clockNow() - (long long)(sim::epochAtBoot + sim::nowMicros / 1000000), clockDrift() / 1000.0);
+  else
+    printf("%-20s unset\n", "Clock");
+  WifiStats wifi = wifiStats();
+  uint32_t connects = wifi.connects[WIFI_PATH_CACHED] + wifi.connects[WIFI_PATH_SCAN];
+  if (connects)
+    printf("%-20s %lu connects: %lu remembered (mean %lu ms), %lu scans (mean %lu ms), %lu fallbacks, "
+           "radio on %.1f s per connect\n",
+           "WiFi", (unsigned long)connects, (unsigned long)wifi.connects[WIFI_PATH_CACHED],
+           (unsigned long)(wifi.connects[WIFI_PATH_CACHED] ? wifi.connectMs[WIFI_PATH_CACHED] / wifi.connects[WIFI_PATH_CACHED] : 0),
+           (unsigned long)wifi.connects[WIFI_PATH_SCAN],
+           (unsigned long)(wifi.connects[WIFI_PATH_SCAN] ? wifi.connectMs[WIFI_PATH_SCAN] / wifi.connects[WIFI_PATH_SCAN] : 0),
+           (unsigned long)wifi.fallbacks, wifi.radioOnMs / 1000.0 / connects);
+  if (activeHours > 0)
+  {
+    printf("%-20s %lu (%.2f /h)\n", "Heater switches", heaterSwitches, heaterSwitches / activeHours);
+    printf("%-20s %lu (%.2f /h)\n", "Humidifier switches", humidifierSwitches, humidifierSwitches / activeHours);
+  }
+  if (heaterMode == HEATER_PID)
+  {
+    PidConfig pid = pidConfig();
+    printf("%-20s PID Kp=%.4f Ki=%.6f Kd=%.4f, %us window%s\n", "Heater control", pid.kp, pid.ki, pid.kd,
+           pid.windowSeconds, pidAutotuning() ? ", autotune unfinished" : "");
+  }
+  else
+    printf("%-20s hysteresis\n", "Heater control");
+  for (int i = 1; i < opt.chambers; i++)
+  {
+    const ChamberTally &tally = extra[i];
+    if (!tally.samples)
+      continue;
+    char label[20];
+    snprintf(label, sizeof(label), "Chamber %d", i);
+    printf("%-20s temperature RMS %.3f C, humidity RMS %.3f %%RH, %.2f heater switches/h\n", label,
+           sqrt(tally.tempSq / tally.samples), sqrt(tally.humSq / tally.samples),
+           (sim::pinToggles(sim::plants[i].heaterPin) - tally.heaterBase) / ((sim::nowMicros - tally.since) / 3600e6));
+  }
+  printf("%-20s %lu frames, %lu decode errors\n", "DHT22", sim::dhtFrames, dhtErrorCount());
+  if (opt.sensor && sensorOnBus(sensorType(opt.sensor)))
+  {
+    I2cBusStats bus = i2cBusStats();
+    printf("%-20s %lu conversions, %lu failed\n", sensorName(0), sim::i2cSensorConversions, sensorErrors(0));
+    printf("%-20s longest transaction %lu us, %lu of %lu failed\n", "I2C bus", (unsigned long)bus.maxBusyMicros,
+           (unsigned long)bus.failures, (unsigned long)bus.transactions);
+  }
+  if (opt.glitchRate > 0 || filterRejected(0))
+    printf("%-20s %lu readings rejected, %lu glitches injected\n", "Sample filter", (unsigned long)filterRejected(0),
+           sim::sensorGlitches);
+  printf("%-20s %lu\n", "Turn alarms", turns);
+  if (opt.turner)
+  {
+    double errSum = 0, errMax = 0;
+    int intervals = 0;
+    for (int i = 1; i < sim::trayStats.motions; i++)
+    {
+      if (!timed[i] || !timed[i - 1])
+        continue;
+      double err = (sim::trayStats.startedAt[i] - sim::trayStats.startedAt[i - 1]) / 1e6 - intervalHours * 3600.0;
+      errSum += err;
+      if (fabs(err) > errMax)
+        errMax = fabs(err);
+      intervals++;
+    }
+    TurnerStats turner = turnerStats();
+    printf("%-20s %s: %lu motions, %lu failed, %lu steps, tray %s at %.3f\n", "Turner", opt.turner,
+           (unsigned long)turner.turns, (unsigned long)turner.failures, sim::trayStats.steps,
+           turnerSideName(turnerSide()), sim::trayPosition());
+    if (intervals)
+      printf("%-20s %d intervals of %u h, mean %+.2f s, max %.2f s off\n", "Turn timing", intervals, intervalHours,
+             errSum / intervals, errMax);
+  }
+  for (uint8_t source = 0; source < ALARM_TURN; source++)
+    if (answered[source])
+      printf("%-20s %lu %s acknowledged\n", "Other alarms", answered[source], alarmName((AlarmSource)source));
+  printf("%-20s %lu, mean %.0f ns, max %.1f us\n", "Loop calls", loops, loopNanos / loops, loopMaxNanos / 1000);
+  printf("%-20s %.1f ms of virtual time in one loop()\n", "Worst loop stall", stallMax / 1000.0);
+  tasksReport();
+  printf("%-20s control %.1f ms, service %.1f ms of virtual time\n", "Worst task step",
+         taskStats(TASK_CONTROL).maxStepMicros / 1000.0, taskStats(TASK_SERVICE).maxStepMicros / 1000.0);
+  PowerStats power = powerStats();
+  printf("%-20s awake %.2f%% of the time, %.0f wakeups/h\n", "Light sleep",
+         power.awakeMs * 100.0 / (power.awakeMs + power.asleepMs), power.wakeups * 3600000.0 / (power.awakeMs + power.asleepMs));
+  double controlP99 = probePercentile(PROBE_CONTROL_STEP, 99) / 1000.0;
+  printf("%-20s control p99 %.1f us (max %.1f us), service p99 %.1f us (max %.1f us) of host time\n", "Step latency",
+         controlP99, probeStats(PROBE_CONTROL_STEP).maxNs / 1000.0, probePercentile(PROBE_SERVICE_STEP, 99) / 1000.0,
+         probeStats(PROBE_SERVICE_STEP).maxNs / 1000.0);
+  printf("%-20s %lu bytes in %lu files\n", "Flash written", LittleFS.bytesWritten - flashBase, LittleFS.writeOps - flashOpsBase);
+  if (reset.turnPresses)
+    printf("%-20s %.1f bytes per turn event\n", "", (double)reset.turnFlashBytes / reset.turnPresses);
+  HistoryTally tally = {opt.historyCsv ? fopen(opt.historyCsv, "w") : nullptr, 0, 0};
+  historyRead(0, UINT32_MAX, tallyHistory, &tally);
+  if (tally.csv)
+    fclose(tally.csv);
+  printf("%-20s %lu bytes on flash, %lu samples and %lu transitions read back", "History", (unsigned long)historyBytes(),
+         tally.samples, tally.transitions);
+  if (tally.samples)
+    printf(", %.2f bits per entry", historyBytes() * 8.0 / (tally.samples + tally.transitions));
+  printf("\n");
+  DaysTally stored = {};
+  dayStatsRead(tallyDays, &stored);
+  DayStats today = dayStatsToday(0, millis());
+  stored.trackedMs += today.trackedMs;
+  stored.heaterOnMs += today.heaterOnMs;
+  printf("%-20s %lu days stored, heater on %.2f h accounted vs %.2f h on the pin, mean duty %.1f%%\n", "Day stats",
+         stored.days, stored.heaterOnMs / 3600e3, heaterOnMicros / 3600e6,
+         stored.trackedMs ? stored.heaterOnMs * 100.0 / stored.trackedMs : 0.0);
+  printf("%-20s %lu bytes in %lu transactions, %.1f bytes/s, bus busy %.2f%%\n", "I2C traffic", Wire.bytesSent,
+         Wire.transactions, Wire.bytesSent / (sim::nowMicros / 1e6), Wire.busMicros * 100.0 / sim::nowMicros);
+  printf("%-20s %lu bytes/s since the last task report\n", "LCD traffic", lcdBytesPerSecond());
+  if (opt.lcdNackRate > 0)
+    printf("%-20s %lu writes cut short\n", "LCD faults", sim::lcdNacks);
+  printf("%-20s [%s]\n%-20s [%s]\n", "LCD", sim::lcdRow(0), "", sim::lcdRow(1));
+
+  if (opt.probes)
+  {
+    serialQuiet = false;
+    probesDump();
+  }
+  if (opt.probeBudgetUs && controlP99 > opt.probeBudgetUs)
+  {
+    printf("control step p99 %.1f us is over the %.1f us budget\n", controlP99, opt.probeBudgetUs);
+    return 3;
+  }
+  return 0;
+}
@@ -0,0 +1,277 @@
+/*
+ * Load test of the telemetry server (telemetry_server.h) over real POSIX
+ * sockets on localhost, run with --bench-http N: N WebSocket clients stay
+ * connected while another client fires sequential GET /api/state requests,
+ * and the server is polled as the service task would, pushing a state
+ * frame on every change. A history longer than one answer is read back
+ * page by page first.
+ */
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "telemetry_server.h"
+#include "history.h"
+#include "sim.h"
+
+namespace sim
+{
+
+static const int BENCH_REQUESTS = 5000;
+static const int BENCH_POLLS_PER_CHANGE = 20; // state changes every n polls
+static const int BENCH_WARMUP = 100;          // requests before the heap is measured, for one-off allocations
+static const uint32_t BENCH_HISTORY = 3000;   // samples recorded before the test, about three answers' worth
+
+static int connectTo(uint16_t port)
+{
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, (sockaddr *)&address, sizeof(address)) < 0)
+  {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/** Sends a request and reads until the server closes. @return bytes read */
+static size_t request(uint16_t port, const char *text, char *reply, size_t size)
+{
+  int fd = connectTo(port);
+  if (fd < 0)
+    return 0;
+  send(fd, text, strlen(text), MSG_NOSIGNAL);
+  size_t length = 0;
+  ssize_t got;
+  while (length < size - 1 && (got = recv(fd, reply + length, size - 1 - length, 0)) > 0)
+    length += got;
+  reply[length] = '\0';
+  close(fd);
+  return length;
+}
+
+/** Joins the chunks of a chunked reply's body in place. @return the body */
+static char *dechunk(char *reply)
+{
+  char *body = strstr(reply, "\r\n\r\n");
+  if (!body)
+    return reply;
+  body += 4;
+  char *in = body, *out = body;
+  size_t length;
+  while ((length = strtoul(in, &in, 16)) && !strncmp(in, "\r\n", 2))
+  {
+    memmove(out, in + 2, length);
+    out += length;
+    in += 2 + length + 2;
+  }
+  *out = '\0';
+  return body;
+}
+
+/** Counts the complete text frames in what a WebSocket client received. */
+static unsigned long countFrames(int fd, std::vector<uint8_t> &pending)
+{
+  uint8_t buffer[4096];
+  ssize_t got;
+  while ((got = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0)
+    pending.insert(pending.end(), buffer, buffer + got);
+
+  unsigned long frames = 0;
+  size_t at = 0;
+  while (pending.size() - at >= 2)
+  {
+    size_t length = pending[at + 1] & 0x7F, head = 2;
+    if (length == 126)
+    {
+      if (pending.size() - at < 4)
+        break;
+      length = (pending[at + 2] << 8) | pending[at + 3];
+      head = 4;
+    }
+    if (pending.size() - at < head + length)
+      break;
+    frames += (pending[at] & 0x0F) == 0x1;
+    at += head + length;
+  }
+  pending.erase(pending.begin(), pending.begin() + at);
+  return frames;
+}
+
+int benchTelemetry(int websockets)
+{
+  ControlState state = {};
+  state.temp = 37.4f;
+  state.humidity = 52.1f;
+  state.tempTarget = 37.5f;
+  state.isSensorOk = true;
+  state.heaterOn = true;
+  state.currentDay = 3;
+  state.timeInSeconds = 28800;
+  state.incubationStart = epochAtBoot;
+  state.chamberCount = 2;
+  state.chamberRunning = state.chamberSensorOk = CHAMBER_BIT(0) | CHAMBER_BIT(1);
+  state.chamberHeater = CHAMBER_BIT(0);
+  state.chamberTemp[0] = 374;
+  state.chamberHumidity[0] = 521;
+  state.chamberTemp[1] = 375;
+  state.chamberHumidity[1] = -25;
+  state.chamberDay[0] = state.chamberDay[1] = 3;
+  uint32_t sequence = 1;
+  LittleFS.begin();
+  historyBegin(10, 22);
+  for (uint32_t i = 0; i < BENCH_HISTORY; i++)
+  {
+    historyAddSample(epochAtBoot - (BENCH_HISTORY - i) * 10, 37.0f + i % 8 * 0.1f, 50.0f);
+    historyMaintain();
+  }
+  telemetryBegin(0);
+  telemetryPoll(state, sequence, true, epochAtBoot);
+  uint16_t port = telemetryPort();
+  if (!port)
+  {
+    printf("cannot listen on localhost\n");
+    return 1;
+  }
+
+  std::atomic<bool> done{false};
+  std::atomic<int> completed{0};
+  std::atomic<bool> measured{false}; // the client's thread exit allocates, keep it out of the figure
+  std::atomic<int> failures{0};
+  std::vector<int> sockets;
+  std::vector<std::vector<uint8_t>> pending(websockets);
+  unsigned long framesReceived = 0;
+  double requestNanos = 0;
+  // nothing on the client side allocates once started, so the heap figure is the server's
+  sockets.reserve(websockets);
+  for (std::vector<uint8_t> &buffer : pending)
+    buffer.reserve(1 << 20);
+
+  std::thread client([&] {
+    char reply[2048];
+    for (int i = 0; i < websockets; i++)
+    {
+      int fd = connectTo(port);
+      const char *upgrade = "GET /ws HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                            "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+      send(fd, upgrade, strlen(upgrade), MSG_NOSIGNAL);
+      ssize_t got = recv(fd, reply, sizeof(reply) - 1, 0);
+      reply[got > 0 ? got : 0] = '\0';
+      if (strstr(reply, "503 Service Unavailable"))
+      {
+        close(fd); // over the WebSocket limit
+        continue;
+      }
+      // accept key of the RFC 6455 example handshake
+      if (!strstr(reply, "101 Switching") || !strstr(reply, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo="))
+        failures++;
+      sockets.push_back(fd);
+    }
+
+    // every endpoint once
+    const char *checks[][2] = {{"GET / HTTP/1.1\r\n\r\n", "WebSocket("},
+                               {"GET /api/config HTTP/1.1\r\n\r\n", "\"profile\""},
+                               {"GET /api/history?from=0 HTTP/1.1\r\n\r\n", "\"entries\":[{\"t\":"},
+                               {"POST /api/state HTTP/1.1\r\n\r\n", "405 Method"},
+                               {"GET /wifi.json HTTP/1.1\r\n\r\n", "404 Not Found"}};
+    for (auto &check : checks)
+    {
+      request(port, check[0], reply, sizeof(reply));
+      if (!strstr(reply, check[1]))
+      {
+        printf("unexpected reply to %.*s: %s\n", (int)strcspn(check[0], "\r"), check[0], reply);
+        failures++;
+      }
+    }
+
+    // the whole history, following `next` from one answer to the next
+    static char page[1 << 17];
+    uint32_t from = 0, entries = 0, pages = 0;
+    while (request(port, (std::string("GET /api/history?from=") + std::to_string(from) + " HTTP/1.1\r\n\r\n").c_str(),
+                   page, sizeof(page)))
+    {
+      pages++;
+      const char *body = dechunk(page);
+      for (const char *at = body; (at = strstr(at, "{\"t\":")); at++)
+        entries++;
+      const char *next = strstr(body, "\"next\":");
+      if (!next)
+        break;
+      from = strtoul(next + 7, nullptr, 10);
+    }
+    if (entries != BENCH_HISTORY || pages != (BENCH_HISTORY + 1023) / 1024)
+    {
+      printf("history read back as %u entries in %u answers\n", entries, pages);
+      failures++;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_REQUESTS; i++)
+    {
+      request(port, "GET /api/state HTTP/1.1\r\nHost: localhost\r\n\r\n", reply, sizeof(reply));
+      if (!strstr(reply, "200 OK") || !strstr(reply, "\"temp\":37.4") || !strstr(reply, "\"humidity\":-2.5,"))
+        failures++;
+      for (size_t s = 0; s < sockets.size(); s++)
+        framesReceived += countFrames(sockets[s], pending[s]);
+      completed++;
+    }
+    requestNanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    done = true;
+    while (!measured)
+      std::this_thread::yield();
+  });
+
+  size_t heapBefore = 0;
+  unsigned long polls = 0, measuredPolls = 0;
+  while (!done)
+  {
+    if (!heapBefore && completed >= BENCH_WARMUP)
+      heapBefore = mallinfo2().uordblks;
+    measuredPolls += heapBefore != 0;
+    if (++polls % BENCH_POLLS_PER_CHANGE == 0)
+    {
+      state.timeInSeconds--;
+      sequence++;
+    }
+    telemetryPoll(state, sequence, true, epochAtBoot);
+  }
+  size_t heapAfter = mallinfo2().uordblks;
+  measured = true;
+  client.join();
+
+  // frames still in flight
+  usleep(100000);
+  for (size_t s = 0; s < sockets.size(); s++)
+  {
+    framesReceived += countFrames(sockets[s], pending[s]);
+    close(sockets[s]);
+  }
+  telemetryPoll(state, sequence, false, 0);
+
+  TelemetryStats stats = telemetryStats();
+  printf("%-20s %d GET /api/state with %d WebSocket clients connected (%d requested, at most %d)\n", "HTTP load",
+         BENCH_REQUESTS, (int)sockets.size(), websockets, TELEMETRY_MAX_WEBSOCKETS);
+  printf("%-20s %.0f requests/s, %.1f us per request\n", "Throughput", BENCH_REQUESTS / (requestNanos / 1e9),
+         requestNanos / BENCH_REQUESTS / 1000);
+  printf("%-20s %lu pushed, %lu received, %lu bytes sent in total\n", "WebSocket frames", (unsigned long)stats.frames,
+         framesReceived, (unsigned long)stats.bytesSent);
+  printf("%-20s %lu\n", "Refused connections", (unsigned long)stats.rejected);
+  printf("%-20s %u B static, heap %+ld B over the last %lu polls\n", "Server memory", (unsigned)telemetryMemory(),
+         (long)heapAfter - (long)heapBefore, measuredPolls);
+  printf("%-20s %d\n", "Failed replies", failures.load());
+  return failures ? 1 : 0;
+}
+
+}
@@ -0,0 +1,108 @@
+#include <Arduino.h>
+#include "pins.h"
+#include "sim.h"
+
+/*
+ * Simulated egg tray on the turner's pins.
+ *
+ * A stepper driver moves the tray one step on each rising edge of STEP
+ * while EN is low; a DC bridge moves it at a steady speed while EN is high,
+ * followed on a 1 ms tick. DIR high is towards home, where the end-stop
+ * closes over the first few steps. The tray stops dead at both ends of its
+ * frame, and a jammed one no longer follows the motor at all.
+ */
+
+namespace sim
+{
+
+bool trayJammed = false;
+TrayStats trayStats = {};
+
+static const float SWITCH_WIDTH = 0.005f; // of the travel, from the home end
+static const float FRAME_MARGIN = 0.02f;  // beyond both sides before the frame stops the tray
+static const uint32_t DC_TICK_US = 1000;
+
+static bool dcMotor = false;
+static float perStep = 0;   // travel per step or per DC tick, the whole travel being 1
+static float position = 0;  // 0 home, 1 away
+static bool towardsHome = false;
+static bool driven = false;
+static bool stepLevel = false;
+static uint64_t idleSince = 0;
+static bool motionNoted = true; // for the motor sessions since idleSince
+
+static void move(float by)
+{
+  if (!motionNoted && trayStats.motions < TRAY_MAX_MOTIONS)
+    trayStats.startedAt[trayStats.motions++] = nowMicros;
+  motionNoted = true;
+  if (trayJammed)
+    return;
+  position += towardsHome ? -by : by;
+  if (position < -FRAME_MARGIN)
+    position = -FRAME_MARGIN;
+  if (position > 1 + FRAME_MARGIN)
+    position = 1 + FRAME_MARGIN;
+  bool closed = position <= SWITCH_WIDTH;
+  if ((pinLevel(TURNER_END_STOP_PIN) == LOW) != closed)
+    setInput(TURNER_END_STOP_PIN, closed ? LOW : HIGH);
+}
+
+static void dcTick(void *)
+{
+  if (!driven)
+    return;
+  move(perStep);
+  schedule(nowMicros + DC_TICK_US, dcTick, nullptr);
+}
+
+static void onPin(uint8_t pin, uint8_t mode, int level)
+{
+  (void)mode;
+  if (pin == TURNER_DIR_PIN)
+    towardsHome = level == HIGH;
+  else if (pin == TURNER_ENABLE_PIN)
+  {
+    bool on = dcMotor ? level == HIGH : level == LOW;
+    if (on == driven)
+      return;
+    driven = on;
+    if (on && nowMicros - idleSince >= TRAY_MOTION_GAP_US)
+      motionNoted = false; // on the first step, setting the pins up enables the driver for a moment
+    if (!on)
+      idleSince = nowMicros;
+    if (on && dcMotor)
+      schedule(nowMicros + DC_TICK_US, dcTick, nullptr);
+    else if (dcMotor)
+      cancel(dcTick, nullptr);
+  }
+  else if (pin == TURNER_STEP_PIN)
+  {
+    bool rising = level == HIGH && !stepLevel;
+    stepLevel = level == HIGH;
+    if (rising && driven)
+    {
+      trayStats.steps++;
+      move(perStep);
+    }
+  }
+}
+
+void attachTray(bool dc, uint32_t travel)
+{
+  dcMotor = dc;
+  perStep = dc ? (float)DC_TICK_US / 1000 / travel : 1.0f / travel;
+  position = 0;
+  idleSince = 0;
+  hookPin(TURNER_STEP_PIN, onPin);
+  hookPin(TURNER_DIR_PIN, onPin);
+  hookPin(TURNER_ENABLE_PIN, onPin);
+  setInput(TURNER_END_STOP_PIN, LOW);
+}
+
+float trayPosition()
+{
+  return position;
+}
+
+}
@@ -0,0 +1,275 @@
+#include <Arduino.h>
+#include "alarm_manager.h"
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <driver/ledc.h>
+#include <esp_sleep.h>
+
+#define ALARM_LEDC_MODE LEDC_LOW_SPEED_MODE // the only mode whose timers run on RTC8M, through light sleep
+#define ALARM_LEDC_TIMER LEDC_TIMER_3
+#define ALARM_LEDC_CHANNEL LEDC_CHANNEL_7
+#define ALARM_LEDC_BITS LEDC_TIMER_16_BIT
+#endif
+
+#define ALARM_LOG_SIZE 32
+
+static const unsigned long ALARM_CLEAR_DELAY = 30 * 1000; // in ms, without the condition
+
+/**
+ * A pattern of the active buzzer: on for `dutyPercent` of every period.
+ * LEDC counts whole hertz, so the slowest is one beep a second.
+ */
+struct AlarmPattern
+{
+  uint8_t hz;
+  uint8_t dutyPercent;
+};
+
+static const AlarmPattern PATTERNS[ALARM_SOURCE_COUNT] = {
+    {4, 50}, // over temperature: rapid beeps
+    {2, 25}, // sensor lost: short beeps, twice a second
+    {1, 10}, // humidifier stuck: a chirp a second
+    {1, 50}, // turn: half a second on, half off
+};
+
+static const char *const NAMES[ALARM_SOURCE_COUNT + 1] = {"over_temp", "sensor_lost", "humidifier_stuck", "turn",
+                                                          "none"};
+
+struct SourceState
+{
+  ChamberMask condition; // as last set
+  ChamberMask raised;
+  ChamberMask acknowledged;
+  bool snoozed;
+  unsigned long snoozedAt; // in ms
+  unsigned long snoozeMs;
+  unsigned long seenAt[MAX_CHAMBERS]; // in ms, last step the condition held
+};
+
+static SourceState sources[ALARM_SOURCE_COUNT] = {};
+static AlarmSource sounding = ALARM_NONE;
+static uint8_t buzzerPin = 0;
+static uint32_t lastUnixTime = 0; // of the last step, for the buttons' events
+
+// written by the control task only, the count after the entry
+static AlarmEvent events[ALARM_LOG_SIZE];
+static volatile uint32_t eventCount = 0;
+
+/** Prints the chambers of `mask`, e.g. " 0 2". */
+static void printChambers(ChamberMask mask)
+{
+  for (uint8_t i = 0; mask; i++, mask >>= 1)
+    if (mask & 1)
+    {
+      Serial.print(' ');
+      Serial.print(i);
+    }
+}
+
+/** Prints e.g. "🚨 turn raised, chamber 0". */
+static void printEvent(const AlarmEvent &event)
+{
+  static const char *const EMOJI[] = {"🚨", "✅", "🔕", "💤"};
+  static const char *const KINDS[] = {"raised", "cleared", "acknowledged", "snoozed"};
+  Serial.print(EMOJI[event.kind]);
+  Serial.print(' ');
+  Serial.print(NAMES[event.source]);
+  Serial.print(' ');
+  Serial.print(KINDS[event.kind]);
+  Serial.print(", chamber");
+  printChambers(event.chambers);
+}
+
+static void logEvent(AlarmSource source, AlarmEventKind kind, ChamberMask chambers)
+{
+  AlarmEvent &event = events[eventCount % ALARM_LOG_SIZE];
+  event = {lastUnixTime, source, kind, chambers};
+  eventCount = eventCount + 1;
+  printEvent(event);
+  Serial.println();
+}
+
+/** Plays `source`'s pattern, or silences the buzzer for ALARM_NONE. */
+static void play(AlarmSource source)
+{
+#ifdef ARDUINO_ARCH_ESP32
+  if (source == ALARM_NONE)
+  {
+    ledc_stop(ALARM_LEDC_MODE, ALARM_LEDC_CHANNEL, 0);
+    esp_sleep_pd_config(ESP_PD_DOMAIN_RTC8M, ESP_PD_OPTION_AUTO);
+    return;
+  }
+  const AlarmPattern &pattern = PATTERNS[source];
+  esp_sleep_pd_config(ESP_PD_DOMAIN_RTC8M, ESP_PD_OPTION_ON); // keeps the pattern going in light sleep
+  ledc_timer_config_t timer = {};
+  timer.speed_mode = ALARM_LEDC_MODE;
+  timer.duty_resolution = ALARM_LEDC_BITS;
+  timer.timer_num = ALARM_LEDC_TIMER;
+  timer.freq_hz = pattern.hz;
+  timer.clk_cfg = LEDC_USE_RTC8M_CLK;
+  ledc_timer_config(&timer);
+  ledc_set_duty(ALARM_LEDC_MODE, ALARM_LEDC_CHANNEL, (uint32_t)0xFFFF * pattern.dutyPercent / 100);
+  ledc_update_duty(ALARM_LEDC_MODE, ALARM_LEDC_CHANNEL);
+#else
+  // no LEDC on the native build: the buzzer is held on while an alarm sounds
+  digitalWrite(buzzerPin, source == ALARM_NONE ? LOW : HIGH);
+#endif
+}
+
+/** Sounds the most urgent alarm raised, not acknowledged nor snoozed. */
+static void refresh()
+{
+  AlarmSource next = ALARM_NONE;
+  for (uint8_t source = 0; source < ALARM_SOURCE_COUNT && next == ALARM_NONE; source++)
+  {
+    const SourceState &state = sources[source];
+    if ((state.raised & ~state.acknowledged) && !state.snoozed)
+      next = (AlarmSource)source;
+  }
+  if (next == sounding)
+    return;
+  sounding = next;
+  play(next);
+}
+
+void alarmBegin(uint8_t pin)
+{
+  buzzerPin = pin;
+#ifdef ARDUINO_ARCH_ESP32
+  ledc_timer_config_t timer = {};
+  timer.speed_mode = ALARM_LEDC_MODE;
+  timer.duty_resolution = ALARM_LEDC_BITS;
+  timer.timer_num = ALARM_LEDC_TIMER;
+  timer.freq_hz = 1;
+  timer.clk_cfg = LEDC_USE_RTC8M_CLK;
+  ledc_timer_config(&timer);
+
+  ledc_channel_config_t channel = {};
+  channel.gpio_num = pin;
+  channel.speed_mode = ALARM_LEDC_MODE;
+  channel.channel = ALARM_LEDC_CHANNEL;
+  channel.intr_type = LEDC_INTR_DISABLE;
+  channel.timer_sel = ALARM_LEDC_TIMER;
+  channel.duty = 0;
+  ledc_channel_config(&channel);
+  ledc_stop(ALARM_LEDC_MODE, ALARM_LEDC_CHANNEL, 0);
+#else
+  pinMode(pin, OUTPUT);
+  digitalWrite(pin, LOW);
+#endif
+}
+
+void alarmSet(AlarmSource source, ChamberMask chambers)
+{
+  sources[source].condition = chambers;
+}
+
+void alarmStep(unsigned long now, uint32_t unixTime)
+{
+  lastUnixTime = unixTime;
+  for (uint8_t source = 0; source < ALARM_SOURCE_COUNT; source++)
+  {
+    SourceState &state = sources[source];
+
+    ChamberMask cleared = 0;
+    for (uint8_t i = 0; i < MAX_CHAMBERS; i++)
+    {
+      if (state.condition & CHAMBER_BIT(i))
+        state.seenAt[i] = now;
+      else if ((state.raised & CHAMBER_BIT(i)) && now - state.seenAt[i] >= ALARM_CLEAR_DELAY)
+        cleared |= CHAMBER_BIT(i);
+    }
+
+    ChamberMask raised = state.condition & ~state.raised;
+    if (raised)
+    {
+      state.raised |= raised;
+      state.acknowledged &= ~raised;
+      logEvent((AlarmSource)source, ALARM_RAISED, raised);
+    }
+    if (cleared)
+    {
+      state.raised &= ~cleared;
+      state.acknowledged &= ~cleared;
+      logEvent((AlarmSource)source, ALARM_CLEARED, cleared);
+    }
+
+    if (state.snoozed && (!state.raised || now - state.snoozedAt >= state.snoozeMs))
+      state.snoozed = false;
+  }
+  refresh();
+}
+
+bool alarmNextStep(unsigned long &at)
+{
+  bool armed = false;
+  auto consider = [&](unsigned long due)
+  {
+    if (!armed || (long)(due - at) < 0)
+      at = due;
+    armed = true;
+  };
+  for (const SourceState &state : sources)
+  {
+    for (uint8_t i = 0; i < MAX_CHAMBERS; i++)
+      if ((state.raised & ~state.condition) & CHAMBER_BIT(i))
+        consider(state.seenAt[i] + ALARM_CLEAR_DELAY);
+    if (state.snoozed)
+      consider(state.snoozedAt + state.snoozeMs);
+  }
+  return armed;
+}
+
+AlarmSource alarmSounding()
+{
+  return sounding;
+}
+
+void alarmAcknowledge(AlarmSource source)
+{
+  SourceState &state = sources[source];
+  ChamberMask pending = state.raised & ~state.acknowledged;
+  if (!pending)
+    return;
+  state.acknowledged |= pending;
+  state.snoozed = false;
+  logEvent(source, ALARM_ACKNOWLEDGED, pending);
+  refresh();
+}
+
+void alarmSnooze(AlarmSource source, unsigned long ms)
+{
+  SourceState &state = sources[source];
+  if (!(state.raised & ~state.acknowledged))
+    return;
+  state.snoozed = true;
+  state.snoozedAt = millis();
+  state.snoozeMs = ms;
+  logEvent(source, ALARM_SNOOZED, state.raised & ~state.acknowledged);
+  refresh();
+}
+
+const char *alarmName(AlarmSource source)
+{
+  return NAMES[source < ALARM_SOURCE_COUNT ? source : ALARM_NONE];
+}
+
+void alarmDump()
+{
+  uint32_t count = eventCount;
+  uint32_t first = count > ALARM_LOG_SIZE ? count - ALARM_LOG_SIZE : 0;
+  Serial.print("📋 Alarm log, ");
+  Serial.print(count);
+  Serial.println(" events since boot");
+  for (uint32_t n = first; n < count; n++)
+  {
+    AlarmEvent event = events[n % ALARM_LOG_SIZE];
+    Serial.print("  ");
+    Serial.print(event.time);
+    Serial.print(' ');
+    printEvent(event);
+    Serial.println();
+  }
+  Serial.print("Sounding: ");
+  Serial.println(alarmName(sounding));
+}
@@ -0,0 +1,138 @@
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "buttons.h"
+#include "channel.h"
+#include "pins.h"
+
+#define BUTTON_DEBOUNCE_US 50000     // 50ms is common
+#define BUTTON_DOUBLE_GAP_US 300000  // release to second press
+#define BUTTON_LONG_PRESS_US 2000000
+
+struct Button
+{
+  uint8_t pin;
+  const char *name;
+  esp_timer_handle_t debounceTimer = nullptr;
+  esp_timer_handle_t gestureTimer = nullptr;
+  volatile bool down = false;  // debounced
+  bool longReported = false;   // the current press already made a BUTTON_LONG
+  bool awaitingSecond = false; // released after a short press, a second one makes it a double
+  bool second = false;         // the current press is the second of a double
+};
+
+static Button buttons[BUTTON_COUNT] = {{RESET_BUTTON_PIN, "button_reset"},
+                                       {HUMIDIFIER_PAUSE_BUTTON_PIN, "button_pause"}};
+static SpscQueue<ButtonEvent, 8> events; // timer task -> control task
+static void (*changeCallback)() = nullptr;
+
+static void emit(ButtonId id, ButtonGesture gesture)
+{
+  events.push({id, gesture}); // dropped when full, the control task is far behind anyway
+}
+
+static void IRAM_ATTR onResetEdge()
+{
+  esp_timer_stop(buttons[BUTTON_RESET].debounceTimer);
+  esp_timer_start_once(buttons[BUTTON_RESET].debounceTimer, BUTTON_DEBOUNCE_US);
+}
+
+static void IRAM_ATTR onPauseEdge()
+{
+  esp_timer_stop(buttons[BUTTON_PAUSE].debounceTimer);
+  esp_timer_start_once(buttons[BUTTON_PAUSE].debounceTimer, BUTTON_DEBOUNCE_US);
+}
+
+/** The level has been stable for the debounce time. */
+static void onSettled(void *arg)
+{
+  ButtonId id = (ButtonId)(uintptr_t)arg;
+  Button &button = buttons[id];
+  bool pressed = digitalRead(button.pin) == LOW;
+  if (pressed == button.down)
+    return; // bounced back
+
+  button.down = pressed;
+  esp_timer_stop(button.gestureTimer);
+  if (pressed)
+  {
+    button.longReported = false;
+    button.second = button.awaitingSecond;
+    button.awaitingSecond = false;
+    esp_timer_start_once(button.gestureTimer, BUTTON_LONG_PRESS_US);
+  }
+  else if (!button.longReported)
+  {
+    if (button.second)
+      emit(id, BUTTON_DOUBLE);
+    else
+    {
+      button.awaitingSecond = true;
+      esp_timer_start_once(button.gestureTimer, BUTTON_DOUBLE_GAP_US);
+    }
+  }
+
+  if (changeCallback)
+    changeCallback();
+}
+
+/** Held for the long-press time, or no second press after a short one. */
+static void onGestureTimeout(void *arg)
+{
+  ButtonId id = (ButtonId)(uintptr_t)arg;
+  Button &button = buttons[id];
+  if (button.down)
+  {
+    button.longReported = true;
+    emit(id, BUTTON_LONG);
+  }
+  else if (button.awaitingSecond)
+  {
+    button.awaitingSecond = false;
+    emit(id, BUTTON_CLICK);
+  }
+  else
+    return;
+
+  if (changeCallback)
+    changeCallback();
+}
+
+void buttonsBegin(void (*onChange)())
+{
+  changeCallback = onChange;
+  void (*edgeHandlers[BUTTON_COUNT])() = {onResetEdge, onPauseEdge};
+
+  for (uint8_t id = 0; id < BUTTON_COUNT; id++)
+  {
+    Button &button = buttons[id];
+    pinMode(button.pin, INPUT_PULLUP);
+    button.down = digitalRead(button.pin) == LOW;
+
+    esp_timer_create_args_t args = {};
+    args.arg = (void *)(uintptr_t)id;
+    args.name = button.name;
+    args.callback = onSettled;
+    esp_timer_create(&args, &button.debounceTimer);
+    args.callback = onGestureTimeout;
+    esp_timer_create(&args, &button.gestureTimer);
+
+    attachInterrupt(digitalPinToInterrupt(button.pin), edgeHandlers[id], CHANGE);
+  }
+}
+
+bool buttonsPoll(ButtonEvent &event)
+{
+  return events.pop(event);
+}
+
+bool buttonDown(ButtonId button)
+{
+  return buttons[button].down;
+}
+
+void buttonsResync()
+{
+  for (uint8_t id = 0; id < BUTTON_COUNT; id++)
+    if ((digitalRead(buttons[id].pin) == LOW) != buttons[id].down)
+      esp_timer_start_once(buttons[id].debounceTimer, BUTTON_DEBOUNCE_US);
+}
@@ -0,0 +1,107 @@
+#include <Arduino.h>
+#include "chambers.h"
+#include "sensors.h"
+
+static_assert(MAX_CHAMBERS <= MAX_SENSORS, "every chamber needs a sensor");
+
+static bool pinTaken(uint8_t pin, const uint8_t *reserved, uint8_t reservedCount)
+{
+  if (pin == NO_PIN)
+    return false;
+  for (uint8_t i = 0; i < reservedCount; i++)
+    if (reserved[i] == pin)
+      return true;
+  for (uint8_t i = 0; i < chambers.count; i++)
+    if (chambers.sensorPin[i] == pin || chambers.heaterPin[i] == pin || chambers.humidifierPin[i] == pin)
+      return true;
+  return false;
+}
+
+int8_t chambersAdd(const ChamberPins &pins, const uint8_t *reserved, uint8_t reservedCount)
+{
+  if (chambers.count >= MAX_CHAMBERS || pins.heater == NO_PIN || pins.humidifier == NO_PIN ||
+      pins.sensor == pins.heater || pins.sensor == pins.humidifier || pins.heater == pins.humidifier ||
+      pinTaken(pins.sensor, reserved, reservedCount) ||
+      pinTaken(pins.heater, reserved, reservedCount) || pinTaken(pins.humidifier, reserved, reservedCount))
+    return -1;
+
+  uint8_t i = chambers.count++;
+  chambers.sensorPin[i] = pins.sensor;
+  chambers.heaterPin[i] = pins.heater;
+  chambers.humidifierPin[i] = pins.humidifier;
+  chambers.temp[i] = NAN;
+  chambers.humidity[i] = NAN;
+  chambers.estimate[i] = NAN;
+
+  pinMode(pins.heater, OUTPUT);
+  digitalWrite(pins.heater, LOW);
+  pinMode(pins.humidifier, OUTPUT);
+  digitalWrite(pins.humidifier, LOW);
+  return i;
+}
+
+/** Hysteresis: on below target - hyst, off from target + hyst. */
+static inline bool demand(bool on, float value, float target, float hyst)
+{
+  return on ? value < target + hyst : value < target - hyst;
+}
+
+static void writeChanged(ChamberMask changed, const uint8_t *pins, ChamberMask levels)
+{
+  for (uint8_t i = 0; changed; i++, changed >>= 1)
+    if (changed & 1)
+      digitalWrite(pins[i], levels & CHAMBER_BIT(i) ? HIGH : LOW);
+}
+
+ChamberMask chambersSweep(unsigned long now, unsigned long sensorTimeout, float gainPerSecond, float lossPerSecond)
+{
+  Chambers &c = chambers;
+  ChamberMask heater = c.heaterOn, humidifier = c.humidifierOn, ok = 0;
+
+  for (uint8_t i = 0; i < c.count; i++)
+  {
+    ChamberMask bit = CHAMBER_BIT(i);
+    if (!(c.running & bit))
+      continue;
+
+    if (c.readAt[i] && now - c.readAt[i] < sensorTimeout)
+    {
+      ok |= bit;
+      if (!(c.modelled & bit))
+      {
+        c.estimate[i] = c.temp[i];
+        c.estimatedAt[i] = now;
+      }
+      if (!(c.externalHeater & bit) && demand(heater & bit, c.temp[i], c.tempTarget[i], c.tempHyst[i]) != !!(heater & bit))
+        heater ^= bit;
+      if (!(c.humidifierHeld & bit) &&
+          demand(humidifier & bit, c.humidity[i], c.humidityTarget[i], c.humidityHyst[i]) != !!(humidifier & bit))
+        humidifier ^= bit;
+      continue;
+    }
+
+    if (!(c.modelled & bit))
+    {
+      // the configured rates, from the last reading (or the bottom of the band)
+      if (isnan(c.estimate[i]))
+        c.estimate[i] = c.tempTarget[i] - c.tempHyst[i];
+      else
+        c.estimate[i] += (heater & bit ? gainPerSecond : -lossPerSecond) * (now - c.estimatedAt[i]) / 1000.0f;
+      c.estimatedAt[i] = now;
+    }
+    if (demand(heater & bit, c.estimate[i], c.tempTarget[i], c.tempHyst[i]) != !!(heater & bit))
+      heater ^= bit;
+  }
+
+  c.sensorOk = (c.sensorOk & ~c.running) | ok;
+  c.heaterOn = heater;
+  c.humidifierOn = humidifier;
+
+  ChamberMask humidifierOut = humidifier & ~c.humidifierHeld;
+  ChamberMask switched = heater ^ c.heaterOut;
+  writeChanged(switched, c.heaterPin, heater);
+  writeChanged(humidifierOut ^ c.humidifierOut, c.humidifierPin, humidifierOut);
+  c.heaterOut = heater;
+  c.humidifierOut = humidifierOut;
+  return switched;
+}
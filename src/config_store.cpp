@@ -0,0 +1,172 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include "config_store.h"
+#include "profiles.h"
+#include "sensors.h"
+#include "pins.h"
+#include "fnv1a.h"
+
+#define CONFIG_PATH "/config.json"
+#define IMAGE_PATH "/config.bin"
+#define IMAGE_TMP_PATH "/config.tmp"
+#define IMAGE_MAGIC 0x47464332 // "CFG2"
+
+// Set by the build (-D FIRMWARE_BUILD='"..."', e.g. the commit), or else
+// when this file was compiled, which it is again whenever the defaults it
+// includes change
+#ifndef FIRMWARE_BUILD
+#define FIRMWARE_BUILD __DATE__ " " __TIME__
+#endif
+
+struct ImageHeader
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;     // sizeof(Config)
+  uint32_t build;    // hash of FIRMWARE_BUILD
+  uint32_t jsonHash; // of the config.json it was made from
+  uint32_t check;    // of the Config bytes
+};
+
+static uint32_t buildHash()
+{
+  static const char build[] = FIRMWARE_BUILD;
+  return fnv1a(FNV1A_INIT, build, sizeof(build) - 1);
+}
+
+/** @return Hash of the file at `path`, 0 if it cannot be read. */
+static uint32_t hashFile(const char *path)
+{
+  File file = LittleFS.open(path, FILE_READ);
+  if (!file)
+    return 0;
+  uint8_t chunk[64];
+  uint32_t hash = FNV1A_INIT;
+  size_t n;
+  while ((n = file.read(chunk, sizeof(chunk))) > 0)
+    hash = fnv1a(hash, chunk, n);
+  file.close();
+  return hash;
+}
+
+static bool readImage(uint32_t jsonHash, Config &config)
+{
+  File file = LittleFS.open(IMAGE_PATH, FILE_READ);
+  if (!file)
+    return false;
+  ImageHeader header;
+  bool ok = file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && header.magic == IMAGE_MAGIC &&
+            header.version == CONFIG_VERSION && header.size == sizeof(Config) && header.build == buildHash() &&
+            header.jsonHash == jsonHash &&
+            file.read((uint8_t *)&config, sizeof(config)) == sizeof(config) &&
+            header.check == fnv1a(FNV1A_INIT, &config, sizeof(config));
+  file.close();
+  return ok;
+}
+
+static void writeImage(uint32_t jsonHash, const Config &config)
+{
+  ImageHeader header = {IMAGE_MAGIC, CONFIG_VERSION, sizeof(Config), buildHash(), jsonHash,
+                        fnv1a(FNV1A_INIT, &config, sizeof(config))};
+  File file = LittleFS.open(IMAGE_TMP_PATH, FILE_WRITE);
+  bool ok = file && file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+            file.write((const uint8_t *)&config, sizeof(config)) == sizeof(config);
+  file.close();
+  if (!ok || !LittleFS.rename(IMAGE_TMP_PATH, IMAGE_PATH))
+    Serial.println("❌ Config image write failed, config.json is parsed again next boot");
+}
+
+static void parseChamber(JsonObject json, bool primary, uint8_t profile, ChamberConfig &chamber)
+{
+  chamber.sensor = sensorType(json["sensor"] | "dht22");
+  chamber.sensorAddress = chamber.sensor != SENSOR_TYPE_COUNT && sensorOnBus((SensorType)chamber.sensor)
+                              ? json["sensor_address"] | sensorDefaultAddress((SensorType)chamber.sensor)
+                              : 0;
+  chamber.pins = {json["sensor_pin"] | (primary ? (uint8_t)DHT22_PIN : NO_PIN),
+                  json["heater_pin"] | (primary ? (uint8_t)TEMP_RELAY_PIN : NO_PIN),
+                  json["humidifier_pin"] | (primary ? (uint8_t)HUMIDIFIER_MOSFET_PIN : NO_PIN)};
+  const char *name = json["profile"].as<const char *>();
+  chamber.profile = name ? (uint8_t)profileId(name) : profile;
+  chamber.incubationStart = json["incubation_start_date"] | 0UL;
+  chamber.heaterWatts = json["heater_watts"] | (uint16_t)0;
+  chamber.humidifierWatts = json["humidifier_watts"] | (uint16_t)0;
+}
+
+static bool parseJson(Config &config)
+{
+  File file = LittleFS.open(CONFIG_PATH, FILE_READ);
+  if (!file)
+  {
+    Serial.println("Error opening config file");
+    return false;
+  }
+  StaticJsonDocument<2048> doc; /* arduinojson.org/v6/assistant, 8 chambers with every field */
+  DeserializationError error = deserializeJson(doc, file);
+  file.close();
+  if (error != DeserializationError::Ok)
+  {
+    Serial.println("Error deserializing config file");
+    return false;
+  }
+
+  JsonObject temperature = doc["temperature"];
+  JsonObject humidity = doc["humidity"];
+  JsonObject turning = doc["turning"];
+  JsonObject pid = temperature["pid"];
+  JsonObject failover = doc["failover"];
+  JsonObject filter = doc["filter"];
+  JsonObject telemetry = doc["telemetry"];
+
+  memset(&config, 0, sizeof(config));
+  config.incubationStart = doc["incubation_start_date"] | 0UL;
+  config.lastTurn = turning["last_turn_time"] | 0UL;
+
+  config.tempOffset = temperature["offset"] | 0.0f;
+  config.tempHyst = temperature["hysteresis"] | NAN;
+  config.humidityOffset = humidity["offset"] | 0.0f;
+  config.humidityHyst = humidity["hysteresis"] | NAN;
+  config.turnsPerDay = turning["turns_per_day"] | (uint8_t)0;
+  if (config.turnsPerDay && 24 % config.turnsPerDay)
+  {
+    Serial.println("❌ turns_per_day does not divide 24, using the profile's");
+    config.turnsPerDay = 0;
+  }
+  const char *motor = turning["motor"] | "none";
+  config.turner = {(uint8_t)(!strcmp(motor, "stepper") ? TURNER_STEPPER : !strcmp(motor, "dc") ? TURNER_DC : TURNER_NONE),
+                   turning["travel_steps"] | (uint16_t)1600, turning["step_hz"] | (uint16_t)800,
+                   turning["ramp_steps"] | (uint16_t)200, (uint16_t)((turning["travel_seconds"] | 20.0f) * 1000)};
+  if (config.turner.motor == TURNER_NONE && strcmp(motor, "none"))
+    Serial.println("❌ Unknown turner motor, turning by hand");
+
+  config.heaterMode = strcmp(temperature["control"] | "hysteresis", "pid") ? HEATER_HYSTERESIS : HEATER_PID;
+  config.pid = {pid["kp"] | 0.0f, pid["ki"] | 0.0f, pid["kd"] | 0.0f, pid["window_seconds"] | (uint16_t)120,
+                pid["min_switch_seconds"] | (uint16_t)10};
+  config.tempLossPerSecond = failover["temp_loss_per_second"];
+  config.tempGainPerSecond = failover["temp_gain_per_second"];
+  config.filter = {filter["median_seconds"] | (uint8_t)3, filter["max_temp_rate"] | 0.1f,
+                   filter["max_humidity_rate"] | 0.5f, filter["ema_seconds"] | 0.0f};
+
+  config.telemetry = telemetry["enabled"] | false;
+  config.telemetryPort = telemetry["port"] | (uint16_t)80;
+
+  uint8_t profile = profileId(doc["profile"] | "chicken");
+  JsonArray list = doc["chambers"];
+  if (list.size() > MAX_CHAMBERS)
+    Serial.println("❌ More chambers than MAX_CHAMBERS, the last ones are skipped");
+  config.chamberCount = !list.size() ? 1 : list.size() < MAX_CHAMBERS ? list.size() : MAX_CHAMBERS;
+  for (uint8_t i = 0; i < config.chamberCount; i++)
+    parseChamber(list[i], i == 0, profile, config.chambers[i]);
+  return true;
+}
+
+ConfigLoad configLoad(Config &config)
+{
+  uint32_t jsonHash = hashFile(CONFIG_PATH);
+  if (jsonHash && readImage(jsonHash, config))
+    return CONFIG_CACHED;
+  if (!parseJson(config))
+    return CONFIG_MISSING;
+  writeImage(jsonHash, config);
+  return CONFIG_PARSED;
+}
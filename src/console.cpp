@@ -0,0 +1,89 @@
+#include <Arduino.h>
+#include "console.h"
+#include "probes.h"
+#include "tasks.h"
+#include "sensors.h"
+#include "sample_filter.h"
+#include "alarm_manager.h"
+#include "wifi_manager.h"
+#include "turner.h"
+#include "day_stats.h"
+
+#define LINE_MAX 32
+
+static char line[LINE_MAX];
+static uint8_t lineLength = 0;
+static bool lineOverflow = false;
+
+/** One line per sensor: its type, failed conversions and readings the filter rejected. */
+static void sensorsReport()
+{
+  for (uint8_t i = 0; i < MAX_SENSORS && *sensorName(i); i++)
+  {
+    Serial.print("🌡️ Sensor ");
+    Serial.print(i);
+    Serial.print(" (");
+    Serial.print(sensorName(i));
+    Serial.print("): ");
+    Serial.print(sensorErrors(i));
+    Serial.print(" failed, ");
+    Serial.print(filterRejected(i));
+    Serial.println(" rejected");
+  }
+}
+
+static void runCommand(const char *command)
+{
+  if (!strcmp(command, "probes"))
+    probesDump();
+  else if (!strcmp(command, "probes reset"))
+  {
+    probesReset();
+    Serial.println("✅ Probes cleared");
+  }
+  else if (!strcmp(command, "tasks"))
+    tasksReport();
+  else if (!strcmp(command, "sensors"))
+    sensorsReport();
+  else if (!strcmp(command, "alarms"))
+    alarmDump();
+  else if (!strcmp(command, "wifi"))
+    wifiReport();
+  else if (!strcmp(command, "turner"))
+    turnerReport();
+  else if (!strcmp(command, "days"))
+    dayStatsReport();
+  else if (!strcmp(command, "help"))
+    Serial.println("Commands: probes, probes reset, tasks, sensors, alarms, wifi, turner, days, help");
+  else if (*command)
+  {
+    Serial.print("❌ Unknown command: ");
+    Serial.println(command);
+  }
+}
+
+void consolePoll()
+{
+  while (Serial.available() > 0)
+  {
+    char c = Serial.read();
+    if (c == '\r')
+      continue;
+    if (c != '\n')
+    {
+      if (lineLength < LINE_MAX - 1)
+        line[lineLength++] = c;
+      else
+        lineOverflow = true;
+      continue;
+    }
+
+    line[lineLength] = '\0';
+    if (lineOverflow)
+      Serial.println("❌ Command too long");
+    else
+      runCommand(line);
+    lineLength = 0;
+    lineOverflow = false;
+  }
+}
@@ -0,0 +1,361 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "day_stats.h"
+#include "channel.h"
+
+#define DAYS_PATH "/days.bin"
+#define DAYS_PREV_PATH "/days.prev"
+#define TODAY_PATH "/today.bin"
+#define TODAY_TMP_PATH "/today.tmp"
+#define DAYS_MAX_BYTES 16384 // start over beyond this, about 300 chamber days
+#define PENDING_SIZE 16      // days between two dayStatsMaintain() calls
+
+/** A chamber's day in progress: the sums up to `since`, and what runs on from then. */
+struct RunningDay
+{
+  DayStats stats;
+  unsigned long since; // in ms
+  bool heater;
+  bool humidifier;
+  bool tempOut;
+  bool humidityOut;
+};
+
+/** What the other tasks read, see dayStatsToday(). */
+struct DayStatsView
+{
+  RunningDay today[MAX_CHAMBERS];
+};
+
+/** A day for dayStatsMaintain(), closed or checkpointed, in the order they came. */
+struct PendingDay
+{
+  DayStats stats;
+  bool closed;
+};
+
+// control task
+static DayStatsView view = {};
+static uint8_t chamberCount = 0;
+static ChamberMask lastHeater = 0;
+static ChamberMask lastHumidifier = 0;
+static bool changed = false; // since the last publish
+
+static uint16_t heaterWatts[MAX_CHAMBERS] = {};
+static uint16_t humidifierWatts[MAX_CHAMBERS] = {};
+static Snapshot<DayStatsView> published;
+static SpscQueue<PendingDay, PENDING_SIZE> pending; // control task -> dayStatsMaintain()
+
+// service task
+static DayStats saved[MAX_CHAMBERS] = {}; // as in /today.bin
+
+static void startDay(DayStats &stats, uint8_t chamber, uint8_t day, uint32_t unixTime)
+{
+  stats = {};
+  stats.magic = DAY_STATS_MAGIC;
+  stats.chamber = chamber;
+  stats.day = day;
+  stats.start = unixTime;
+  stats.tempMin = stats.humidityMin = INT16_MAX;
+  stats.tempMax = stats.humidityMax = INT16_MIN;
+}
+
+/** Adds the time since the last update to the figures that ran on through it. */
+static void advance(RunningDay &running, unsigned long now)
+{
+  uint32_t elapsed = now - running.since;
+  running.since = now;
+  DayStats &stats = running.stats;
+  stats.trackedMs += elapsed;
+  if (running.heater)
+    stats.heaterOnMs += elapsed;
+  if (running.humidifier)
+    stats.humidifierOnMs += elapsed;
+  if (running.tempOut)
+    stats.tempOutMs += elapsed;
+  if (running.humidityOut)
+    stats.humidityOutMs += elapsed;
+}
+
+void dayStatsBegin(uint8_t count)
+{
+  chamberCount = count;
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < count; i++)
+  {
+    startDay(view.today[i].stats, i, 0, 0);
+    view.today[i].since = now;
+  }
+
+  File file = LittleFS.open(TODAY_PATH, FILE_READ);
+  DayStats stats;
+  while (file && file.read((uint8_t *)&stats, sizeof(stats)) == sizeof(stats))
+    if (stats.magic == DAY_STATS_MAGIC && stats.chamber < count && stats.day)
+    {
+      view.today[stats.chamber].stats = stats;
+      saved[stats.chamber] = stats;
+    }
+  file.close();
+  changed = true;
+}
+
+void dayStatsPower(uint8_t chamber, uint16_t heater, uint16_t humidifier)
+{
+  heaterWatts[chamber] = heater;
+  humidifierWatts[chamber] = humidifier;
+}
+
+void dayStatsActuators(unsigned long now, ChamberMask heater, ChamberMask humidifier)
+{
+  ChamberMask heaterSwitched = heater ^ lastHeater, humidifierSwitched = humidifier ^ lastHumidifier;
+  if (!(heaterSwitched | humidifierSwitched))
+    return;
+  for (uint8_t i = 0; i < chamberCount; i++)
+  {
+    ChamberMask bit = CHAMBER_BIT(i);
+    if (!((heaterSwitched | humidifierSwitched) & bit))
+      continue;
+    RunningDay &running = view.today[i];
+    advance(running, now);
+    if (heaterSwitched & bit)
+      running.stats.heaterSwitches++;
+    if (humidifierSwitched & bit)
+      running.stats.humidifierSwitches++;
+    running.heater = heater & bit;
+    running.humidifier = humidifier & bit;
+  }
+  lastHeater = heater;
+  lastHumidifier = humidifier;
+  changed = true;
+}
+
+void dayStatsReading(uint8_t chamber, unsigned long now, float temp, float humidity, bool tempOut, bool humidityOut)
+{
+  RunningDay &running = view.today[chamber];
+  if (tempOut != running.tempOut || humidityOut != running.humidityOut)
+  {
+    advance(running, now);
+    running.tempOut = tempOut;
+    running.humidityOut = humidityOut;
+  }
+
+  DayStats &stats = running.stats;
+  int16_t t = lroundf(temp * 10), h = lroundf(humidity * 10);
+  if (t < stats.tempMin)
+    stats.tempMin = t;
+  if (t > stats.tempMax)
+    stats.tempMax = t;
+  if (h < stats.humidityMin)
+    stats.humidityMin = h;
+  if (h > stats.humidityMax)
+    stats.humidityMax = h;
+  stats.tempSum += t;
+  stats.humiditySum += h;
+  stats.readings++;
+  changed = true;
+}
+
+void dayStatsRollover(uint8_t chamber, unsigned long now, uint32_t unixTime, uint8_t day)
+{
+  RunningDay &running = view.today[chamber];
+  if (running.stats.day == day)
+    return;
+  advance(running, now);
+  if (running.stats.day)
+  {
+    dayStatsPrint(running.stats);
+    if (!pending.push({running.stats, true}))
+      Serial.println("❌ Day stats queue full, a day is not stored");
+  }
+  startDay(running.stats, chamber, day, unixTime);
+  changed = true;
+}
+
+void dayStatsCheckpoint(unsigned long now)
+{
+  for (uint8_t i = 0; i < chamberCount; i++)
+  {
+    RunningDay &running = view.today[i];
+    if (!running.stats.day)
+      continue;
+    advance(running, now);
+    pending.push({running.stats, false}); // the next checkpoint makes up for a full queue
+  }
+  changed = true;
+}
+
+void dayStatsPublish()
+{
+  if (!changed)
+    return;
+  published.publish(view);
+  changed = false;
+}
+
+/** Appends a closed day, starting a new file beyond DAYS_MAX_BYTES. */
+static void storeDay(const DayStats &stats)
+{
+  File file = LittleFS.open(DAYS_PATH, FILE_READ);
+  size_t size = file ? file.size() : 0;
+  file.close();
+  if (size >= DAYS_MAX_BYTES)
+  {
+    LittleFS.remove(DAYS_PREV_PATH);
+    LittleFS.rename(DAYS_PATH, DAYS_PREV_PATH);
+  }
+
+  file = LittleFS.open(DAYS_PATH, FILE_APPEND);
+  if (!file || file.write((const uint8_t *)&stats, sizeof(stats)) != sizeof(stats))
+    Serial.println("❌ Day stats write failed");
+  file.close();
+}
+
+/** Rewrites /today.bin with the days in progress, whole or not at all. */
+static void storeToday()
+{
+  File file = LittleFS.open(TODAY_TMP_PATH, FILE_WRITE);
+  bool ok = file;
+  for (uint8_t i = 0; ok && i < MAX_CHAMBERS; i++)
+    if (saved[i].magic == DAY_STATS_MAGIC)
+      ok = file.write((const uint8_t *)&saved[i], sizeof(saved[i])) == sizeof(saved[i]);
+  file.close();
+  if (ok)
+    LittleFS.rename(TODAY_TMP_PATH, TODAY_PATH);
+  else
+    Serial.println("❌ Day stats checkpoint failed");
+}
+
+void dayStatsMaintain()
+{
+  bool dirty = false;
+  PendingDay day;
+  while (pending.pop(day))
+  {
+    DayStats &slot = saved[day.stats.chamber];
+    if (day.closed)
+    {
+      storeDay(day.stats);
+      // no longer in progress, a reboot must not close it twice
+      if (slot.magic == DAY_STATS_MAGIC && slot.day == day.stats.day)
+      {
+        slot = {};
+        dirty = true;
+      }
+    }
+    else
+    {
+      slot = day.stats;
+      dirty = true;
+    }
+  }
+  if (dirty)
+    storeToday();
+}
+
+DayStats dayStatsToday(uint8_t chamber, unsigned long now)
+{
+  static DayStatsView copy; // too large for the service task's stack
+  published.read(copy);
+  RunningDay &running = copy.today[chamber];
+  advance(running, now);
+  return running.stats;
+}
+
+uint32_t dayStatsRead(DayStatsCallback callback, void *context)
+{
+  uint32_t delivered = 0;
+  bool more = true;
+  for (const char *path : {DAYS_PREV_PATH, DAYS_PATH})
+  {
+    File file = LittleFS.open(path, FILE_READ);
+    DayStats stats;
+    while (more && file && file.read((uint8_t *)&stats, sizeof(stats)) == sizeof(stats))
+      if (stats.magic == DAY_STATS_MAGIC)
+      {
+        delivered++;
+        more = callback(stats, context);
+      }
+    file.close();
+  }
+  return delivered;
+}
+
+/** Prints `part` of `whole` as a percentage with one decimal. */
+static void printShare(uint32_t part, uint32_t whole)
+{
+  Serial.print(whole ? part * 100.0 / whole : 0.0, 1);
+  Serial.print('%');
+}
+
+/** Prints "min/mean/max unit" of readings in tenths. */
+static void printRange(int16_t min, int32_t sum, int16_t max, uint32_t readings, const char *unit)
+{
+  Serial.print(min / 10.0, 1);
+  Serial.print('/');
+  Serial.print(sum / 10.0 / readings, 1);
+  Serial.print('/');
+  Serial.print(max / 10.0, 1);
+  Serial.print(unit);
+}
+
+/** Prints e.g. "heater 34.2% (8.21 h, 412 switches, 328 Wh)". */
+static void printActuator(const char *name, uint32_t onMs, uint32_t trackedMs, uint16_t switches, uint16_t watts)
+{
+  Serial.print(name);
+  Serial.print(' ');
+  printShare(onMs, trackedMs);
+  Serial.print(" (");
+  Serial.print(onMs / 3600000.0);
+  Serial.print(" h, ");
+  Serial.print(switches);
+  Serial.print(" switches");
+  if (watts)
+  {
+    Serial.print(", ");
+    Serial.print(onMs / 3600000.0 * watts, 0);
+    Serial.print(" Wh");
+  }
+  Serial.print(')');
+}
+
+void dayStatsPrint(const DayStats &stats)
+{
+  Serial.print("⚡ Chamber ");
+  Serial.print(stats.chamber);
+  Serial.print(" day ");
+  Serial.print(stats.day);
+  Serial.print(": ");
+  printActuator("heater", stats.heaterOnMs, stats.trackedMs, stats.heaterSwitches, heaterWatts[stats.chamber]);
+  printActuator(", humidifier", stats.humidifierOnMs, stats.trackedMs, stats.humidifierSwitches,
+                humidifierWatts[stats.chamber]);
+  if (stats.readings)
+  {
+    Serial.print(", ");
+    printRange(stats.tempMin, stats.tempSum, stats.tempMax, stats.readings, " C, ");
+    printRange(stats.humidityMin, stats.humiditySum, stats.humidityMax, stats.readings, " %RH");
+  }
+  else
+    Serial.print(", no readings");
+  Serial.print(", out of band ");
+  printShare(stats.tempOutMs, stats.trackedMs);
+  Serial.print(" / ");
+  printShare(stats.humidityOutMs, stats.trackedMs);
+  Serial.print(" of ");
+  Serial.print(stats.trackedMs / 3600000.0);
+  Serial.println(" h");
+}
+
+static bool printStored(const DayStats &stats, void *)
+{
+  dayStatsPrint(stats);
+  return true;
+}
+
+void dayStatsReport()
+{
+  uint32_t stored = dayStatsRead(printStored, nullptr);
+  Serial.print(stored);
+  Serial.println(" days stored, so far today:");
+  for (uint8_t i = 0; i < chamberCount; i++)
+    dayStatsPrint(dayStatsToday(i, millis()));
+}
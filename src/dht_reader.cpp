@@ -0,0 +1,172 @@
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "dht_reader.h"
+
+#define DHT_START_PULSE_US 1100 // host start signal, datasheet asks for >= 1 ms
+#define DHT_FRAME_US 6000       // response + 40 bits take at most ~5.2 ms
+#define DHT_RESPONSE_MIN_US 60  // sensor answers with 80 us low + 80 us high
+#define DHT_RESPONSE_MAX_US 110
+#define DHT_BIT_LOW_MAX_US 90   // every bit starts with ~50 us low
+#define DHT_BIT_ONE_MIN_US 48   // high ~26 us means 0, ~70 us means 1
+#define DHT_BIT_HIGH_MAX_US 100
+#define DHT_FRAME_EDGES 83      // from the first falling edge: response + 40 bits
+
+/** One sensor's line and the frame being captured on it. */
+struct DhtLine
+{
+  uint8_t pin;
+  esp_timer_handle_t startTimer;
+  volatile bool capturing;
+  bool converting;
+  volatile unsigned long releasedAt; // in us
+
+  volatile uint32_t edges[DHT_MAX_PULSES + 2];
+  volatile uint8_t edgeCount;
+  volatile uint8_t firstEdgeLevel;
+  volatile bool frameComplete;
+};
+
+static DhtLine lines[DHT_MAX_SENSORS];
+static unsigned long errors = 0;
+static void (*frameCallback)() = nullptr;
+
+static void IRAM_ATTR onDhtEdge(void *arg)
+{
+  DhtLine &line = *(DhtLine *)arg;
+  uint8_t n = line.edgeCount;
+  if (n >= DHT_MAX_PULSES + 2)
+    return;
+  line.edges[n] = micros();
+  if (n == 0)
+    line.firstEdgeLevel = digitalRead(line.pin);
+  line.edgeCount = n + 1;
+
+  if (n + 1 - (line.firstEdgeLevel == HIGH ? 1 : 0) == DHT_FRAME_EDGES)
+  {
+    line.frameComplete = true;
+    if (frameCallback)
+      frameCallback();
+  }
+}
+
+static void onStartPulseDone(void *arg)
+{
+  DhtLine &line = *(DhtLine *)arg;
+  line.edgeCount = 0;
+  line.frameComplete = false;
+  attachInterruptArg(digitalPinToInterrupt(line.pin), onDhtEdge, &line, CHANGE);
+  line.releasedAt = micros();
+  pinMode(line.pin, INPUT_PULLUP); // release the line, the sensor replies ~30 us later
+  line.capturing = true;
+}
+
+void dhtBegin(uint8_t sensor, uint8_t pin)
+{
+  if (sensor >= DHT_MAX_SENSORS)
+    return;
+  DhtLine &line = lines[sensor];
+  line.pin = pin;
+  line.firstEdgeLevel = HIGH;
+  pinMode(pin, INPUT_PULLUP);
+
+  if (!line.startTimer)
+  {
+    esp_timer_create_args_t args = {};
+    args.callback = onStartPulseDone;
+    args.arg = &line;
+    args.name = "dht_start";
+    esp_timer_create(&args, &line.startTimer);
+  }
+}
+
+void dhtOnFrame(void (*callback)())
+{
+  frameCallback = callback;
+}
+
+bool dhtStart(uint8_t sensor)
+{
+  if (sensor >= DHT_MAX_SENSORS)
+    return false;
+  DhtLine &line = lines[sensor];
+  if (!line.startTimer || line.converting)
+    return false;
+
+  line.converting = true;
+  line.capturing = false;
+  pinMode(line.pin, OUTPUT);
+  digitalWrite(line.pin, LOW);
+  esp_timer_start_once(line.startTimer, DHT_START_PULSE_US);
+  return true;
+}
+
+DhtStatus dhtPoll(uint8_t sensor, DhtSample &out)
+{
+  if (sensor >= DHT_MAX_SENSORS)
+    return DHT_IDLE;
+  DhtLine &line = lines[sensor];
+  if (!line.converting)
+    return DHT_IDLE;
+  if (!line.capturing || (!line.frameComplete && micros() - line.releasedAt < DHT_FRAME_US))
+    return DHT_PENDING;
+
+  detachInterrupt(digitalPinToInterrupt(line.pin));
+  line.capturing = false;
+  line.converting = false;
+
+  // Edge timestamps -> LOW/HIGH pulse widths, starting at the first falling
+  // edge (the release itself may or may not have been caught as a rising one).
+  uint8_t count = line.edgeCount;
+  uint8_t first = line.firstEdgeLevel == HIGH ? 1 : 0;
+  uint16_t pulses[DHT_MAX_PULSES];
+  uint8_t pulseCount = 0;
+  for (uint8_t i = first; i + 1 < count && pulseCount < DHT_MAX_PULSES; i++)
+    pulses[pulseCount++] = line.edges[i + 1] - line.edges[i];
+
+  DhtStatus status = count == 0 ? DHT_NO_REPLY : dhtDecode(pulses, pulseCount, out);
+  if (status != DHT_OK)
+    errors++;
+  return status;
+}
+
+DhtStatus dhtDecode(const uint16_t *pulses, uint8_t count, DhtSample &out)
+{
+  // Locate the response: a long low followed by a long high. Pulses come in
+  // LOW/HIGH pairs, so only even indices can start it.
+  uint8_t start = 0;
+  while (start + 1 < count &&
+         !(pulses[start] >= DHT_RESPONSE_MIN_US && pulses[start] <= DHT_RESPONSE_MAX_US &&
+           pulses[start + 1] >= DHT_RESPONSE_MIN_US && pulses[start + 1] <= DHT_RESPONSE_MAX_US))
+    start += 2;
+
+  if (start + 1 >= count)
+    return count ? DHT_BAD_FRAME : DHT_NO_REPLY;
+
+  // 40 bits, each one LOW/HIGH pair after the response
+  if (start + 2 + 80 > count)
+    return DHT_BAD_FRAME;
+
+  uint8_t bytes[5] = {0};
+  for (uint8_t bit = 0; bit < 40; bit++)
+  {
+    uint16_t low = pulses[start + 2 + bit * 2];
+    uint16_t high = pulses[start + 3 + bit * 2];
+    if (low > DHT_BIT_LOW_MAX_US || high > DHT_BIT_HIGH_MAX_US)
+      return DHT_BAD_FRAME;
+    bytes[bit / 8] = (bytes[bit / 8] << 1) | (high >= DHT_BIT_ONE_MIN_US ? 1 : 0);
+  }
+
+  if ((uint8_t)(bytes[0] + bytes[1] + bytes[2] + bytes[3]) != bytes[4])
+    return DHT_CHECKSUM;
+
+  out.humidity = ((bytes[0] << 8) | bytes[1]) / 10.0f;
+  out.temperature = (((bytes[2] & 0x7F) << 8) | bytes[3]) / 10.0f;
+  if (bytes[2] & 0x80)
+    out.temperature = -out.temperature;
+  return DHT_OK;
+}
+
+unsigned long dhtErrorCount()
+{
+  return errors;
+}
@@ -0,0 +1,244 @@
+#include <Arduino.h>
+#include <string.h>
+#include "heater_control.h"
+#include "state_journal.h"
+
+#define MAX_SAMPLE_GAP 60      // in s, longer gaps (sensor dropouts) restart the derivative
+#define DERIVATIVE_SMOOTHING 0.3f // EMA weight of the newest derivative, the DHT22 steps in 0.1 C
+
+#define AUTOTUNE_HYST 0.2f  // in C, relay hysteresis around the target, above the sensor's noise
+#define AUTOTUNE_CYCLES 4   // measured oscillations, after the warm-up one
+#define AUTOTUNE_AMPLITUDE 0.5f // relay swings 0..1, i.e. +-0.5 around its mean
+
+static PidConfig config;
+static float integral = 0;
+static float derivative = 0;
+static float duty = 0;
+static float lastTemp = NAN;
+static unsigned long lastSampleAt = 0;
+
+static bool windowOpen = false;
+static unsigned long windowStart = 0; // in ms
+static unsigned long windowOnMs = 0;
+
+// relay-feedback autotune
+static bool tuning = false;
+static bool tuneRelay = false;
+static uint8_t tuneCycles = 0;           // completed oscillations, the first one is discarded
+static unsigned long tuneCycleStart = 0; // in ms, last switch-off
+static unsigned long tuneOnMs = 0;       // heater on-time of the current oscillation
+static unsigned long tuneOnSince = 0;
+static float tuneMax, tuneMin;
+static float tuneAmplitudeSum, tunePeriodSum, tuneDutySum;
+
+static uint32_t floatBits(float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static float bitsFloat(uint32_t bits)
+{
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+void pidBegin(const PidConfig &pidConfig)
+{
+  config = pidConfig;
+  if (config.kp == 0 && config.ki == 0 && config.kd == 0)
+  {
+    config.kp = bitsFloat(journalGet(STATE_PID_KP, 0));
+    config.ki = bitsFloat(journalGet(STATE_PID_KI, 0));
+    config.kd = bitsFloat(journalGet(STATE_PID_KD, 0));
+  }
+  if (config.kp == 0)
+    pidStartAutotune();
+}
+
+void pidStartAutotune()
+{
+  tuning = true;
+  tuneRelay = false;
+  tuneCycles = 0;
+  tuneCycleStart = 0;
+  tuneOnMs = 0;
+  tuneAmplitudeSum = tunePeriodSum = tuneDutySum = 0;
+  tuneMax = -INFINITY;
+  tuneMin = INFINITY;
+  Serial.println("🎛️ PID autotune started");
+}
+
+bool pidAutotuning()
+{
+  return tuning;
+}
+
+PidConfig pidConfig()
+{
+  PidConfig gains = config;
+  if (tuning)
+    gains.kp = gains.ki = gains.kd = 0;
+  return gains;
+}
+
+/**
+ * Ends an oscillation of the relay test at a switch-off and, once enough
+ * have been seen, derives the gains (Ziegler-Nichols ultimate-gain method
+ * with the more conservative Tyreus-Luyben rule, the chamber being slow and
+ * overshoot costly).
+ */
+static void autotuneCycle(unsigned long now)
+{
+  if (tuneCycleStart && tuneCycles++ > 0)
+  {
+    tuneAmplitudeSum += (tuneMax - tuneMin) / 2;
+    tunePeriodSum += (now - tuneCycleStart) / 1000.0f;
+    tuneDutySum += (float)tuneOnMs / (now - tuneCycleStart);
+  }
+  tuneCycleStart = now;
+  tuneOnMs = 0;
+  tuneMax = -INFINITY;
+  tuneMin = INFINITY;
+
+  if (tuneCycles <= AUTOTUNE_CYCLES)
+    return;
+
+  float amplitude = tuneAmplitudeSum / AUTOTUNE_CYCLES;
+  float period = tunePeriodSum / AUTOTUNE_CYCLES;
+  // describing function of a relay with hysteresis
+  float effective = amplitude > AUTOTUNE_HYST ? sqrtf(amplitude * amplitude - AUTOTUNE_HYST * AUTOTUNE_HYST) : amplitude;
+  float ultimateGain = 4 * AUTOTUNE_AMPLITUDE / (PI * effective);
+
+  config.kp = ultimateGain / 3.2f;
+  config.ki = config.kp / (2.2f * period);
+  config.kd = config.kp * period / 6.3f;
+  journalSet(STATE_PID_KP, floatBits(config.kp));
+  journalSet(STATE_PID_KI, floatBits(config.ki));
+  journalSet(STATE_PID_KD, floatBits(config.kd));
+
+  // bumpless start: the integral takes over the duty the relay settled at,
+  // and the first window runs at that duty whatever the temperature is at
+  // the switch-off that ended the test
+  integral = duty = tuneDutySum / AUTOTUNE_CYCLES;
+  derivative = 0;
+  lastTemp = NAN;
+  windowOpen = false;
+  tuning = false;
+
+  Serial.print("🎛️ PID autotune done: Ku=");
+  Serial.print(ultimateGain, 3);
+  Serial.print(" Tu=");
+  Serial.print(period, 0);
+  Serial.print("s Kp=");
+  Serial.print(config.kp, 4);
+  Serial.print(" Ki=");
+  Serial.print(config.ki, 6);
+  Serial.print(" Kd=");
+  Serial.println(config.kd, 4);
+}
+
+static bool autotuneDemand(float temp, bool newSample, float target)
+{
+  unsigned long now = millis();
+  if (!newSample)
+    return tuneRelay;
+
+  if (temp > tuneMax)
+    tuneMax = temp;
+  if (temp < tuneMin)
+    tuneMin = temp;
+
+  if (tuneRelay && temp > target + AUTOTUNE_HYST)
+  {
+    tuneRelay = false;
+    tuneOnMs += now - tuneOnSince;
+    autotuneCycle(now);
+  }
+  else if (!tuneRelay && temp < target - AUTOTUNE_HYST)
+  {
+    tuneRelay = true;
+    tuneOnSince = now;
+  }
+  return tuneRelay;
+}
+
+static void pidUpdate(float temp, float dt, float target)
+{
+  float error = target - temp;
+
+  if (isnan(lastTemp) || dt <= 0 || dt > MAX_SAMPLE_GAP)
+    derivative = 0;
+  else
+    derivative += (-(temp - lastTemp) / dt - derivative) * DERIVATIVE_SMOOTHING;
+
+  // conditional integration: no winding up against a saturated output
+  float candidate = constrain(integral + config.ki * error * (dt <= MAX_SAMPLE_GAP ? dt : 0), 0.0f, 1.0f);
+  float output = config.kp * error + candidate + config.kd * derivative;
+  if (!(output > 1 && error > 0) && !(output < 0 && error < 0))
+    integral = candidate;
+
+  duty = constrain(config.kp * error + integral + config.kd * derivative, 0.0f, 1.0f);
+}
+
+static unsigned long windowOnTime()
+{
+  unsigned long windowMs = config.windowSeconds * 1000UL;
+  unsigned long minMs = config.minSwitchSeconds * 1000UL;
+  unsigned long onMs = duty * windowMs;
+  if (onMs < minMs)
+    return 0;
+  if (windowMs - onMs < minMs)
+    return windowMs;
+  return onMs;
+}
+
+bool pidHeaterDemand(float temp, unsigned long sampleAt, float target, bool heaterOn)
+{
+  bool newSample = sampleAt != lastSampleAt;
+  if (tuning)
+  {
+    lastSampleAt = sampleAt;
+    return autotuneDemand(temp, newSample, target);
+  }
+
+  unsigned long now = millis();
+  if (newSample)
+  {
+    pidUpdate(temp, (sampleAt - lastSampleAt) / 1000.0f, target);
+    lastSampleAt = sampleAt;
+    lastTemp = temp;
+
+    // a lower duty can cut the current window short, never extend it
+    if (windowOpen)
+    {
+      unsigned long onMs = windowOnTime();
+      if (heaterOn && onMs < config.minSwitchSeconds * 1000UL)
+        onMs = config.minSwitchSeconds * 1000UL;
+      if (onMs < windowOnMs)
+        windowOnMs = onMs;
+    }
+  }
+
+  if (!windowOpen || now - windowStart >= config.windowSeconds * 1000UL)
+  {
+    windowOpen = true;
+    windowStart = now;
+    windowOnMs = windowOnTime();
+  }
+  return now - windowStart < windowOnMs;
+}
+
+bool pidNextSwitch(unsigned long &at)
+{
+  if (tuning || !windowOpen)
+    return false;
+  unsigned long now = millis();
+  if (now - windowStart < windowOnMs)
+    at = windowStart + windowOnMs;
+  else
+    at = windowStart + config.windowSeconds * 1000UL;
+  return true;
+}
@@ -0,0 +1,649 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "history.h"
+#include "channel.h"
+#include "probes.h"
+
+#define HISTORY_PATH "/history.bin"
+#define HISTORY_PREV_PATH "/history.prev"
+#define HISTORY_TMP_PATH "/history.tmp"
+#define HISTORY_MAGIC 0x4A
+#define HISTORY_OLD_MAGIC 0x48 // first of the earlier formats, set aside on boot
+#define HISTORY_MAX_BYTES 393216 // start over beyond this, about four cycles
+
+#define RING_SIZE 512       // entries per flushed block
+#define ENTRY_MAX_BITS 89   // worst case encoding of one entry
+#define BLOCK_BUFFER_SIZE ((RING_SIZE * ENTRY_MAX_BITS + 7) / 8)
+#define PENDING_SIZE 32     // entries between two historyMaintain() calls
+#define HISTORY_ROTATE 0xFF // queued marker, never stored
+#define MAX_DEADBAND 3      // in steps, the widest the budget may make the deadband
+#define HISTORY_BUDGET 92160 // bytes per cycle the deadband is sized for, see historyBegin()
+#define RICE_MAX_QUOTIENT 12 // larger moves take the long form
+
+/*
+ * Temperature and humidity are recorded in steps of 0.1 C and 0.5 %RH. A
+ * recorded value is held while the readings stay within the deadband of it,
+ * so a recorded move is always larger than the deadband. The deadband
+ * starts at 0, every reading kept as is, and is set again after each block:
+ * one step wider while the file is larger than its share of HISTORY_BUDGET
+ * for the time the cycle has run, one narrower while it is smaller, so the
+ * DHT22's last-digit flicker is only dropped when the cycle would not fit.
+ *
+ * Block layout: a 20-byte header followed by a bit stream. Each entry is
+ * coded against the previous one, starting from time = startTime, the
+ * block's first sample and the actuator state before the first entry, all
+ * three from the header. A sample is on schedule `interval` seconds after
+ * the previous sample, or at startTime for the first:
+ *
+ *   0              sample on schedule, values held
+ *   10 t           sample on schedule, temperature moved
+ *   110 a d        actuators switched, d seconds after the previous entry
+ *                  and less than `interval`
+ *   1110 h         sample on schedule, humidity moved
+ *   11110 t h      sample on schedule, both moved
+ *   11111 k w dt   sample (k=0) or actuators (k=1), dt seconds after the
+ *                  previous entry, dt being 8 bits wide if w=0 or 32 bits
+ *                  if w=1
+ *
+ * `a` is 0 for the heater, 10 for the humidifier, 11 for both, and `d` an
+ * order-0 Exp-Golomb code: a switch on a sample's second costs one bit
+ * more, one the PID's window puts between two samples 3 to 7. A move `t`
+ * or `h` is counted in the direction its actuator pushes, up while on and
+ * down while off: the smallest move that way is 0, the other way 1, one
+ * step more 2, 3, ... and written as a Rice code with the block's parameter
+ * for that value, the deadband being the block's. The long form carries an actuator state `ss`, or plain
+ * temperature and humidity deltas zigzag mapped (0, -1, 1, -2, ...) to 0,
+ * 1, 2, 3, ... as order-0 Exp-Golomb codes; it takes the odd sample whose
+ * move is too large for its Rice code.
+ */
+struct BlockHeader
+{
+  uint8_t magic;
+  uint8_t interval;
+  uint16_t count;
+  uint16_t length;  // bytes of bit stream
+  uint16_t crc;     // CRC-16/CCITT over the bit stream
+  uint32_t startTime;
+  uint32_t endTime;
+  int16_t temp;     // first sample, 0 if none
+  uint8_t humidity; // first sample, in HUMIDITY_STEPs
+  uint8_t params;   // temperature Rice parameter (bits 0-1), humidity's (2-3), actuators before the first entry (4-5), deadband (6-7)
+};
+
+/** Entry codes, written as that many 1 bits and a 0 (none after CODE_LONG). */
+enum EntryCode : uint8_t
+{
+  CODE_HELD,
+  CODE_TEMP,
+  CODE_ACTUATORS,
+  CODE_HUMIDITY,
+  CODE_BOTH,
+  CODE_LONG
+};
+
+#define HUMIDITY_STEP 5 // 0.5 %RH, about the DHT22's repeatability
+
+static HistoryEntry ring[RING_SIZE];
+static uint16_t ringHead = 0; // oldest entry
+static uint16_t ringCount = 0;
+static uint8_t blockBuffer[BLOCK_BUFFER_SIZE];
+static uint8_t ringActuators = 0; // state before the ring's oldest entry
+static uint8_t interval = 10;
+static uint8_t lastActuators = 0xFF;
+static bool sampled = false; // recordedTemp/recordedHumidity are set
+static int16_t recordedTemp = 0;
+static uint16_t recordedHumidity = 0;
+static uint32_t fileBytes = 0;
+static uint32_t fileStart = 0;  // first entry of /history.bin, 0 while empty
+static uint32_t cycleSeconds = 86400;
+static uint8_t deadband = 0;    // in steps, for the entries going into the ring
+static SpscQueue<HistoryEntry, PENDING_SIZE> pending; // control task -> historyMaintain()
+
+static uint16_t crc16(const uint8_t *data, size_t len)
+{
+  uint16_t crc = 0xFFFF;
+  while (len--)
+  {
+    crc ^= (uint16_t)*data++ << 8;
+    for (uint8_t i = 0; i < 8; i++)
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+struct BitWriter
+{
+  uint8_t *data;
+  uint32_t bits;
+
+  void put(uint32_t value, uint8_t width)
+  {
+    while (width--)
+    {
+      if (bits % 8 == 0)
+        data[bits / 8] = 0;
+      if (value >> width & 1)
+        data[bits / 8] |= 0x80 >> (bits % 8);
+      bits++;
+    }
+  }
+
+  void putCode(EntryCode code)
+  {
+    put(((1u << code) - 1) << (code < CODE_LONG), code + (code < CODE_LONG));
+  }
+
+  void putCount(uint32_t count)
+  {
+    uint32_t value = count + 1;
+    uint8_t width = 32 - __builtin_clz(value);
+    put(0, width - 1);
+    put(value, width);
+  }
+
+  void putDelta(int32_t delta)
+  {
+    putCount(delta >= 0 ? 2 * delta : -2 * delta - 1);
+  }
+
+  void putRice(uint32_t value, uint8_t k)
+  {
+    uint8_t quotient = value >> k;
+    put(((1u << quotient) - 1) << 1, quotient + 1);
+    put(value, k);
+  }
+};
+
+struct BitReader
+{
+  const uint8_t *data;
+  uint32_t bits;
+  uint32_t limit;
+
+  bool overrun() const { return bits > limit; }
+
+  uint32_t get(uint8_t width)
+  {
+    uint32_t value = 0;
+    while (width--)
+    {
+      value <<= 1;
+      if (bits < limit)
+        value |= data[bits / 8] >> (7 - bits % 8) & 1;
+      bits++;
+    }
+    return value;
+  }
+
+  EntryCode getCode()
+  {
+    uint8_t code = CODE_HELD;
+    while (code < CODE_LONG && get(1))
+      code++;
+    return (EntryCode)code;
+  }
+
+  uint32_t getCount()
+  {
+    uint8_t zeros = 0;
+    while (!get(1) && zeros < 24 && !overrun())
+      zeros++;
+    return (1u << zeros | get(zeros)) - 1;
+  }
+
+  int32_t getDelta()
+  {
+    uint32_t value = getCount();
+    return value & 1 ? -(int32_t)(value + 1) / 2 : value / 2;
+  }
+
+  uint32_t getRice(uint8_t k)
+  {
+    uint32_t quotient = 0;
+    while (get(1) && quotient <= RICE_MAX_QUOTIENT && !overrun())
+      quotient++;
+    return quotient << k | get(k);
+  }
+};
+
+/** Maps a recorded move, larger than the deadband `band`, to 0, 1, 2, ... as described above. */
+static uint32_t moveCode(int32_t delta, bool rising, uint8_t band)
+{
+  if (!rising)
+    delta = -delta;
+  return delta > 0 ? 2 * (delta - band - 1) : 2 * (-delta - band - 1) + 1;
+}
+
+static int32_t moveDelta(uint32_t code, bool rising, uint8_t band)
+{
+  int32_t delta = (int32_t)(code / 2) + band + 1;
+  if (code & 1)
+    delta = -delta;
+  return rising ? delta : -delta;
+}
+
+/** @return Whether a move can be coded with Rice parameter `k`; no move always can. */
+static bool riceFits(int32_t delta, bool rising, uint8_t band, uint8_t k)
+{
+  return !delta || (abs(delta) > band && moveCode(delta, rising, band) >> k <= RICE_MAX_QUOTIENT);
+}
+
+/** Adds the cost of coding a move with each Rice parameter to `bits`. */
+static void riceCost(uint32_t bits[4], int32_t delta, bool rising, uint8_t band)
+{
+  if (abs(delta) > band)
+    for (uint8_t k = 0; k < 4; k++)
+      bits[k] += (moveCode(delta, rising, band) >> k) + 1 + k;
+}
+
+static uint8_t cheapest(const uint32_t bits[4])
+{
+  uint8_t best = 0;
+  for (uint8_t k = 1; k < 4; k++)
+    if (bits[k] < bits[best])
+      best = k;
+  return best;
+}
+
+static const HistoryEntry &ringAt(uint16_t index)
+{
+  return ring[(ringHead + index) % RING_SIZE];
+}
+
+/**
+ * Encodes the ring into blockBuffer, `actuators` being the state before
+ * its oldest entry and, on return, after its newest.
+ */
+static uint16_t encodeRing(BlockHeader &header, uint8_t &actuators)
+{
+  int32_t firstTemp = 0, firstHumidity = 0;
+  for (uint16_t i = 0; i < ringCount; i++)
+    if (ringAt(i).kind == HISTORY_SAMPLE)
+    {
+      firstTemp = ringAt(i).temp;
+      firstHumidity = ringAt(i).humidity / HUMIDITY_STEP;
+      break;
+    }
+
+  // a first pass picks the Rice parameters that fit this block's moves best
+  uint32_t tempBits[4] = {}, humidityBits[4] = {};
+  int32_t temp = firstTemp, humidity = firstHumidity;
+  uint8_t state = actuators;
+  for (uint16_t i = 0; i < ringCount; i++)
+  {
+    const HistoryEntry &entry = ringAt(i);
+    if (entry.kind == HISTORY_ACTUATORS)
+    {
+      state = entry.state;
+      continue;
+    }
+    int32_t humiditySteps = entry.humidity / HUMIDITY_STEP;
+    riceCost(tempBits, entry.temp - temp, state & HISTORY_HEATER, deadband);
+    riceCost(humidityBits, humiditySteps - humidity, state & HISTORY_HUMIDIFIER, deadband);
+    temp = entry.temp;
+    humidity = humiditySteps;
+  }
+  uint8_t tempK = cheapest(tempBits), humidityK = cheapest(humidityBits);
+
+  BitWriter out = {blockBuffer, 0};
+  uint32_t time = ringAt(0).time, sampleTime = time - interval;
+  uint8_t firstState = actuators;
+  temp = firstTemp;
+  humidity = firstHumidity;
+  state = actuators;
+  for (uint16_t i = 0; i < ringCount; i++)
+  {
+    const HistoryEntry &entry = ringAt(i);
+    uint32_t dt = entry.time - time;
+    time = entry.time;
+
+    if (entry.kind == HISTORY_ACTUATORS)
+    {
+      uint8_t switched = entry.state ^ state;
+      state = entry.state;
+      if (dt < interval && switched)
+      {
+        out.putCode(CODE_ACTUATORS);
+        if (switched == HISTORY_HEATER)
+          out.put(0b0, 1);
+        else
+          out.put(0b10 | (switched == (HISTORY_HEATER | HISTORY_HUMIDIFIER)), 2);
+        out.putCount(dt);
+        continue;
+      }
+      out.putCode(CODE_LONG);
+      out.put(0b10 | (dt > 0xFF), 2);
+      out.put(dt, dt > 0xFF ? 32 : 8);
+      out.put(state, 2);
+      continue;
+    }
+
+    int32_t humiditySteps = entry.humidity / HUMIDITY_STEP;
+    int32_t tempDelta = entry.temp - temp, humidityDelta = humiditySteps - humidity;
+    bool heating = state & HISTORY_HEATER, humidifying = state & HISTORY_HUMIDIFIER;
+    bool onSchedule = entry.time - sampleTime == interval;
+    temp = entry.temp;
+    humidity = humiditySteps;
+    sampleTime = entry.time;
+
+    if (onSchedule && riceFits(tempDelta, heating, deadband, tempK) &&
+        riceFits(humidityDelta, humidifying, deadband, humidityK))
+    {
+      if (!tempDelta)
+        out.putCode(humidityDelta ? CODE_HUMIDITY : CODE_HELD);
+      else
+        out.putCode(humidityDelta ? CODE_BOTH : CODE_TEMP);
+      if (tempDelta)
+        out.putRice(moveCode(tempDelta, heating, deadband), tempK);
+      if (humidityDelta)
+        out.putRice(moveCode(humidityDelta, humidifying, deadband), humidityK);
+      continue;
+    }
+    out.putCode(CODE_LONG);
+    out.put(0b00 | (dt > 0xFF), 2);
+    out.put(dt, dt > 0xFF ? 32 : 8);
+    out.putDelta(tempDelta);
+    out.putDelta(humidityDelta);
+  }
+  actuators = state;
+
+  uint16_t length = (out.bits + 7) / 8;
+  header = {HISTORY_MAGIC, interval, ringCount, length, crc16(blockBuffer, length),
+            ringAt(0).time, ringAt(ringCount - 1).time, (int16_t)firstTemp, (uint8_t)firstHumidity,
+            (uint8_t)(tempK | humidityK << 2 | firstState << 4 | deadband << 6)};
+  return length;
+}
+
+static uint32_t decodeBlock(const BlockHeader &header, uint32_t from, uint32_t to,
+                            HistoryCallback callback, void *context, bool &stopped)
+{
+  BitReader in = {blockBuffer, 0, (uint32_t)header.length * 8};
+  HistoryEntry entry = {header.startTime, HISTORY_SAMPLE, 0, header.temp, 0};
+  int32_t humidity = header.humidity;
+  uint8_t tempK = header.params & 3, humidityK = header.params >> 2 & 3;
+  uint8_t state = header.params >> 4 & 3, band = header.params >> 6;
+  uint32_t sampleTime = header.startTime - header.interval;
+  uint32_t delivered = 0;
+
+  for (uint16_t i = 0; i < header.count && !in.overrun(); i++)
+  {
+    EntryCode code = in.getCode();
+    if (code == CODE_ACTUATORS)
+    {
+      entry.kind = HISTORY_ACTUATORS;
+      state ^= !in.get(1) ? HISTORY_HEATER : in.get(1) ? HISTORY_HEATER | HISTORY_HUMIDIFIER : HISTORY_HUMIDIFIER;
+      entry.time += in.getCount();
+    }
+    else if (code == CODE_LONG)
+    {
+      entry.kind = in.get(1);
+      entry.time += in.get(in.get(1) ? 32 : 8);
+      if (entry.kind == HISTORY_SAMPLE)
+      {
+        entry.temp += in.getDelta();
+        humidity += in.getDelta();
+      }
+      else
+        state = in.get(2);
+    }
+    else
+    {
+      entry.kind = HISTORY_SAMPLE;
+      entry.time = sampleTime + header.interval;
+      if (code == CODE_TEMP || code == CODE_BOTH)
+        entry.temp += moveDelta(in.getRice(tempK), state & HISTORY_HEATER, band);
+      if (code == CODE_HUMIDITY || code == CODE_BOTH)
+        humidity += moveDelta(in.getRice(humidityK), state & HISTORY_HUMIDIFIER, band);
+    }
+    entry.humidity = humidity * HUMIDITY_STEP;
+    entry.state = entry.kind == HISTORY_ACTUATORS ? state : 0;
+    if (entry.kind == HISTORY_SAMPLE)
+      sampleTime = entry.time;
+
+    if (entry.time > to)
+    {
+      stopped = true;
+      break;
+    }
+    if (entry.time >= from)
+    {
+      delivered++;
+      if (!callback(entry, context))
+      {
+        stopped = true;
+        break;
+      }
+    }
+  }
+  return delivered;
+}
+
+static void rotateFiles()
+{
+  LittleFS.remove(HISTORY_PREV_PATH);
+  LittleFS.rename(HISTORY_PATH, HISTORY_PREV_PATH);
+  fileBytes = 0;
+  fileStart = 0;
+  deadband = 0;
+}
+
+/**
+ * Walks the blocks of the history file, returning the offset just past the
+ * last intact one, and takes up the cycle's start and deadband from them.
+ */
+static uint32_t validLength()
+{
+  File file = LittleFS.open(HISTORY_PATH, FILE_READ);
+  if (!file)
+    return 0;
+
+  uint32_t offset = 0;
+  BlockHeader header;
+  while (file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+         header.magic == HISTORY_MAGIC && header.length <= BLOCK_BUFFER_SIZE &&
+         file.read(blockBuffer, header.length) == header.length &&
+         crc16(blockBuffer, header.length) == header.crc)
+  {
+    if (offset == 0)
+      fileStart = header.startTime;
+    deadband = header.params >> 6;
+    offset += sizeof(header) + header.length;
+  }
+
+  if (offset == 0 && file.size() >= sizeof(header) && header.magic >= HISTORY_OLD_MAGIC &&
+      header.magic < HISTORY_MAGIC)
+  {
+    // written by an earlier firmware, set aside rather than dropped
+    file.close();
+    rotateFiles();
+    Serial.println("⚠️ History in the earlier format moved to /history.prev");
+    return 0;
+  }
+  if (offset < file.size())
+  {
+    // torn tail, keep the intact blocks only
+    file.seek(0);
+    File copy = LittleFS.open(HISTORY_TMP_PATH, FILE_WRITE);
+    for (uint32_t left = offset; copy && left > 0;)
+    {
+      uint16_t chunk = left < BLOCK_BUFFER_SIZE ? left : BLOCK_BUFFER_SIZE;
+      file.read(blockBuffer, chunk);
+      copy.write(blockBuffer, chunk);
+      left -= chunk;
+    }
+    copy.close();
+    file.close();
+    LittleFS.rename(HISTORY_TMP_PATH, HISTORY_PATH);
+    Serial.println("⚠️ History tail was damaged and has been dropped");
+    return offset;
+  }
+  file.close();
+  return offset;
+}
+
+static void flushRing()
+{
+  if (ringCount == 0)
+    return;
+  if (fileBytes >= HISTORY_MAX_BYTES)
+    rotateFiles();
+
+  BlockHeader header;
+  uint8_t actuators = ringActuators;
+  uint16_t length = encodeRing(header, actuators);
+
+  File file = LittleFS.open(HISTORY_PATH, FILE_APPEND);
+  if (!file || file.write((const uint8_t *)&header, sizeof(header)) != sizeof(header) ||
+      file.write(blockBuffer, length) != length)
+  {
+    // Keep the entries; the ring overwrites the oldest ones if this persists
+    Serial.println("❌ History write failed");
+    file.close();
+    return;
+  }
+  file.close();
+
+  fileBytes += sizeof(header) + length;
+  ringActuators = actuators;
+  ringHead = 0;
+  ringCount = 0;
+  if (!fileStart)
+    fileStart = header.startTime;
+
+  // the ring is empty, so the next block is recorded with the new deadband throughout
+  uint32_t allowed = (uint64_t)HISTORY_BUDGET * (header.endTime - fileStart) / cycleSeconds;
+  if (fileBytes > allowed && deadband < MAX_DEADBAND)
+    deadband++;
+  else if (fileBytes < allowed && deadband > 0)
+    deadband--;
+}
+
+static void addEntry(HistoryEntry entry)
+{
+  if (entry.kind == HISTORY_SAMPLE)
+  {
+    if (sampled && abs(entry.temp - recordedTemp) <= deadband)
+      entry.temp = recordedTemp;
+    if (sampled && abs(entry.humidity - recordedHumidity) <= deadband * HUMIDITY_STEP)
+      entry.humidity = recordedHumidity;
+    recordedTemp = entry.temp;
+    recordedHumidity = entry.humidity;
+    sampled = true;
+  }
+
+  if (ringCount == RING_SIZE)
+  {
+    flushRing();
+    if (ringCount == RING_SIZE)
+    {
+      if (ring[ringHead].kind == HISTORY_ACTUATORS)
+        ringActuators = ring[ringHead].state;
+      ringHead = (ringHead + 1) % RING_SIZE;
+      ringCount--;
+    }
+  }
+  ring[(ringHead + ringCount++) % RING_SIZE] = entry;
+}
+
+void historyBegin(uint8_t intervalSeconds, uint8_t cycleDays)
+{
+  interval = intervalSeconds;
+  cycleSeconds = (cycleDays ? cycleDays : 1) * 86400UL;
+  fileStart = 0;
+  deadband = 0;
+  ringHead = 0;
+  ringCount = 0;
+  ringActuators = 0;
+  lastActuators = 0xFF;
+  sampled = false;
+  fileBytes = validLength();
+}
+
+void historyAddSample(uint32_t time, float temp, float humidity)
+{
+  if (!time)
+    return;
+  // Quantized here already so that entries read back the same from RAM and flash
+  uint16_t humiditySteps = lroundf(constrain(humidity, 0.0f, 100.0f) * 10 / HUMIDITY_STEP);
+  pending.push({time, HISTORY_SAMPLE, 0, (int16_t)lroundf(temp * 10), (uint16_t)(humiditySteps * HUMIDITY_STEP)});
+}
+
+void historyTrackActuators(uint32_t time, bool heater, bool humidifier)
+{
+  uint8_t state = (heater ? HISTORY_HEATER : 0) | (humidifier ? HISTORY_HUMIDIFIER : 0);
+  if (state == lastActuators || !time)
+    return;
+
+  // retried on the next call if the queue is full
+  if (pending.push({time, HISTORY_ACTUATORS, state, 0, 0}))
+    lastActuators = state;
+}
+
+void historyRotate(uint8_t cycleDays)
+{
+  pending.push({0, HISTORY_ROTATE, cycleDays, 0, 0});
+}
+
+void historyMaintain()
+{
+  PROBE(PROBE_HISTORY);
+
+  HistoryEntry entry;
+  while (pending.pop(entry))
+  {
+    if (entry.kind != HISTORY_ROTATE)
+      addEntry(entry);
+    else
+    {
+      flushRing();
+      rotateFiles();
+      cycleSeconds = (entry.state ? entry.state : 1) * 86400UL;
+    }
+  }
+}
+
+uint32_t historyRead(uint32_t from, uint32_t to, HistoryCallback callback, void *context)
+{
+  uint32_t delivered = 0;
+  bool stopped = false;
+
+  File file = LittleFS.open(HISTORY_PATH, FILE_READ);
+  BlockHeader header;
+  while (file && !stopped && file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+         header.magic == HISTORY_MAGIC && header.length <= BLOCK_BUFFER_SIZE)
+  {
+    if (header.startTime > to)
+    {
+      stopped = true;
+      break;
+    }
+    if (header.endTime < from)
+    {
+      file.seek(file.position() + header.length);
+      continue;
+    }
+    if (file.read(blockBuffer, header.length) != header.length ||
+        crc16(blockBuffer, header.length) != header.crc)
+      break;
+    delivered += decodeBlock(header, from, to, callback, context, stopped);
+  }
+  file.close();
+
+  for (uint16_t i = 0; i < ringCount && !stopped; i++)
+  {
+    const HistoryEntry &entry = ringAt(i);
+    if (entry.time > to)
+      break;
+    if (entry.time < from)
+      continue;
+    delivered++;
+    if (!callback(entry, context))
+      break;
+  }
+  return delivered;
+}
+
+uint32_t historyBytes()
+{
+  return fileBytes;
+}
@@ -0,0 +1,86 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include "i2c_bus.h"
+#include "pins.h"
+
+#ifdef ARDUINO_ARCH_ESP32
+static SemaphoreHandle_t busMutex = nullptr;
+#endif
+
+static I2cBusStats stats = {};
+static unsigned long lockedAt = 0; // in us
+
+/** Waits for the other task's transaction, if any. */
+static void lock()
+{
+  unsigned long start = micros();
+#ifdef ARDUINO_ARCH_ESP32
+  if (busMutex)
+    xSemaphoreTake(busMutex, portMAX_DELAY); // Wire times a stuck transaction out by itself
+#endif
+  lockedAt = micros();
+  uint32_t waited = lockedAt - start;
+  stats.waitMicros += waited;
+  if (waited > stats.maxWaitMicros)
+    stats.maxWaitMicros = waited;
+}
+
+static bool unlock(bool ok)
+{
+  uint32_t busy = micros() - lockedAt;
+  if (busy > stats.maxBusyMicros)
+    stats.maxBusyMicros = busy;
+  stats.transactions++;
+  stats.failures += !ok;
+#ifdef ARDUINO_ARCH_ESP32
+  if (busMutex)
+    xSemaphoreGive(busMutex);
+#endif
+  return ok;
+}
+
+/** Reads what the device returns into `data`; called with the bus locked. */
+static bool receive(uint8_t address, uint8_t *data, size_t length)
+{
+  if (Wire.requestFrom(address, length, true) != length)
+    return false;
+  for (size_t i = 0; i < length; i++)
+    data[i] = Wire.read();
+  return true;
+}
+
+void i2cBusBegin()
+{
+#ifdef ARDUINO_ARCH_ESP32
+  busMutex = xSemaphoreCreateMutex();
+#endif
+  Wire.begin(SDA_PIN, SCL_PIN);
+}
+
+bool i2cWrite(uint8_t address, const uint8_t *data, size_t length)
+{
+  lock();
+  Wire.beginTransmission(address);
+  Wire.write(data, length);
+  return unlock(Wire.endTransmission() == 0);
+}
+
+bool i2cRead(uint8_t address, uint8_t *data, size_t length)
+{
+  lock();
+  return unlock(receive(address, data, length));
+}
+
+bool i2cReadRegister(uint8_t address, uint8_t reg, uint8_t *data, size_t length)
+{
+  lock();
+  Wire.beginTransmission(address);
+  Wire.write(reg);
+  bool ok = Wire.endTransmission(false) == 0 && receive(address, data, length);
+  return unlock(ok);
+}
+
+I2cBusStats i2cBusStats()
+{
+  return stats;
+}
@@ -0,0 +1,131 @@
+#include <Arduino.h>
+#include "i2c_sensors.h"
+#include "i2c_bus.h"
+
+#define BME280_CHIP_ID 0x60
+#define BME280_REG_CALIBRATION_T 0x88 // T1..T3, P1..P9, a spare byte and H1: 0x88..0xA1
+#define BME280_REG_ID 0xD0
+#define BME280_REG_CALIBRATION_H 0xE1 // H2..H6: 0xE1..0xE7
+#define BME280_REG_CTRL_HUM 0xF2
+#define BME280_REG_CTRL_MEAS 0xF4
+#define BME280_REG_TEMP 0xFA
+#define BME280_CTRL_HUM_X1 0x01
+#define BME280_CTRL_MEAS_FORCED 0x21 // temperature x1, pressure skipped, forced mode
+
+uint8_t sensirionCrc(const uint8_t *data, uint8_t length)
+{
+  uint8_t crc = 0xFF;
+  for (uint8_t i = 0; i < length; i++)
+  {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++)
+      crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
+  }
+  return crc;
+}
+
+bool sht3xStart(uint8_t address)
+{
+  const uint8_t command[] = {0x24, 0x00};
+  return i2cWrite(address, command, sizeof(command));
+}
+
+bool sht4xStart(uint8_t address)
+{
+  const uint8_t command = 0xFD;
+  return i2cWrite(address, &command, 1);
+}
+
+bool shtRead(uint8_t address, uint8_t frame[SHT_FRAME_LENGTH])
+{
+  return i2cRead(address, frame, SHT_FRAME_LENGTH);
+}
+
+/** @return The two raw words of a reply, false if a CRC does not match. */
+static bool shtWords(const uint8_t frame[SHT_FRAME_LENGTH], uint16_t &temp, uint16_t &humidity)
+{
+  if (sensirionCrc(frame, 2) != frame[2] || sensirionCrc(frame + 3, 2) != frame[5])
+    return false;
+  temp = frame[0] << 8 | frame[1];
+  humidity = frame[3] << 8 | frame[4];
+  return true;
+}
+
+bool sht3xDecode(const uint8_t frame[SHT_FRAME_LENGTH], SensorSample &out)
+{
+  uint16_t temp, humidity;
+  if (!shtWords(frame, temp, humidity))
+    return false;
+  out.temperature = -45 + 175 * (temp / 65535.0f);
+  out.humidity = 100 * (humidity / 65535.0f);
+  return true;
+}
+
+bool sht4xDecode(const uint8_t frame[SHT_FRAME_LENGTH], SensorSample &out)
+{
+  uint16_t temp, humidity;
+  if (!shtWords(frame, temp, humidity))
+    return false;
+  out.temperature = -45 + 175 * (temp / 65535.0f);
+  out.humidity = constrain(-6 + 125 * (humidity / 65535.0f), 0.0f, 100.0f); // datasheet 4.6, cropped
+  return true;
+}
+
+bool bme280Begin(uint8_t address, Bme280Calibration &calibration)
+{
+  uint8_t id = 0, t[26], h[7];
+  if (!i2cReadRegister(address, BME280_REG_ID, &id, 1) || id != BME280_CHIP_ID ||
+      !i2cReadRegister(address, BME280_REG_CALIBRATION_T, t, sizeof(t)) ||
+      !i2cReadRegister(address, BME280_REG_CALIBRATION_H, h, sizeof(h)))
+    return false;
+
+  calibration.t1 = t[1] << 8 | t[0];
+  calibration.t2 = t[3] << 8 | t[2];
+  calibration.t3 = t[5] << 8 | t[4];
+  calibration.h1 = t[25];
+  calibration.h2 = h[1] << 8 | h[0];
+  calibration.h3 = h[2];
+  calibration.h4 = (int8_t)h[3] * 16 | (h[4] & 0x0F);
+  calibration.h5 = (int8_t)h[5] * 16 | h[4] >> 4;
+  calibration.h6 = h[6];
+
+  // humidity oversampling only takes effect with the next ctrl_meas write
+  const uint8_t ctrlHum[] = {BME280_REG_CTRL_HUM, BME280_CTRL_HUM_X1};
+  return i2cWrite(address, ctrlHum, sizeof(ctrlHum));
+}
+
+bool bme280Start(uint8_t address)
+{
+  const uint8_t ctrlMeas[] = {BME280_REG_CTRL_MEAS, BME280_CTRL_MEAS_FORCED};
+  return i2cWrite(address, ctrlMeas, sizeof(ctrlMeas));
+}
+
+bool bme280Read(uint8_t address, uint8_t frame[BME280_FRAME_LENGTH])
+{
+  return i2cReadRegister(address, BME280_REG_TEMP, frame, BME280_FRAME_LENGTH);
+}
+
+bool bme280Decode(const uint8_t frame[BME280_FRAME_LENGTH], const Bme280Calibration &calibration, SensorSample &out)
+{
+  int32_t rawTemp = (int32_t)frame[0] << 12 | frame[1] << 4 | frame[2] >> 4;
+  int32_t rawHumidity = frame[3] << 8 | frame[4];
+  if (rawTemp == 0x80000 || rawHumidity == 0x8000) // skipped or never converted
+    return false;
+  bme280Compensate(calibration, rawTemp, rawHumidity, out);
+  return true;
+}
+
+void bme280Compensate(const Bme280Calibration &c, int32_t rawTemp, int32_t rawHumidity, SensorSample &out)
+{
+  int32_t var1 = (((rawTemp >> 3) - ((int32_t)c.t1 << 1)) * c.t2) >> 11;
+  int32_t var2 = (((((rawTemp >> 4) - (int32_t)c.t1) * ((rawTemp >> 4) - (int32_t)c.t1)) >> 12) * c.t3) >> 14;
+  int32_t tFine = var1 + var2;
+  out.temperature = ((tFine * 5 + 128) >> 8) / 100.0f;
+
+  int32_t x = tFine - 76800;
+  int32_t h = (((rawHumidity << 14) - ((int32_t)c.h4 << 20) - (c.h5 * x)) + 16384) >> 15;
+  h *= ((((((x * c.h6) >> 10) * (((x * c.h3) >> 11) + 32768)) >> 10) + 2097152) * c.h2 + 8192) >> 14;
+  h -= ((((h >> 15) * (h >> 15)) >> 7) * c.h1) >> 4;
+  h = constrain(h, 0, 419430400);
+  out.humidity = (h >> 12) / 1024.0f;
+}
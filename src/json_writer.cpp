@@ -0,0 +1,153 @@
+#include <string.h>
+#include "json_writer.h"
+
+JsonWriter::JsonWriter(char *buffer, size_t size, JsonSink sink, void *context)
+    : buffer(buffer), size(size), sink(sink), context(context)
+{
+}
+
+bool JsonWriter::flush()
+{
+  if (!failed && length)
+  {
+    failed = !sink(buffer, length, context);
+    total += length;
+    length = 0;
+  }
+  return !failed;
+}
+
+void JsonWriter::put(char c)
+{
+  if (length == size && !flush())
+    return;
+  if (!failed)
+    buffer[length++] = c;
+}
+
+void JsonWriter::put(const char *text)
+{
+  while (*text)
+    put(*text++);
+}
+
+/** Comma before every value but the first of its level, none after a key. */
+void JsonWriter::separate()
+{
+  if (afterKey)
+  {
+    afterKey = false;
+    return;
+  }
+  uint32_t bit = 1UL << (depth & 31);
+  if (hasItems & bit)
+    put(',');
+  hasItems |= bit;
+}
+
+void JsonWriter::open(char bracket)
+{
+  separate();
+  put(bracket);
+  depth++;
+  hasItems &= ~(1UL << (depth & 31));
+}
+
+void JsonWriter::close(char bracket)
+{
+  depth--;
+  put(bracket);
+}
+
+void JsonWriter::beginObject() { open('{'); }
+void JsonWriter::endObject() { close('}'); }
+void JsonWriter::beginArray() { open('['); }
+void JsonWriter::endArray() { close(']'); }
+
+void JsonWriter::key(const char *name)
+{
+  value(name);
+  put(':');
+  afterKey = true;
+}
+
+void JsonWriter::value(const char *text)
+{
+  separate();
+  put('"');
+  for (; *text; text++)
+  {
+    char c = *text;
+    if (c == '"' || c == '\\')
+    {
+      put('\\');
+      put(c);
+    }
+    else if ((uint8_t)c < 0x20)
+    {
+      static const char hex[] = "0123456789abcdef";
+      put("\\u00");
+      put(hex[c >> 4]);
+      put(hex[c & 15]);
+    }
+    else
+      put(c);
+  }
+  put('"');
+}
+
+void JsonWriter::value(bool flag)
+{
+  separate();
+  put(flag ? "true" : "false");
+}
+
+void JsonWriter::value(uint32_t number)
+{
+  separate();
+  char digits[10];
+  uint8_t count = 0;
+  do
+  {
+    digits[count++] = '0' + number % 10;
+    number /= 10;
+  } while (number);
+  while (count)
+    put(digits[--count]);
+}
+
+void JsonWriter::value(int32_t number)
+{
+  if (number >= 0)
+  {
+    value((uint32_t)number);
+    return;
+  }
+  separate();
+  put('-');
+  afterKey = true; // the digits follow without a separator
+  value((uint32_t)(-(int64_t)number));
+}
+
+void JsonWriter::tenths(int32_t number)
+{
+  if (number == INT32_MIN)
+  {
+    null();
+    return;
+  }
+  separate();
+  if (number < 0)
+    put('-');
+  uint32_t magnitude = number < 0 ? (uint32_t)(-(int64_t)number) : number;
+  afterKey = true;
+  value(magnitude / 10);
+  put('.');
+  put('0' + magnitude % 10);
+}
+
+void JsonWriter::null()
+{
+  separate();
+  put("null");
+}
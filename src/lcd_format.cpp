@@ -0,0 +1,60 @@
+#include "lcd_format.h"
+
+#define TIMER_MAX (99 * 3600 + 59 * 60 + 59)
+
+void writeTwoDigits(char *out, uint32_t value)
+{
+  if (value > 99)
+    value = 99;
+  out[0] = '0' + value / 10;
+  out[1] = '0' + value % 10;
+}
+
+void writeTimer(char *out, uint32_t seconds)
+{
+  if (seconds > TIMER_MAX)
+    seconds = TIMER_MAX;
+  writeTwoDigits(out, seconds / 3600);
+  out[2] = ':';
+  writeTwoDigits(out + 3, seconds / 60 % 60);
+  out[5] = ':';
+  writeTwoDigits(out + 6, seconds % 60);
+}
+
+void writeTenths(char *out, int32_t tenths)
+{
+  bool negative = tenths < 0;
+  uint32_t magnitude = negative ? -(int64_t)tenths : tenths;
+
+  if (tenths == LCD_NO_VALUE || magnitude > (negative ? 9994u : 99994u))
+  {
+    out[0] = '-', out[1] = '-', out[2] = '.', out[3] = '-';
+    return;
+  }
+
+  char sign = negative ? '-' : ' ';
+  if (magnitude < (negative ? 100u : 1000u))
+  {
+    // d.d, dd.d, ddd.d
+    out[0] = magnitude >= 100 ? '0' + magnitude / 100 : sign;
+    out[1] = '0' + magnitude / 10 % 10;
+    out[2] = '.';
+    out[3] = '0' + magnitude % 10;
+    return;
+  }
+
+  // whole units, rounded half away from zero: dd, ddd, dddd
+  uint32_t units = (magnitude + 5) / 10;
+  out[0] = units >= 1000 ? '0' + units / 1000 : units >= 100 ? sign : ' ';
+  out[1] = units >= 100 ? '0' + units / 100 % 10 : sign;
+  out[2] = '0' + units / 10 % 10;
+  out[3] = '0' + units % 10;
+}
+
+void writeCount(char *out, uint32_t value)
+{
+  if (value > 9999)
+    value = 9999;
+  for (int8_t i = 3; i >= 0; i--, value /= 10)
+    out[i] = value || i == 3 ? '0' + value % 10 : ' ';
+}
@@ -1,71 +1,321 @@
 #include <Arduino.h>
-#include <LiquidCrystal_I2C.h>
+#include <Wire.h>
 #include "lcd_manager.h"
+#include "i2c_bus.h"
+#include "lcd_format.h"
+#include "time_manager.h"
+#include "profiles.h"
 
-extern LiquidCrystal_I2C lcd;
-extern byte currentDay;
-extern float temp;
-extern float tempTarget;
-extern float humidity;
-extern int timeInSeconds;
-extern bool timeSynced;
-extern unsigned long incubationStartTimestamp;
-extern bool isSensorOk;
-
-char *formatTimer()
+/* PCF8574 backpack: P0 = RS, P1 = RW, P2 = E, P3 = backlight, P4..P7 = D4..D7 */
+#define LCD_RS 0x01
+#define LCD_EN 0x04
+#define LCD_BACKLIGHT 0x08
+
+static char shadow[LCD_ROWS][LCD_COLS]; // what is currently on the glass
+static uint8_t txBuffer[I2C_BUFFER_LENGTH];
+static uint8_t txLength = 0;
+static uint8_t lastRs = 0xFF; // RS level the expander is currently driving
+static bool txFailed = false;    // a write failed since the last reset, the display needs another
+static bool resetFailed = false; // the last reset failed too, retried every LCD_RESET_RETRY
+static unsigned long resetAt = 0; // in ms
+
+static unsigned long windowStart = 0; // in ms
+static unsigned long windowBytes = 0;
+static unsigned long bytesPerSecond = 0;
+
+/** @return `value` in tenths, LCD_NO_VALUE for NAN. */
+static int32_t toTenths(float value)
+{
+  return isnan(value) ? LCD_NO_VALUE : lroundf(value * 10);
+}
+
+static void lcdShow(const LcdRow &line1, const LcdRow &line2);
+
+void updateLCD(const ControlState &state)
 {
-  uint8_t hours = timeInSeconds / 3600;
-  uint8_t minutes = (timeInSeconds % 3600) / 60;
-  uint8_t seconds = timeInSeconds % 60;
+  LcdRow top, bottom;
+  formatClear(top);
+  formatClear(bottom);
 
-  static char buffer[9];
-  sprintf(buffer, "%02u:%02u:%02u", hours, minutes, seconds);
+  uint8_t currentDay = state.currentDay;
+  const Profile &profile = PROFILES[state.profile];
+  if (!state.incubationStart || currentDay > profile.days + 1)
+  {
+    formatText<0>(top, "     Idle..");
+    formatText<0>(bottom, "Press Btn Start!");
+    return lcdShow(top, bottom);
+  }
 
-  return buffer;
+  if (clockSource() == CLOCK_UNSET)
+    formatText<0>(bottom, " Internet Error"); // indicates no internet connection
+  else if (currentDay == profile.days + 1)
+    formatText<0>(bottom, "Incubation Ended"); // Incubation cycle ended
+  else
+  {
+    formatTwoDigits<0>(bottom, currentDay);
+    formatText<2>(bottom, "/");
+    formatTwoDigits<3>(bottom, profile.days);
+    formatText<5>(bottom, "d");
+    if (currentDay > profile.turnLast)
+      formatText<6>(bottom, " Hatching!"); // hatching days no turning timer
+    else
+    {
+      formatTimer<7>(bottom, state.timeInSeconds); // turning timer
+      if (clockSource() == CLOCK_ESTIMATED)
+        formatText<15>(bottom, "~"); // counted on a clock not yet confirmed by NTP
+    }
+  }
+
+  if (state.isSensorOk)
+  {
+    // "xx.x/xx.xC xx.x%"
+    formatTenths<0>(top, toTenths(state.temp));
+    formatText<4>(top, "/");
+    formatTenths<5>(top, toTenths(state.tempTarget));
+    formatText<9>(top, "C");
+    formatTenths<11>(top, toTenths(state.humidity));
+    formatText<15>(top, "%");
+  }
+  else
+    formatText<0>(top, "Sensor Timeout!!");
+
+  lcdShow(top, bottom);
 }
 
-char *formatSensorMsg()
+/** @return `part` of `whole` in tenths of a percent. */
+static int32_t shareTenths(uint32_t part, uint32_t whole)
 {
-  static char buffer[17];
+  return whole ? (uint64_t)part * 1000 / whole : 0;
+}
 
-  sprintf(
-      buffer,
-      "%.1f/%.1fC %.1f%%", // 16 Chars
-      temp,
-      tempTarget,
-      humidity
-    );
+void updateDayLCD(const DayStats &stats, uint8_t screen)
+{
+  LcdRow top, bottom;
+  formatClear(top);
+  formatClear(bottom);
 
-  return buffer;
+  if (screen == 0)
+  {
+    // "Heat 34.2% 1234x"
+    formatText<0>(top, "Heat");
+    formatTenths<5>(top, shareTenths(stats.heaterOnMs, stats.trackedMs));
+    formatText<9>(top, "%");
+    formatCount<11>(top, stats.heaterSwitches);
+    formatText<15>(top, "x");
+    formatText<0>(bottom, "Hum");
+    formatTenths<5>(bottom, shareTenths(stats.humidifierOnMs, stats.trackedMs));
+    formatText<9>(bottom, "%");
+    formatCount<11>(bottom, stats.humidifierSwitches);
+    formatText<15>(bottom, "x");
+  }
+  else if (screen == 1)
+  {
+    // "37.1/37.5/37.9C", minimum, mean and maximum
+    bool read = stats.readings;
+    formatTenths<0>(top, read ? stats.tempMin : LCD_NO_VALUE);
+    formatText<4>(top, "/");
+    formatTenths<5>(top, read ? lroundf((float)stats.tempSum / stats.readings) : LCD_NO_VALUE);
+    formatText<9>(top, "/");
+    formatTenths<10>(top, read ? stats.tempMax : LCD_NO_VALUE);
+    formatText<14>(top, "C");
+    formatTenths<0>(bottom, read ? stats.humidityMin : LCD_NO_VALUE);
+    formatText<4>(bottom, "/");
+    formatTenths<5>(bottom, read ? lroundf((float)stats.humiditySum / stats.readings) : LCD_NO_VALUE);
+    formatText<9>(bottom, "/");
+    formatTenths<10>(bottom, read ? stats.humidityMax : LCD_NO_VALUE);
+    formatText<14>(bottom, "%");
+  }
+  else
+  {
+    // "Out of band d05" / "T  3.1%  H 12.4%"
+    formatText<0>(top, "Out of band d");
+    formatTwoDigits<13>(top, stats.day);
+    formatText<0>(bottom, "T");
+    formatTenths<2>(bottom, shareTenths(stats.tempOutMs, stats.trackedMs));
+    formatText<6>(bottom, "%");
+    formatText<9>(bottom, "H");
+    formatTenths<11>(bottom, shareTenths(stats.humidityOutMs, stats.trackedMs));
+    formatText<15>(bottom, "%");
+  }
+  lcdShow(top, bottom);
 }
 
-void updateLCD()
+static void lcdFlushTx()
 {
-  if (!incubationStartTimestamp || currentDay > 22)
-    return lcdType("     Idle..", "Press Btn Start!");
-
-  char buffer[17];
-  if (!timeSynced)
-    sprintf(buffer, " Internet Error"); // indicates no internet connection
-  else if (currentDay == 22)
-    sprintf(buffer, "Incubation Ended"); // Incubation cycle ended
-  else if (currentDay > 18)
-    sprintf(buffer, "%02u/21d Hatching!", currentDay); // hatching days no turning timer
+  if (!txLength)
+    return;
+
+  // the sensors may take the bus in between; after a failure nothing more
+  // is sent until lcdReset()
+  if (!txFailed && i2cWrite(LCD_ADDRESS, txBuffer, txLength))
+    windowBytes += txLength + 1; // + address byte
   else
-    sprintf(buffer, "%02u/21d %s", currentDay, formatTimer()); // turning timer
+    txFailed = true;
+  txLength = 0;
+}
+
+/**
+ * Queues one byte for the controller as two 4-bit transfers, each latched on
+ * the falling edge of E. An expander write takes 22.5 us at 400 kHz (90 us
+ * at 100 kHz), so a whole instruction spans more than its 37 us execution
+ * time and no extra delays are needed between queued bytes.
+ */
+static void lcdQueue(uint8_t value, uint8_t rs)
+{
+  uint8_t high = (value & 0xF0) | rs | LCD_BACKLIGHT;
+  uint8_t low = (value << 4) | rs | LCD_BACKLIGHT;
+
+  if (txLength + 5u > sizeof(txBuffer))
+    lcdFlushTx();
+
+  if (rs != lastRs)
+  {
+    txBuffer[txLength++] = high; // let RS settle before E rises
+    lastRs = rs;
+  }
+  txBuffer[txLength++] = high | LCD_EN;
+  txBuffer[txLength++] = high;
+  txBuffer[txLength++] = low | LCD_EN;
+  txBuffer[txLength++] = low;
+}
+
+/** Sends a single nibble, used while the controller is still in 8-bit mode. */
+static void lcdNibble(uint8_t value)
+{
+  uint8_t out = (value & 0xF0) | LCD_BACKLIGHT;
+  txBuffer[txLength++] = out;
+  txBuffer[txLength++] = out | LCD_EN;
+  txBuffer[txLength++] = out;
+  lcdFlushTx();
+}
+
+/**
+ * Resets the controller by instruction (HD44780 datasheet fig. 24), which
+ * also resynchronises one left in the middle of a 4-bit transfer by a
+ * brownout or a cut-short write, and clears it.
+ */
+static void lcdReset()
+{
+  txFailed = false;
+  txLength = 0;
+  resetAt = millis();
+  lcdNibble(0x30);
+  delayMicroseconds(4100);
+  lcdNibble(0x30);
+  delayMicroseconds(100);
+  lcdNibble(0x30);
+  lcdNibble(0x20); // 4-bit interface
+  lastRs = 0;
+
+  lcdQueue(0x28, 0); // 2 lines, 5x8 font
+  lcdQueue(0x0C, 0); // display on, cursor off
+  lcdQueue(0x06, 0); // entry mode: increment, no shift
+  lcdQueue(0x01, 0); // clear
+  lcdFlushTx();
+  delayMicroseconds(2000); // clear takes 1.52 ms
+
+  memset(shadow, ' ', sizeof(shadow));
+  resetFailed = txFailed;
+}
+
+/**
+ * @return Whether the display is in step with the shadow buffer, resetting
+ * it first after a failed write: at once, then every LCD_RESET_RETRY while
+ * the resets fail too.
+ */
+static bool lcdReady()
+{
+  if (txFailed && !resetFailed)
+    Serial.println("⚠️ LCD write failed, resetting the display");
+  if (txFailed && (!resetFailed || millis() - resetAt >= LCD_RESET_RETRY))
+    lcdReset();
+  return !txFailed;
+}
+
+void lcdBegin()
+{
+  Wire.setClock(LCD_I2C_CLOCK);
+  lcdReset();
+  windowStart = millis();
+}
+
+/**
+ * Diffs a row against the shadow buffer and queues only the changed runs.
+ * A single unchanged cell between two runs is resent rather than paying
+ * for another cursor command.
+ */
+static void lcdWriteRow(uint8_t row, const LcdRow &frame)
+{
+  uint8_t col = 0;
+  while (col < LCD_COLS)
+  {
+    if (frame[col] == shadow[row][col])
+    {
+      col++;
+      continue;
+    }
+
+    uint8_t end = col + 1;
+    while (end < LCD_COLS && (frame[end] != shadow[row][end] ||
+                              (end + 1 < LCD_COLS && frame[end + 1] != shadow[row][end + 1])))
+      end++;
 
-  lcdType(isSensorOk ? formatSensorMsg() : "Sensor Timeout!!", buffer);
+    lcdQueue(0x80 | (row * 0x40 + col), 0); // set DDRAM address
+    for (; col < end; col++)
+    {
+      lcdQueue(frame[col], LCD_RS);
+      shadow[row][col] = frame[col];
+    }
+  }
+}
+
+/** Pads `text` to a row, cutting it at LCD_COLS characters. */
+static void toRow(LcdRow &row, const char *text)
+{
+  formatClear(row);
+  for (uint8_t i = 0; i < LCD_COLS && text[i]; i++)
+    row[i] = text[i];
 }
 
 void lcdType(const char *line1, const char *line2)
 {
-  if (strlen(line1) > 0) {
-    lcd.setCursor(0, 0);
-    lcd.print(line1);
+  if (!lcdReady())
+    return;
+
+  LcdRow frame;
+  if (strlen(line1) > 0)
+  {
+    toRow(frame, line1);
+    lcdWriteRow(0, frame);
   }
 
-  if (strlen(line2) > 0) {
-    lcd.setCursor(0, 1);
-    lcd.print(line2);
+  if (strlen(line2) > 0)
+  {
+    toRow(frame, line2);
+    lcdWriteRow(1, frame);
   }
-}
\ No newline at end of file
+
+  lcdFlushTx(); // both rows in as few transactions as the Wire buffer allows
+}
+
+static void lcdShow(const LcdRow &line1, const LcdRow &line2)
+{
+  if (!lcdReady())
+    return;
+
+  lcdWriteRow(0, line1);
+  lcdWriteRow(1, line2);
+  lcdFlushTx();
+}
+
+unsigned long lcdBytesPerSecond()
+{
+  unsigned long elapsed = millis() - windowStart;
+  if (elapsed >= 1000)
+  {
+    bytesPerSecond = windowBytes * 1000 / elapsed;
+    windowBytes = 0;
+    windowStart = millis();
+  }
+  return bytesPerSecond;
+}
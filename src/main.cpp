@@ -1,106 +1,210 @@
 #include <Arduino.h>
-#include <DHTesp.h>
-#include <Wire.h>
-#include <LiquidCrystal_I2C.h>
 #include <LittleFS.h>
-#include <ArduinoJson.h>
 #include <WiFi.h>
 #include "wifi_manager.h"
 #include "lcd_manager.h"
 #include "time_manager.h"
-
-/* Pins */
-#define TEMP_RELAY_PIN 17
-#define RESET_BUTTON_PIN 19
-#define DHT22_PIN 23
-#define SDA_PIN 21
-#define SCL_PIN 22
-#define BUZZER_BJT_PIN 5
-#define HUMIDIFIER_MOSFET_PIN 18
-#define HUMIDIFIER_PAUSE_BUTTON_PIN 4
-#define HUMIDIFIER_STATE_LED_PIN 16
+#include "dht_reader.h"
+#include "sensors.h"
+#include "sample_filter.h"
+#include "i2c_bus.h"
+#include "buttons.h"
+#include "state_journal.h"
+#include "history.h"
+#include "heater_control.h"
+#include "thermal_model.h"
+#include "shared_state.h"
+#include "tasks.h"
+#include "deadlines.h"
+#include "power.h"
+#include "probes.h"
+#include "console.h"
+#include "telemetry_server.h"
+#include "chambers.h"
+#include "profiles.h"
+#include "config_store.h"
+#include "alarm_manager.h"
+#include "turner.h"
+#include "day_stats.h"
+#include "pins.h"
 
 /* Global */
-DHTesp dhtSensor;
-const uint16_t DHT_DELAY = 10 * 1000; // in ms
-unsigned long dhtLastRead = 0;        // in ms
-float temp = NAN;
-float humidity = NAN;
-const uint16_t DHT_MAX_TIMEOUT = 60 * 1000; // in ms
-unsigned long lastDhtOkRead = 0; // in ms
-bool isSensorOk = false; // flag to indicate if the sensor is OK, used only for LCD display purposes
+Chambers chambers; // chamber 0 is the primary one, see chambers.h
 
-LiquidCrystal_I2C lcd(0x27, 16, 2); // https://learn.adafruit.com/scanning-i2c-addresses/arduino
+uint16_t sensorInterval = 0;          // in ms, between rounds: the shortest sensor period
+unsigned long sensorRoundAt = 0;      // in ms, start of the last round of conversions
+unsigned long sensorRounds = 0;       // started since boot
+uint8_t sensorChamber = 0;            // converting, chambers.count once the round is done
+unsigned long sensorStartedAt = 0;    // in ms, start of its conversion
+const uint16_t SENSOR_TIMEOUT = 60 * 1000; // in ms
+const uint16_t SENSOR_WARMUP = 1100;       // in ms, the DHT22 ignores requests for 1s after power-up
+const uint16_t HISTORY_INTERVAL = 10 * 1000; // in ms, between two history samples
 
 // time
-unsigned long incubationStartTimestamp = 0; // in seconds
-
 unsigned long NEW_DAY_CHECK_INTERVAL = 30 * 60 * 1000; // in ms
-byte currentDay = 0;
-unsigned long dayLastCheck = 0; // in ms
+unsigned long dayLastCheck = 0;  // in ms
+unsigned long wifiLastCheck = 0; // in ms, last NTP correction or attempt
+const unsigned long CLOCK_RESYNC_INTERVAL = 6 * 3600 * 1000UL; // in ms
+const uint32_t CLOCK_CHECKPOINT_INTERVAL = 3600;               // in s, journaled clock after a power loss
+uint32_t clockCheckpoint = 0;                                  // unix time last journaled
+const uint32_t WIFI_ATTEMPT_TIMEOUT = 60 * 1000;               // in ms, for a correction
+unsigned long wifiAttemptAt = 0;                               // in ms
 
 unsigned int timeInSeconds = 0;
 unsigned long timerLastUpdate = 0; // in ms
 byte intervalHours = 0;
 unsigned long lastTurnTimestamp = 0;
-
-unsigned long buzzerLastActive = 0; // in ms
-const uint16_t BUZZER_DELAY = 1500; // in ms
+unsigned long turnStartedAt = 0; // unix time the turner started the turn in flight
+bool turnerFailed = false;       // its last motion failed, turns are by hand until one is recorded
+
+// alarms, see alarm_manager.h
+const unsigned long ALARM_SNOOZE = 10 * 60 * 1000;        // in ms
+const float OVER_TEMP_MARGIN = 1.5;                       // C above the target
+const float OVER_TEMP_HYST = 0.5;                         // C below the margin before it ends
+ChamberMask overTemp = 0;                                 // chambers above it
+const unsigned long HUMIDIFIER_STUCK = 45 * 60 * 1000UL;  // in ms, on without a break
+const float HUMIDIFIER_MIN_RISE = 2;                      // %RH over HUMIDIFIER_STUCK, less is a dry tank
+unsigned long humidifierOnSince[MAX_CHAMBERS] = {};       // in ms, 0 while off
+float humidityAtOn[MAX_CHAMBERS];                         // %RH when it switched on
 
 const unsigned int HUMIDIFIER_PAUSE_MAX_INTERVAL = 5 * 60 * 1000; // in ms
 unsigned long humidifierPausedAt = 0;
-bool isHumidifierPaused = false;
 
 // wifi connection
-const char *ssid;
-const char *pwd;
 bool isWifiConnecting = false;
 bool wifiConnected = false;
+bool wifiStayOnline = false; // the telemetry server needs the link
 bool timeSynced = false;
+bool isTimeSyncing = false;
 unsigned long lastSyncAttempt = 0;
 const uint16_t SYNC_RETRY_INTERVAL = 30000; // in ms
 
-// config
-float earlyTempTarget;
-float earlyTempHyst;
-float hatchTempTarget;
-float hatchTempHyst;
-float earlyHumTarget;
-float earlyHumHyst;
-float hatchHumTarget;
-float hatchHumHyst;
-
-float tempTarget;
-float tempHyst;
-bool heaterState = false;
-bool humidifierState = false;
-float humidityTarget;
-float humidityHyst;
-
-float tempLossPerSecond;
+// task channels, see shared_state.h
+Snapshot<ControlState> controlState;
+Snapshot<ServiceState> serviceState;
+SpscQueue<UiEvent, 4> uiEvents;
+
+ServiceState service = {};     // control task's copy of serviceState
+uint32_t lastSyncCount = 0;
+ControlState shown = {};       // what the control task last published
+float shownTemp = NAN;         // readings as displayed, refreshed on a 0.1 change
+float shownHumidity = NAN;
+uint32_t lcdSequence = 0;      // controlState sequence on the display
+uint8_t lcdClock = CLOCK_UNSET;
+bool messageShown = false;        // a message or the day's figures cover the display
+unsigned long messageShownAt = 0; // in ms
+const uint16_t MESSAGE_DURATION = 3000; // in ms
+bool dayShown = false;            // the message is the day's figures, see updateDayLCD()
+uint8_t dayScreen = 0;            // of them on the display
+const unsigned long DAY_SCREEN_DURATION = 4000; // in ms, each
+unsigned long lastTaskReport = 0;
+const unsigned long TASK_REPORT_INTERVAL = 10 * 60 * 1000; // in ms
+
+// wakeups of the control task, see planWakeups()
+enum ControlTimer
+{
+  TIMER_SENSOR_START,
+  TIMER_SENSOR_READY,
+  TIMER_COUNTDOWN,
+  TIMER_ALARM,
+  TIMER_DAY_CHECK,
+  TIMER_HUMIDIFIER_PAUSE,
+  TIMER_SENSOR_TIMEOUT,
+  TIMER_HEATER,
+  CONTROL_TIMER_COUNT
+};
+Deadlines<CONTROL_TIMER_COUNT> deadlines;
+const uint16_t FAILSAFE_PERIOD = 1000;     // in ms, the estimate drifts, unlike a reading
+const uint16_t CONTROL_IDLE_WAIT = 1000;   // in ms, with nothing scheduled
+const uint16_t SERVICE_BUSY_WAIT = 20;     // in ms, while WiFi or NTP needs polling
+
+// config, see config_store.h
+Config config;
+
+HeaterMode heaterMode = HEATER_HYSTERESIS;
+
+float tempLossPerSecond; // failsafe rates until the thermal model has learned
 float tempGainPerSecond;
-unsigned long heaterLastSwitch = 0; // in ms
-float estimatedTemp;
 
-// debounce
-const unsigned long DEBOUNCE_DELAY = 50; // 50ms is common
-
-bool lastResetButtonState = HIGH;
-bool resetButtonPressed = false;
-unsigned long lastResetDebounceTime = 0;
-
-bool lastPauseButtonState = HIGH;
-bool pauseButtonPressed = false;
-unsigned long lastPauseDebounceTime = 0;
+// boot
+bool controlStarted = false;
+unsigned long bootControlAt = 0; // in ms, time of the first heater decision
 
 /* Declare Functions */
+/** Starts the next due conversion of a running chamber, from sensorChamber on. */
+void startConversion();
+/** @return whether the round in flight is one of those every `period` ms. */
+bool roundDue(uint16_t period);
+/**
+ * Collects the conversion in flight, if finished, and starts the next one.
+ * @return the chambers whose reading changed by more than 0.1
+ */
+ChamberMask readSensors();
 /**
- * @return whether last read changed or not
+ * Adds the chambers listed in config.json with their sensors, chamber 0
+ * wired as in pins.h with a DHT22 by default.
  */
-bool readSensor();
-void updateDynamicConfig();
+void addChambers(const Config &config);
+/** Sets a chamber's targets for its day, from its profile and the overrides. */
+void updateDynamicConfig(uint8_t chamber);
+/** @return Whether the primary chamber's eggs are turned today. */
+bool turningDay();
+/** Sets a chamber's day, with its setpoints, and journals it. */
+void setDay(uint8_t chamber, byte day);
+/** @return The day a chamber's figures are kept for (see day_stats.h), 0 outside its cycle. */
+byte accountedDay(uint8_t chamber);
+/** @return incubation day at `now` of a cycle started at `start`, 0 if none. */
+byte dayOf(unsigned long start, unsigned long now);
+/** Recomputes chambers.running from the days and start dates. */
+void updateRunning();
 void setHumidifierState(bool paused);
-void writeConfig(StaticJsonDocument<512> &doc);
+/**
+ * Sensor, heater, humidifier, buttons and turn alarm; never blocks.
+ * @return ms until the next deadline
+ */
+uint32_t controlStep();
+/**
+ * WiFi, NTP, LCD and flash; free to block for a while.
+ * @return ms until it needs to run again
+ */
+uint32_t serviceStep();
+/** Arms a control timer for everything the next steps are waiting for. */
+void planWakeups();
+void runCycle();
+/** @return whether the primary chamber runs a cycle */
+bool cycleRunning();
+void handleButtons();
+void onResetButton(ButtonGesture gesture);
+void onPauseButton(ButtonGesture gesture);
+/** Day 1 from now; needs the time, asks for internet access otherwise. */
+void startIncubation();
+/** Restarts the countdown and journals a turn done now, by hand. */
+void recordTurn();
+/** Has the turner turn the tray now; the countdown restarts from now. */
+void startTurn();
+/**
+ * Collects the turner's result, turns the tray once the countdown is over
+ * and levels it for the hatch.
+ */
+void updateTurner();
+void regulate();
+/** Sets the condition of every alarm source from the chambers' state. */
+void updateAlarms();
+void handleConnectivity(const ControlState &state);
+void refreshDisplay(const ControlState &state, uint32_t sequence);
+void onTimeSynced();
+/** @return whether the state changed and was published */
+bool publishControlState();
+/** @return Unix time on the clock as last published, 0 if unknown. */
+unsigned long unixNow();
+/** @return Whether the clock has a time, from NTP or estimated. */
+bool timeKnown();
+
+/** Finished DHT frames wake the control task. */
+void IRAM_ATTR wakeControl()
+{
+  tasksWakeFromISR(TASK_CONTROL);
+}
 
 /* Setup */
 void setup()
@@ -108,14 +212,12 @@ void setup()
   Serial.begin(115200);
 
   // pins
-  pinMode(RESET_BUTTON_PIN, INPUT_PULLUP);
-  pinMode(HUMIDIFIER_PAUSE_BUTTON_PIN, INPUT_PULLUP);
+  buttonsBegin([] { tasksWake(TASK_CONTROL); });
 
   pinMode(TEMP_RELAY_PIN, OUTPUT);
   digitalWrite(TEMP_RELAY_PIN, LOW);
 
-  pinMode(BUZZER_BJT_PIN, OUTPUT);
-  digitalWrite(BUZZER_BJT_PIN, LOW);
+  alarmBegin(BUZZER_BJT_PIN);
 
   pinMode(HUMIDIFIER_MOSFET_PIN, OUTPUT);
   digitalWrite(HUMIDIFIER_MOSFET_PIN, LOW);
@@ -127,389 +229,855 @@ void setup()
   Serial.println("Reading Flash Memory..");
   LittleFS.begin();
 
-  File configFile = LittleFS.open("/config.json", FILE_READ);
-  if (!configFile)
-  {
-    Serial.println("Error opening config file");
+  // config.json, parsed only when it changed (see config_store.h)
+  unsigned long loadStart = micros();
+  ConfigLoad load = configLoad(config);
+  if (load == CONFIG_MISSING)
     return;
+  Serial.print("⏱️ Config ");
+  Serial.print(load == CONFIG_CACHED ? "read from its image" : "parsed");
+  Serial.print(" in ");
+  Serial.print(micros() - loadStart);
+  Serial.println(" us");
+
+  heaterMode = (HeaterMode)config.heaterMode;
+  tempLossPerSecond = config.tempLossPerSecond;
+  tempGainPerSecond = config.tempGainPerSecond;
+  filterBegin(config.filter);
+  turnerBegin(config.turner, {TURNER_STEP_PIN, TURNER_DIR_PIN, TURNER_ENABLE_PIN, TURNER_END_STOP_PIN});
+  turnerOnStop([] { tasksWake(TASK_CONTROL); });
+
+  // Runtime state lives in the journal, config.json only provides the seeds
+  journalBegin();
+  addChambers(config);
+  byte turnsPerDay = config.turnsPerDay ? config.turnsPerDay : PROFILES[chambers.profile[0]].turnsPerDay;
+  intervalHours = 24 / turnsPerDay;
+  chambers.incubationStart[0] = journalGet(STATE_INCUBATION_START, config.incubationStart);
+  lastTurnTimestamp = journalGet(STATE_LAST_TURN, config.lastTurn);
+  chambers.day[0] = journalGet(STATE_CURRENT_DAY, 0); // until NTP confirms it
+  if (journalGet(STATE_HUMIDIFIER_PAUSED, false))
+    setHumidifierState(true);
+
+  // the clock, carried across a reset or resumed from its last checkpoint
+  uint32_t checkpoint = journalGet(STATE_CLOCK, 0);
+  clockBegin(checkpoint > lastTurnTimestamp ? checkpoint : lastTurnTimestamp, (int32_t)journalGet(STATE_CLOCK_DRIFT, 0));
+  publishTimeState();
+
+  // the day's heater, humidifier and band figures, carried on from the
+  // checkpoint of the day in progress
+  dayStatsBegin(chambers.count);
+  for (uint8_t i = 0; i < chambers.count; i++)
+    dayStatsRollover(i, millis(), 0, accountedDay(i));
+
+  if (heaterMode == HEATER_PID)
+    pidBegin(config.pid);
+
+  timeInSeconds = intervalHours * 3600; // initial
+
+  // served once WiFi is up, which then stays up
+  wifiStayOnline = config.telemetry;
+  if (wifiStayOnline)
+    telemetryBegin(config.telemetryPort);
+
+  // Heater control starts on the first loop() pass with the restored phase.
+  // Until the sensor's first sample arrives the failsafe estimator drives the
+  // relay, starting from the bottom of the hysteresis band. The primary
+  // chamber has the fitted thermal model, the others the configured rates.
+  for (uint8_t i = 0; i < chambers.count; i++)
+    updateDynamicConfig(i);
+  thermalModelBegin(tempGainPerSecond, tempLossPerSecond, chambers.tempTarget[0] - chambers.tempHyst[0]);
+  chambers.modelled = CHAMBER_BIT(0);
+  chambers.externalHeater = heaterMode == HEATER_PID ? CHAMBER_BIT(0) : 0;
+
+  // without credentials the attempts fail and the device runs on its own clock
+  if (!wifiLoadCredentials("/wifi.json"))
+    Serial.println("❌ No WiFi credentials, running offline");
+
+  Serial.println("✅ Configured");
+
+  // wifi, association and NTP sync complete in the background (see loop())
+  Serial.println("Establishing Wifi Connection..");
+  wifiConnect();
+  wifiAttemptAt = millis();
+
+  // I2C bus, shared by the LCD and the I2C sensors
+  i2cBusBegin();
+
+  // LCD, drawn by the first service step
+  lcdBegin();
+  timerLastUpdate = millis();
+
+  // sensors, set up by addChambers(); rounds of conversions run at the pace
+  // of the fastest, from once warmed up
+  dhtOnFrame(wakeControl);
+  for (uint8_t i = 0; i < chambers.count; i++)
+    if (!sensorInterval || sensorPeriod(i) < sensorInterval)
+      sensorInterval = sensorPeriod(i);
+  sensorRoundAt = millis() + SENSOR_WARMUP - sensorInterval;
+
+  // temperature, humidity and actuator history, one sample per HISTORY_INTERVAL
+  historyBegin(HISTORY_INTERVAL / 1000, PROFILES[chambers.profile[0]].days + 1);
+
+  // buttons wake the chip from light sleep, the sensor is never asleep mid-frame
+  const uint8_t wakePins[] = {RESET_BUTTON_PIN, HUMIDIFIER_PAUSE_BUTTON_PIN};
+  powerBegin(wakePins, sizeof(wakePins), buttonsResync);
+
+  publishControlState();
+  tasksBegin(controlStep, serviceStep);
+}
+
+/* Loop */
+void loop()
+{
+  tasksRun();
+}
+
+uint32_t controlStep()
+{
+  PROBE(PROBE_CONTROL_STEP);
+
+  // Time as last published by the service task
+  serviceState.read(service);
+  clockAlive();
+  if (service.syncCount != lastSyncCount)
+  {
+    lastSyncCount = service.syncCount;
+    onTimeSynced();
   }
 
-  StaticJsonDocument<512> configDoc; /* arduinojson.org/v6/assistant */
-  if (deserializeJson(configDoc, configFile) != DeserializationError::Ok)
+  handleButtons();
+
+  updateRunning();
+  if (chambers.running)
+    runCycle();
+  updateAlarms();
+  dayStatsActuators(millis(), chambers.heaterOn, chambers.humidifierOut);
+  dayStatsPublish();
+
+  if (publishControlState())
+    tasksWake(TASK_SERVICE);
+
+  planWakeups();
+  unsigned long now = millis();
+  deadlines.expire(now); // due ones were handled by this step, or are waiting on an input
+  return deadlines.untilNext(now, CONTROL_IDLE_WAIT);
+}
+
+void planWakeups()
+{
+  bool running = chambers.running;
+  bool primary = cycleRunning();
+  unsigned long now = millis();
+  bool sensorValid = chambers.readAt[0] && now - chambers.readAt[0] < SENSOR_TIMEOUT;
+
+  // the first sensor of a running chamber to time out, and whether one has
+  bool anyRead = false, anyLost = false;
+  unsigned long timeoutAt = 0;
+  for (uint8_t i = 0; i < chambers.count; i++)
   {
-    Serial.println("Error deserializing config file");
-    return;
+    if (!(chambers.running & CHAMBER_BIT(i)))
+      continue;
+    unsigned long readAt = chambers.readAt[i];
+    anyLost |= !readAt || now - readAt >= SENSOR_TIMEOUT;
+    if (readAt && (!anyRead || (long)(readAt - (timeoutAt - SENSOR_TIMEOUT)) < 0))
+      timeoutAt = readAt + SENSOR_TIMEOUT;
+    anyRead |= readAt != 0;
   }
-  configFile.close();
 
-  incubationStartTimestamp = configDoc["incubation_start_date"];
-  JsonObject tempConfig = configDoc["temperature"];
-  JsonObject humidityConfig = configDoc["humidity"];
-  JsonObject failoverConfig = configDoc["failover"];
-  JsonObject turningConfig = configDoc["turning"];
+  auto plan = [](ControlTimer timer, bool armed, unsigned long due)
+  {
+    if (armed)
+      deadlines.set(timer, due);
+    else
+      deadlines.cancel(timer);
+  };
+
+  plan(TIMER_SENSOR_START, running, sensorRoundAt + sensorInterval);
+  plan(TIMER_SENSOR_READY, running && sensorChamber < chambers.count,
+       sensorStartedAt + sensorConversionTime(sensorChamber));
+  plan(TIMER_SENSOR_TIMEOUT, running && anyRead, timeoutAt);
+  plan(TIMER_HUMIDIFIER_PAUSE, primary && humidifierPausedAt, humidifierPausedAt + HUMIDIFIER_PAUSE_MAX_INTERVAL);
+  plan(TIMER_DAY_CHECK, running && timeKnown(), dayLastCheck + NEW_DAY_CHECK_INTERVAL);
+  bool turning = primary && turningDay();
+  plan(TIMER_COUNTDOWN, turning && timeInSeconds, timerLastUpdate + 1000);
+  unsigned long alarmAt = 0;
+  plan(TIMER_ALARM, alarmNextStep(alarmAt), alarmAt);
+
+  // hysteresis decisions only change with a reading, the PID window and the
+  // failsafe estimates also with time
+  unsigned long switchAt = 0;
+  bool pidSwitch = primary && sensorValid && heaterMode == HEATER_PID && pidNextSwitch(switchAt);
+  if (anyLost && (!pidSwitch || (long)(switchAt - now) > FAILSAFE_PERIOD))
+    switchAt = now + FAILSAFE_PERIOD;
+  plan(TIMER_HEATER, pidSwitch || anyLost, switchAt);
+}
 
-  earlyTempTarget = tempConfig["early_days_target"];
-  earlyTempHyst = tempConfig["early_days_hysteresis"];
-  hatchTempTarget = tempConfig["hatching_days_target"];
-  hatchTempHyst = tempConfig["hatching_days_hysteresis"];
+void runCycle()
+{
+  bool primary = cycleRunning();
 
-  earlyHumTarget = humidityConfig["early_days_target"];
-  earlyHumHyst = humidityConfig["early_days_hysteresis"];
-  hatchHumTarget = humidityConfig["hatching_days_target"];
-  hatchHumHyst = humidityConfig["hatching_days_hysteresis"];
+  // Humidifier functionality Pause/Hold control
+  if (primary && humidifierPausedAt && millis() - humidifierPausedAt >= HUMIDIFIER_PAUSE_MAX_INTERVAL)
+    setHumidifierState(false);
 
-  tempLossPerSecond = failoverConfig["temp_loss_per_second"];
-  tempGainPerSecond = failoverConfig["temp_gain_per_second"];
+  // Day check and update, WiFi is handled by the service task
+  if (timeKnown() && millis() - dayLastCheck >= NEW_DAY_CHECK_INTERVAL)
+  {
+    unsigned long now = unixNow();
+    for (uint8_t i = 0; i < chambers.count; i++)
+    {
+      byte newDay = dayOf(chambers.incubationStart[i], now);
+      if (newDay > chambers.day[i])
+        setDay(i, newDay);
+    }
+    if (now - clockCheckpoint >= CLOCK_CHECKPOINT_INTERVAL)
+    {
+      clockCheckpoint = now;
+      journalSet(STATE_CLOCK, now); // where the clock resumes after a power loss
+      dayStatsCheckpoint(millis());
+    }
+    dayLastCheck = millis();
+  }
 
-  byte turnsPerDay = turningConfig["turns_per_day"];
-  intervalHours = 24 / turnsPerDay;
-  lastTurnTimestamp = turningConfig["last_turn_time"];
+  // Sensor acquisition runs in the background, one chamber after the
+  // other, see sensors.h
+  if (millis() - sensorRoundAt >= sensorInterval)
+  {
+    sensorRoundAt = millis();
+    sensorRounds++;
+    sensorChamber = 0;
+    startConversion();
+  }
 
-  timeInSeconds = intervalHours * 3600; // initial
+  if (readSensors() & CHAMBER_BIT(0))
+  {
+    shownTemp = chambers.temp[0];
+    shownHumidity = chambers.humidity[0];
+  }
 
-  File wifiFile = LittleFS.open("/wifi.json", FILE_READ);
-  if (!wifiFile)
+  if (!controlStarted)
   {
-    Serial.println("Error opening wifi file");
+    controlStarted = true;
+    bootControlAt = millis();
+    Serial.print("⏱️ Boot: first control decision after ");
+    Serial.print(bootControlAt);
+    Serial.println(" ms");
+  }
+
+  regulate();
+
+  if (!primary)
     return;
+
+  historyTrackActuators(unixNow(), chambers.heaterOn & CHAMBER_BIT(0), chambers.humidifierOut & CHAMBER_BIT(0));
+
+  // Turning days, the turner turns the tray once the countdown is over; the
+  // alarm sounds if it has no motor or failed
+  if (turningDay() && millis() - timerLastUpdate >= 1000 && !buttonDown(BUTTON_RESET) && timeInSeconds != 0)
+  {
+    timeInSeconds--;
+    // whole seconds from the last one, so a late step does not stretch the interval
+    timerLastUpdate = millis() - timerLastUpdate < 2000 ? timerLastUpdate + 1000 : millis();
   }
+  updateTurner();
+}
 
-  StaticJsonDocument<96> wifiDoc;
-  if (deserializeJson(wifiDoc, wifiFile) != DeserializationError::Ok)
+void updateTurner()
+{
+  switch (turnerPoll())
   {
-    Serial.println("Error deserializing wifi file");
+  case TURNER_BUSY:
     return;
-  }
-  wifiFile.close();
 
-  ssid = wifiDoc["ssid"].as<const char *>();
-  pwd = wifiDoc["pwd"].as<const char *>();
+  case TURNER_DONE:
+    Serial.print(turnerSide() == TURNER_LEVEL ? "🔄 Tray levelled for the hatch in " : "🔄 Eggs turned in ");
+    Serial.print(turnerStats().lastMoveMs);
+    Serial.println(" ms");
+    if (turnerSide() != TURNER_LEVEL && turnStartedAt)
+    {
+      lastTurnTimestamp = turnStartedAt;
+      journalSet(STATE_LAST_TURN, lastTurnTimestamp);
+    }
+    break;
 
-  Serial.println("✅ Configured");
+  case TURNER_FAILED:
+    turnerFailed = true;
+    if (turningDay())
+      timeInSeconds = 0; // the turn alarm asks for a hand
+    Serial.println("❌ Turner: the end-stop disagrees, turn the eggs by hand");
+    break;
 
-  // wifi
-  Serial.print("Establishing Wifi Connection");
-  wifiConnect();
-  isWifiConnecting = true;
+  case TURNER_IDLE:
+    break;
+  }
 
-  // timeout after 10 seconds
-  unsigned long wifiConnectStart = millis();
-  while (WiFi.status() != WL_CONNECTED && millis() - wifiConnectStart < 10000)
+  if (!turnerFitted() || turnerFailed)
+    return;
+  if (turningDay())
   {
-    delay(200);
-    Serial.print(".");
+    if (!timeInSeconds)
+      startTurn();
   }
+  else if (chambers.day[0] > PROFILES[chambers.profile[0]].turnLast && turnerLevel())
+    tasksAllowSleep(false); // until the service task sees it moving
+}
 
-  if (WiFi.status() == WL_CONNECTED)
+void startTurn()
+{
+  if (!turnerTurn())
+    return;
+  tasksAllowSleep(false); // light sleep would stop the steps, until the service task sees it moving
+  timeInSeconds = intervalHours * 3600;
+  timerLastUpdate = millis();
+  turnStartedAt = timeKnown() ? unixNow() : 0;
+}
+
+void recordTurn()
+{
+  timeInSeconds = intervalHours * 3600;
+  timerLastUpdate = millis();
+  if (timeKnown())
   {
-    onWiFiConnected();
-    syncTime();
+    lastTurnTimestamp = unixNow();
+    journalSet(STATE_LAST_TURN, lastTurnTimestamp);
   }
-  else
+  turnerFailed = false; // the motor gets another go at the next turn
+  alarmAcknowledge(ALARM_TURN);
+}
+
+uint32_t serviceStep()
+{
+  PROBE(PROBE_SERVICE_STEP);
+
+  ControlState state;
+  uint32_t sequence = controlState.read(state);
+
+  handleConnectivity(state);
+  consolePoll();
+  refreshDisplay(state, sequence);
+
+  if (wifiStayOnline)
   {
-    wifiConnected = false;
-    Serial.println("❌ WiFi Connection Failed");
-    Serial.print("Code: ");
-    Serial.println(WiFi.status());
+    PROBE(PROBE_TELEMETRY);
+    telemetryPoll(state, sequence, wifiConnected, clockNow());
   }
-  updateDynamicConfig();
 
-  // I2C Protocol
-  Wire.begin(SDA_PIN, SCL_PIN);
+  // Flash writes queued by the control task
+  journalMaintain();
+  historyMaintain();
+  dayStatsMaintain();
 
-  // LCD
-  lcd.init();
-  lcd.backlight();
-  updateLCD();
-  timerLastUpdate = millis();
+  if (millis() - lastTaskReport >= TASK_REPORT_INTERVAL)
+  {
+    tasksReport();
+    lastTaskReport = millis();
+  }
 
-  // dht22 sensor
-  dhtSensor.setup(DHT22_PIN, DHTesp::DHT22);
-  delay(2100); // initializing delay
-  readSensor();
+  // the radio draws far more than light sleep saves, and needs polling
+  bool radioBusy = isWifiConnecting || wifiConnected || isTimeSyncing;
+  tasksAllowSleep(!radioBusy && !state.trayMoving); // light sleep would stop the turner's steps too
+  if (radioBusy)
+    return SERVICE_BUSY_WAIT;
+
+  Deadlines<3> next;
+  next.set(0, lastTaskReport + TASK_REPORT_INTERVAL);
+  if (messageShown)
+    next.set(1, messageShownAt + (dayShown ? (dayScreen + 1) * DAY_SCREEN_DURATION : MESSAGE_DURATION));
+  if (state.chamberRunning || clockSource() == CLOCK_ESTIMATED)
+    next.set(2, wifiLastCheck + CLOCK_RESYNC_INTERVAL);
+  return next.untilNext(millis(), TASK_REPORT_INTERVAL);
 }
 
-/* Loop */
-void loop()
+bool cycleRunning()
 {
-  // WiFi handling
-  handleWifi();
+  return chambers.running & CHAMBER_BIT(0);
+}
+
+void updateRunning()
+{
+  ChamberMask running = 0;
+  for (uint8_t i = 0; i < chambers.count; i++)
+    if (chambers.day[i] && chambers.incubationStart[i] && chambers.day[i] <= PROFILES[chambers.profile[i]].days + 1)
+      running |= CHAMBER_BIT(i);
+  chambers.running = running;
+}
 
-  // NTP and dynamic config handling
-  if (wifiConnected && !timeSynced && millis() - lastSyncAttempt >= SYNC_RETRY_INTERVAL)
+void handleButtons()
+{
+  PROBE(PROBE_BUTTONS);
+
+  ButtonEvent event;
+  while (buttonsPoll(event))
   {
-    syncTime();
-    updateDynamicConfig();
-    lastSyncAttempt = millis();
+    if (event.button == BUTTON_RESET)
+      onResetButton(event.gesture);
+    else if (cycleRunning()) // Humidifier Pause/Hold button, only during a cycle
+      onPauseButton(event.gesture);
   }
+}
 
-  // Handle reset button
-  bool readingReset = digitalRead(RESET_BUTTON_PIN);
-  if (readingReset != lastResetButtonState)
-    lastResetDebounceTime = millis();
-
-  if ((millis() - lastResetDebounceTime) > DEBOUNCE_DELAY)
+void onResetButton(ButtonGesture gesture)
+{
+  switch (gesture)
   {
-    if (readingReset == LOW && !resetButtonPressed)
+  case BUTTON_CLICK:
+    // the first press answers an alarm other than the turn
+    if (alarmSounding() != ALARM_NONE && alarmSounding() != ALARM_TURN)
     {
-      resetButtonPressed = true;
-      timeInSeconds = intervalHours * 3600;
-      timerLastUpdate = millis();
-
-      if (currentDay > 21 || !incubationStartTimestamp)
-      {
-        if (timeSynced)
-        {
-          File configFile = LittleFS.open("/config.json", FILE_READ);
-          StaticJsonDocument<512> configDoc;
-          deserializeJson(configDoc, configFile);
-          configFile.close();
-
-          currentDay = 1;
-          incubationStartTimestamp = getUnixTimestamp();
-          lastTurnTimestamp = incubationStartTimestamp;
-          configDoc["turning"]["last_turn_time"] = lastTurnTimestamp;
-          configDoc["incubation_start_date"] = incubationStartTimestamp;
-          writeConfig(configDoc);
-        }
-        else
-        {
-          lcdType("Internet Access.", "  Is Required!");
-          delay(3000);
-          updateLCD();
-        }
-      }
-      else if (currentDay < 18)
-      {
-        if (timeSynced)
-        {
-          File configFile = LittleFS.open("/config.json", FILE_READ);
-          StaticJsonDocument<512> configDoc;
-          deserializeJson(configDoc, configFile);
-          configFile.close();
-
-          lastTurnTimestamp = getUnixTimestamp();
-          configDoc["turning"]["last_turn_time"] = lastTurnTimestamp;
-          writeConfig(configDoc);
-        }
-        digitalWrite(BUZZER_BJT_PIN, LOW);
-        updateLCD();
-      }
+      alarmAcknowledge(alarmSounding());
+      break;
     }
+    timeInSeconds = intervalHours * 3600;
+    timerLastUpdate = millis();
+
+    if (chambers.day[0] > PROFILES[chambers.profile[0]].days || !chambers.incubationStart[0])
+      startIncubation();
+    else if (turningDay())
+      recordTurn();
+    break;
+
+  case BUTTON_DOUBLE: // quiet the sounding alarm for a while, without acknowledging it
+    if (alarmSounding() != ALARM_NONE)
+      alarmSnooze(alarmSounding(), ALARM_SNOOZE);
+    else if (uiEvents.push(UI_DAY_STATS)) // or show the day's figures
+      tasksWake(TASK_SERVICE);
+    break;
+
+  case BUTTON_LONG: // nothing: a slow turn acknowledgement must never restart the cycle
+    break;
   }
-  else if (readingReset == HIGH)
-    resetButtonPressed = false;
+}
 
-  lastResetButtonState = readingReset;
+void onPauseButton(ButtonGesture gesture)
+{
+  switch (gesture)
+  {
+  case BUTTON_CLICK:
+    setHumidifierState(!(chambers.humidifierHeld & CHAMBER_BIT(0)));
+    break;
+
+  case BUTTON_LONG:
+    if (heaterMode == HEATER_PID)
+      pidStartAutotune();
+    break;
+
+  case BUTTON_DOUBLE: // turn the tray now, by motor
+    if (turningDay() && !turnerFailed)
+      startTurn();
+    break;
+  }
+}
 
-  if (!currentDay || !incubationStartTimestamp || currentDay > 22)
+void startIncubation()
+{
+  if (!timeKnown())
+  {
+    if (uiEvents.push(UI_INTERNET_REQUIRED))
+      tasksWake(TASK_SERVICE);
     return;
+  }
 
-  // Humidifier functionality Pause/Hold control
-  if (humidifierPausedAt && millis() - humidifierPausedAt >= HUMIDIFIER_PAUSE_MAX_INTERVAL)
-    setHumidifierState(false);
+  chambers.day[0] = 1;
+  chambers.incubationStart[0] = unixNow();
+  lastTurnTimestamp = chambers.incubationStart[0];
+  turnerFailed = false;
+  alarmAcknowledge(ALARM_TURN);
+  updateDynamicConfig(0);
+  dayStatsRollover(0, millis(), chambers.incubationStart[0], 1);
+  historyRotate(PROFILES[chambers.profile[0]].days + 1); // the hatch day included, as in cycleRunning()
+  journalSet(STATE_INCUBATION_START, chambers.incubationStart[0]);
+  journalSet(STATE_LAST_TURN, lastTurnTimestamp);
+  journalSet(STATE_CURRENT_DAY, chambers.day[0]);
+  Serial.println("🥚 Incubation started, day 1");
+}
 
-  if (isHumidifierPaused)
+void regulate()
+{
+  PROBE(PROBE_REGULATION);
+
+  // The primary chamber's heater follows the PID while its sensor is
+  // healthy, and the thermal model stands in for the sensor when it is not
+  unsigned long now = millis();
+  if (cycleRunning())
   {
-    digitalWrite(HUMIDIFIER_MOSFET_PIN, LOW);
-    digitalWrite(HUMIDIFIER_STATE_LED_PIN, HIGH);
+    bool heaterOn = chambers.heaterOn & CHAMBER_BIT(0);
+    if (!chambers.readAt[0] || now - chambers.readAt[0] >= SENSOR_TIMEOUT)
+      chambers.estimate[0] = thermalModelEstimate();
+    else if (heaterMode == HEATER_PID &&
+             pidHeaterDemand(chambers.temp[0], chambers.readAt[0], chambers.tempTarget[0], heaterOn) != heaterOn)
+      chambers.heaterOn ^= CHAMBER_BIT(0);
   }
-  else
-    digitalWrite(HUMIDIFIER_STATE_LED_PIN, LOW);
 
-  bool readingPause = digitalRead(HUMIDIFIER_PAUSE_BUTTON_PIN);
-  if (readingPause != lastPauseButtonState)
-    lastPauseDebounceTime = millis();
+  // every chamber in one pass, see chambers.h
+  ChamberMask switched = chambersSweep(now, SENSOR_TIMEOUT, tempGainPerSecond, tempLossPerSecond);
+  if (switched & CHAMBER_BIT(0))
+    thermalModelHeater(chambers.heaterOn & CHAMBER_BIT(0));
+}
 
-  if ((millis() - lastPauseDebounceTime) > DEBOUNCE_DELAY)
+void updateAlarms()
+{
+  unsigned long now = millis();
+  ChamberMask lost = 0, stuck = 0;
+  for (uint8_t i = 0; i < chambers.count; i++)
   {
-    if (readingPause == LOW && !pauseButtonPressed)
+    ChamberMask bit = CHAMBER_BIT(i);
+    if (!(chambers.humidifierOut & bit))
+      humidifierOnSince[i] = 0;
+    else if (!humidifierOnSince[i])
+    {
+      humidifierOnSince[i] = now;
+      humidityAtOn[i] = chambers.humidity[i];
+    }
+    float margin = overTemp & bit ? OVER_TEMP_MARGIN - OVER_TEMP_HYST : OVER_TEMP_MARGIN;
+    overTemp &= ~bit;
+    if (!(chambers.running & bit))
+      continue;
+
+    if (!(chambers.sensorOk & bit))
     {
-      pauseButtonPressed = true;
-      setHumidifierState(!isHumidifierPaused);
+      // none while waiting for the first sample after boot
+      if (chambers.readAt[i] || now >= SENSOR_TIMEOUT)
+        lost |= bit;
     }
+    else if (chambers.temp[i] > chambers.tempTarget[i] + margin)
+      overTemp |= bit;
+    // a long climb, as into lockdown, is no fault as long as it climbs
+    if (humidifierOnSince[i] && now - humidifierOnSince[i] >= HUMIDIFIER_STUCK &&
+        !(chambers.humidity[i] - humidityAtOn[i] >= HUMIDIFIER_MIN_RISE))
+      stuck |= bit;
   }
-  else if (readingPause == HIGH)
-    pauseButtonPressed = false;
+  alarmSet(ALARM_OVER_TEMP, overTemp);
+  alarmSet(ALARM_SENSOR_LOST, lost);
+  alarmSet(ALARM_HUMIDIFIER_STUCK, stuck);
+  alarmSet(ALARM_TURN, cycleRunning() && turningDay() && timeKnown() && !timeInSeconds && !turnerMoving()
+                           ? CHAMBER_BIT(0)
+                           : 0);
+  alarmStep(now, unixNow());
+}
 
-  lastPauseButtonState = readingPause;
+void handleConnectivity(const ControlState &state)
+{
+  PROBE(PROBE_WIFI);
 
-  // Day check and update
-  if (millis() - dayLastCheck >= NEW_DAY_CHECK_INTERVAL)
+  // WiFi handling
+  handleWifi();
+
+  // NTP handling, first attempt right after connecting
+  if (wifiConnected && !timeSynced && !isTimeSyncing && (!lastSyncAttempt || millis() - lastSyncAttempt >= SYNC_RETRY_INTERVAL))
   {
-    if (timeSynced)
-    {
-      unsigned long currentTimestamp = getUnixTimestamp();
-      if (currentTimestamp == 0)
-        return;
+    startTimeSync();
+    lastSyncAttempt = millis();
+  }
 
-      isWifiConnecting = false;
-      byte newDay = ((currentTimestamp - incubationStartTimestamp) / (24 * 3600)) + 1;
-      if (newDay > currentDay)
-      {
-        currentDay = newDay;
-        updateDynamicConfig();
-      }
-      dayLastCheck = millis();
+  if (handleTimeSync())
+  {
+    wifiLastCheck = millis();
+    if (!timeSynced)
+      wifiForgetNetwork(); // connected but no answer, as on a stale lease: start over next time
+    // the clock runs on without it, a failed correction waits for the next
+    if (!timeSynced && clockSource() != CLOCK_UNSET && !wifiStayOnline)
       wifiDisconnect();
-    }
-    else if (!isWifiConnecting)
+  }
+
+  // The clock keeps the time by itself (see time_manager.h); during a cycle,
+  // or while it is only an estimate, NTP corrects it every
+  // CLOCK_RESYNC_INTERVAL and the radio stays off in between
+  if ((state.chamberRunning || clockSource() == CLOCK_ESTIMATED) && millis() - wifiLastCheck >= CLOCK_RESYNC_INTERVAL)
+  {
+    wifiLastCheck = millis();
+    if (wifiConnected && !isTimeSyncing)
+      startTimeSync();
+    else if (!wifiConnected && !isWifiConnecting)
+    {
       wifiConnect();
+      wifiAttemptAt = millis();
+    }
   }
 
-  if (millis() - dhtLastRead >= DHT_DELAY)
+  // with a running clock a missing network is no reason to keep trying
+  if (isWifiConnecting && clockSource() != CLOCK_UNSET && !wifiStayOnline && millis() - wifiAttemptAt >= WIFI_ATTEMPT_TIMEOUT)
   {
-    if (readSensor())
-      updateLCD();
-    dhtLastRead = millis();
+    Serial.println("❌ No WiFi for the clock, trying again later");
+    wifiDisconnect();
+    isWifiConnecting = false;
   }
 
-  /// Check if the DHT sensor data is still valid within the maximum allowed timeout
-  if (millis() - lastDhtOkRead < DHT_MAX_TIMEOUT)
+  if (publishTimeState())
+    tasksWake(TASK_CONTROL);
+}
+
+void refreshDisplay(const ControlState &state, uint32_t sequence)
+{
+  // a message stays up for MESSAGE_DURATION, the day's figures for
+  // DAY_SCREEN_DURATION a screen
+  UiEvent event;
+  if (uiEvents.pop(event))
   {
-    isSensorOk = true;
-    // Temperature control logic
-    if (heaterState)
-    {
-      if (temp >= tempTarget + tempHyst)
-      {
-        heaterState = false;
-        heaterLastSwitch = millis();
-        digitalWrite(TEMP_RELAY_PIN, LOW);
-      }
-    }
-    else
-    {
-      if (temp < tempTarget - tempHyst)
-      {
-        heaterState = true;
-        heaterLastSwitch = millis();
-        digitalWrite(TEMP_RELAY_PIN, HIGH);
-      }
-    }
+    if (event == UI_INTERNET_REQUIRED)
+      lcdType("Internet Access.", "  Is Required!");
+    messageShown = true;
+    messageShownAt = millis();
+    dayShown = event == UI_DAY_STATS;
+    dayScreen = 0;
+    if (dayShown)
+      updateDayLCD(dayStatsToday(0, millis()), dayScreen);
+  }
+  if (dayShown && millis() - messageShownAt >= (dayScreen + 1) * DAY_SCREEN_DURATION &&
+      ++dayScreen < LCD_DAY_SCREENS)
+    updateDayLCD(dayStatsToday(0, millis()), dayScreen);
+  if (messageShown && millis() - messageShownAt >= (dayShown ? LCD_DAY_SCREENS * DAY_SCREEN_DURATION : MESSAGE_DURATION))
+  {
+    messageShown = false;
+    dayShown = false;
+    lcdSequence = 0; // redraw
+  }
+  if (!messageShown && (sequence != lcdSequence || clockSource() != lcdClock))
+  {
+    PROBE(PROBE_LCD);
+    updateLCD(state);
+    lcdSequence = sequence;
+    lcdClock = clockSource();
+  }
+}
 
-    // Humidity control logic, only if not paused
-    if (!isHumidifierPaused)
+void startConversion()
+{
+  for (; sensorChamber < chambers.count; sensorChamber++)
+  {
+    if (!(chambers.running & CHAMBER_BIT(sensorChamber)) || !roundDue(sensorPeriod(sensorChamber)))
+      continue;
+    if (sensorStart(sensorChamber))
     {
-      if (humidifierState)
-      {
-        if (humidity >= humidityTarget + humidityHyst)
-        {
-          humidifierState = false;
-          digitalWrite(HUMIDIFIER_MOSFET_PIN, LOW);
-        }
-      }
-      else
-      {
-        if (humidity < humidityTarget - humidityHyst)
-        {
-          humidifierState = true;
-          digitalWrite(HUMIDIFIER_MOSFET_PIN, HIGH);
-        }
-      }
+      sensorStartedAt = millis();
+      return;
     }
   }
-  else
+}
+
+bool roundDue(uint16_t period)
+{
+  return (sensorRounds - 1) % (period / sensorInterval) == 0;
+}
+
+ChamberMask readSensors()
+{
+  PROBE(PROBE_SENSOR);
+
+  if (sensorChamber >= chambers.count)
+    return 0;
+  SensorSample data;
+  SensorStatus status = sensorPoll(sensorChamber, data);
+  if (status == SENSOR_PENDING)
+    return 0;
+
+  uint8_t i = sensorChamber;
+  ChamberMask changed = 0;
+  if (status == SENSOR_OK && filterApply(i, millis(), data))
   {
-    // failsafe mode
-    float currentEstimatedTemp;
-    if (heaterState)
+    float temp = chambers.temp[i], humidity = chambers.humidity[i];
+    if (isnan(temp) || fabs(temp - data.temperature) > 0.1 || fabs(humidity - data.humidity) > 0.1)
+      changed = CHAMBER_BIT(i);
+    chambers.temp[i] = data.temperature;
+    chambers.humidity[i] = data.humidity;
+    chambers.readAt[i] = millis();
+    dayStatsReading(i, millis(), data.temperature, data.humidity,
+                    fabs(data.temperature - chambers.tempTarget[i]) > chambers.tempHyst[i],
+                    fabs(data.humidity - chambers.humidityTarget[i]) > chambers.humidityHyst[i]);
+    if (i == 0)
     {
-      currentEstimatedTemp = estimatedTemp + (tempGainPerSecond * (millis() - heaterLastSwitch) / 1000.0);
-      if (currentEstimatedTemp >= tempTarget + tempHyst)
-      {
-        heaterState = false;
-        heaterLastSwitch = millis();
-        estimatedTemp = currentEstimatedTemp;
-        digitalWrite(TEMP_RELAY_PIN, LOW);
-      }
+      thermalModelObserve(data.temperature);
+      if (roundDue(HISTORY_INTERVAL))
+        historyAddSample(unixNow(), data.temperature, data.humidity);
     }
-    else
+  }
+
+  sensorChamber++;
+  startConversion();
+  return changed;
+}
+
+void addChambers(const Config &config)
+{
+  // the turner's pins last, taken only when a motor is fitted
+  const uint8_t reserved[] = {RESET_BUTTON_PIN, HUMIDIFIER_PAUSE_BUTTON_PIN, SDA_PIN, SCL_PIN,
+                              BUZZER_BJT_PIN, HUMIDIFIER_STATE_LED_PIN, TURNER_STEP_PIN, TURNER_DIR_PIN,
+                              TURNER_ENABLE_PIN, TURNER_END_STOP_PIN};
+  uint8_t reservedCount = config.turner.motor != TURNER_NONE ? sizeof(reserved) : sizeof(reserved) - 4;
+  uint8_t addresses[MAX_CHAMBERS] = {}; // of the I2C sensors, 0 for a DHT22
+
+  // a DHT22 on its pin, or an I2C sensor at its address
+  auto add = [&](const ChamberConfig &chamber) -> int8_t
+  {
+    if (chamber.sensor == SENSOR_TYPE_COUNT)
+      return -1;
+    SensorType type = (SensorType)chamber.sensor;
+    ChamberPins pins = chamber.pins;
+    uint8_t address = chamber.sensorAddress;
+    for (uint8_t i = 0; address && i < chambers.count; i++)
+      if (addresses[i] == address)
+        return -1;
+    if (address)
+      pins.sensor = NO_PIN;
+    else if (pins.sensor == NO_PIN)
+      return -1;
+    int8_t i = chambersAdd(pins, reserved, reservedCount);
+    if (i >= 0)
     {
-      currentEstimatedTemp = estimatedTemp - (tempLossPerSecond * (millis() - heaterLastSwitch) / 1000.0);
-      if (currentEstimatedTemp < tempTarget - tempHyst)
+      addresses[i] = address;
+      sensorBegin(i, type, address ? address : pins.sensor);
+      dayStatsPower(i, chamber.heaterWatts, chamber.humidifierWatts);
+      chambers.profile[i] = chamber.profile;
+      if (chambers.profile[i] == PROFILE_COUNT)
       {
-        heaterState = true;
-        heaterLastSwitch = millis();
-        estimatedTemp = currentEstimatedTemp;
-        digitalWrite(TEMP_RELAY_PIN, HIGH);
+        Serial.print("❌ Unknown profile for chamber ");
+        Serial.print(i);
+        Serial.println(", using chicken");
+        chambers.profile[i] = PROFILE_CHICKEN;
       }
     }
-    Serial.println("⚠️ Sensor timeout! System in failsafe mode.");
-    isSensorOk = false;
-  }
+    return i;
+  };
 
-  // Early/mid cycle handling
-  if (currentDay < 18)
+  if (add(config.chambers[0]) < 0)
   {
-    // Timer update
-    if (millis() - timerLastUpdate >= 1000 && digitalRead(RESET_BUTTON_PIN) == HIGH && timeInSeconds != 0)
-    {
-      timeInSeconds--;
-      timerLastUpdate = millis();
-      updateLCD();
-    }
+    Serial.println("❌ Chamber 0 sensor or pins are wrong, using the default ones");
+    add({SENSOR_DHT22, 0, {DHT22_PIN, TEMP_RELAY_PIN, HUMIDIFIER_MOSFET_PIN}, config.chambers[0].profile, 0,
+         config.chambers[0].heaterWatts, config.chambers[0].humidifierWatts});
+  }
 
-    // Buzzer alarm
-    if (timeSynced && timeInSeconds == 0 && millis() - buzzerLastActive >= BUZZER_DELAY)
+  // the primary chamber's cycle is started by the reset button, the others
+  // run from their configured start date
+  for (uint8_t n = 1; n < config.chamberCount; n++)
+  {
+    int8_t i = add(config.chambers[n]);
+    if (i < 0)
     {
-      digitalWrite(BUZZER_BJT_PIN, !digitalRead(BUZZER_BJT_PIN));
-      buzzerLastActive = millis();
+      Serial.print("❌ Chamber ");
+      Serial.print(n);
+      Serial.println(" skipped: unknown sensor, pins missing or taken, or too many chambers");
+      continue;
     }
+    chambers.incubationStart[i] = config.chambers[n].incubationStart;
+    chambers.day[i] = journalGet((StateKey)(STATE_CHAMBER_DAY + i - 1), 0); // until NTP confirms it
   }
 }
 
-bool readSensor()
+byte dayOf(unsigned long start, unsigned long now)
 {
-  TempAndHumidity data = dhtSensor.getTempAndHumidity();
-  bool readChange = false;
-  if (!isnan(data.temperature) && !isnan(data.humidity))
-  {
-    readChange = fabs(temp - data.temperature) > 0.1 || fabs(humidity - data.humidity) > 0.1;
-    temp = data.temperature;
-    estimatedTemp = temp;
-    humidity = data.humidity;
-    lastDhtOkRead = millis();
-  }
-  return readChange;
+  if (!start || now < start)
+    return 0;
+  return ((now - start) / (24 * 3600)) + 1;
 }
 
-void updateDynamicConfig()
+void setDay(uint8_t chamber, byte day)
 {
-  if (!timeSynced || currentDay < 18)
-  {
-    // day 0 Safe fallback: assume early/mid cycle
-    tempTarget = earlyTempTarget;
-    tempHyst = earlyTempHyst;
-    humidityTarget = earlyHumTarget;
-    humidityHyst = earlyHumHyst;
-  }
-  else
-  {
-    tempTarget = hatchTempTarget;
-    tempHyst = hatchTempHyst;
-    humidityTarget = hatchHumTarget;
-    humidityHyst = hatchHumHyst;
-  }
+  chambers.day[chamber] = day;
+  updateDynamicConfig(chamber);
+  journalSet(chamber ? (StateKey)(STATE_CHAMBER_DAY + chamber - 1) : STATE_CURRENT_DAY, day);
+  dayStatsRollover(chamber, millis(), timeKnown() ? unixNow() : 0, accountedDay(chamber));
+}
+
+byte accountedDay(uint8_t chamber)
+{
+  byte day = chambers.day[chamber];
+  return chambers.incubationStart[chamber] && day <= PROFILES[chambers.profile[chamber]].days + 1 ? day : 0;
+}
+
+void updateDynamicConfig(uint8_t chamber)
+{
+  // day 0 Safe fallback: the profile gives day 1's targets
+  const Profile &profile = PROFILES[chambers.profile[chamber]];
+  const ProfileDay &targets = profileDay(profile, chambers.day[chamber]);
+  chambers.tempTarget[chamber] = targets.temp + config.tempOffset;
+  chambers.tempHyst[chamber] = isnan(config.tempHyst) ? profile.tempHyst : config.tempHyst;
+  chambers.humidityTarget[chamber] = targets.humidity + config.humidityOffset;
+  chambers.humidityHyst[chamber] = isnan(config.humidityHyst) ? profile.humidityHyst : config.humidityHyst;
+}
+
+bool turningDay()
+{
+  return profileTurning(PROFILES[chambers.profile[0]], chambers.day[0]);
 }
 
 void setHumidifierState(bool paused)
 {
+  journalSet(STATE_HUMIDIFIER_PAUSED, paused);
   if (paused)
   {
     humidifierPausedAt = millis();
-    isHumidifierPaused = true;
+    chambers.humidifierHeld |= CHAMBER_BIT(0);
   }
   else
   {
     humidifierPausedAt = 0;
-    isHumidifierPaused = false;
+    chambers.humidifierHeld &= ~CHAMBER_BIT(0);
   }
+  digitalWrite(HUMIDIFIER_STATE_LED_PIN, paused ? HIGH : LOW);
+}
+
+void onTimeSynced()
+{
+  unsigned long currentTimestamp = unixNow();
+  // a turn overdue, e.g. after a power loss, is due now rather than at the
+  // next multiple of the interval; one in flight restarted the countdown
+  unsigned long passed = currentTimestamp - lastTurnTimestamp, interval = intervalHours * 3600UL;
+  if (!turnerMoving())
+    timeInSeconds = !lastTurnTimestamp ? interval : passed >= interval ? 0 : interval - passed;
+  for (uint8_t i = 0; i < chambers.count; i++)
+    setDay(i, dayOf(chambers.incubationStart[i], currentTimestamp));
+  dayLastCheck = millis();
+  clockCheckpoint = currentTimestamp;
+  journalSet(STATE_CLOCK, currentTimestamp);
+  journalSet(STATE_CLOCK_DRIFT, (uint32_t)service.clockDriftPpb);
+}
+
+unsigned long unixNow()
+{
+  return clockUnix(service, uptimeMillis());
 }
 
-void writeConfig(StaticJsonDocument<512> &doc)
+bool timeKnown()
 {
-  File configFileW = LittleFS.open("/config.json", FILE_WRITE);
-  serializeJson(doc, configFileW);
-  configFileW.close();
-}
\ No newline at end of file
+  return service.clockSource != CLOCK_UNSET;
+}
+
+bool publishControlState()
+{
+  ControlState state = {};
+  state.temp = shownTemp;
+  state.humidity = shownHumidity;
+  state.tempTarget = chambers.tempTarget[0];
+  state.isSensorOk = chambers.sensorOk & CHAMBER_BIT(0);
+  state.heaterOn = chambers.heaterOn & CHAMBER_BIT(0);
+  state.humidifierOn = chambers.humidifierOn & CHAMBER_BIT(0);
+  state.humidifierPaused = chambers.humidifierHeld & CHAMBER_BIT(0);
+  state.currentDay = chambers.day[0];
+  state.profile = chambers.profile[0];
+  state.timeInSeconds = timeInSeconds;
+  state.incubationStart = chambers.incubationStart[0];
+  state.samplesRejected = filterRejected(0);
+  state.alarm = alarmSounding();
+  state.tray = turnerSide();
+  state.trayMoving = turnerMoving();
+
+  state.chamberCount = chambers.count;
+  state.chamberRunning = chambers.running;
+  state.chamberSensorOk = chambers.sensorOk;
+  state.chamberHeater = chambers.heaterOn;
+  state.chamberHumidifier = chambers.humidifierOut;
+  for (uint8_t i = 0; i < chambers.count; i++)
+  {
+    // the primary chamber as displayed, the others to the sensor's resolution
+    float temp = i ? chambers.temp[i] : shownTemp, humidity = i ? chambers.humidity[i] : shownHumidity;
+    state.chamberTemp[i] = isnan(temp) ? INT16_MIN : lroundf(temp * 10);
+    state.chamberHumidity[i] = isnan(humidity) ? INT16_MIN : lroundf(humidity * 10);
+    state.chamberDay[i] = chambers.day[i];
+    state.chamberRejected[i] = filterRejected(i);
+  }
+
+  if (!memcmp(&state, &shown, sizeof(state)))
+    return false;
+  controlState.publish(state);
+  shown = state;
+  return true;
+}
@@ -0,0 +1,115 @@
+#include <Arduino.h>
+#include "power.h"
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+#include <driver/uart.h>
+#endif
+
+#define POWER_MAX_PINS 4
+#define UART_WAKE_EDGES 3 // rising edges on RX, the first character is lost
+
+static uint8_t pins[POWER_MAX_PINS];
+static uint8_t pinCount = 0;
+static void (*pinWakeCallback)() = nullptr;
+
+static uint64_t asleepMs = 0;
+static uint32_t wakeups = 0;
+static PowerStats reported = {}; // totals at the previous report
+
+#ifndef ARDUINO_ARCH_ESP32
+static bool booked = false;
+static unsigned long bookedAt = 0; // in ms
+#endif
+
+void powerBegin(const uint8_t *wakePins, uint8_t count, void (*onPinWake)())
+{
+  pinWakeCallback = onPinWake;
+  pinCount = count < POWER_MAX_PINS ? count : POWER_MAX_PINS;
+  for (uint8_t i = 0; i < pinCount; i++)
+    pins[i] = wakePins[i];
+
+#ifdef ARDUINO_ARCH_ESP32
+  esp_sleep_enable_gpio_wakeup();
+  uart_set_wakeup_threshold(UART_NUM_0, UART_WAKE_EDGES);
+  esp_sleep_enable_uart_wakeup(UART_NUM_0);
+#endif
+}
+
+#ifdef ARDUINO_ARCH_ESP32
+void powerSleep(uint32_t ms)
+{
+  // Level wakeup on the opposite level. The pins' edge interrupts are off
+  // meanwhile, a level interrupt would fire for as long as the button is held.
+  for (uint8_t i = 0; i < pinCount; i++)
+  {
+    gpio_num_t pin = (gpio_num_t)pins[i];
+    gpio_intr_disable(pin);
+    gpio_wakeup_enable(pin, digitalRead(pins[i]) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+  }
+  esp_sleep_enable_timer_wakeup(ms * 1000ULL);
+  Serial.flush(); // the UART stops with the clocks
+
+  int64_t start = esp_timer_get_time();
+  esp_light_sleep_start();
+  asleepMs += (esp_timer_get_time() - start) / 1000;
+  wakeups++;
+
+  for (uint8_t i = 0; i < pinCount; i++)
+  {
+    gpio_num_t pin = (gpio_num_t)pins[i];
+    gpio_wakeup_disable(pin);
+    gpio_set_intr_type(pin, GPIO_INTR_ANYEDGE);
+    gpio_intr_enable(pin);
+  }
+  if (pinWakeCallback && esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO)
+    pinWakeCallback();
+}
+
+void powerAwake()
+{
+}
+#else
+void powerSleep(uint32_t)
+{
+  booked = true;
+  bookedAt = millis();
+}
+
+void powerAwake()
+{
+  if (!booked)
+    return;
+  booked = false;
+  asleepMs += millis() - bookedAt;
+  wakeups++;
+}
+#endif
+
+PowerStats powerStats()
+{
+  PowerStats stats;
+  stats.asleepMs = asleepMs;
+  stats.awakeMs = millis() - asleepMs;
+  stats.wakeups = wakeups;
+  return stats;
+}
+
+void powerReport()
+{
+  PowerStats now = powerStats();
+  uint64_t awake = now.awakeMs - reported.awakeMs;
+  uint64_t asleep = now.asleepMs - reported.asleepMs;
+  uint32_t woken = now.wakeups - reported.wakeups;
+  reported = now;
+  if (!awake && !asleep)
+    return;
+
+  Serial.print("💤 Awake ");
+  Serial.print(awake * 100.0 / (awake + asleep), 2);
+  Serial.print("% of the time, ");
+  Serial.print(woken);
+  Serial.println(" wakeups");
+}
@@ -0,0 +1,107 @@
+#include <Arduino.h>
+#include "probes.h"
+
+static const char *const PROBE_NAMES[PROBE_COUNT] = {"control", "buttons", "sensor",  "regulation", "service",
+                                                     "wifi",    "lcd",     "journal", "history",    "telemetry"};
+
+static ProbeStats probes[PROBE_COUNT];
+
+#ifndef PROBES_DISABLED
+void probeRecord(ProbeId id, uint32_t ns)
+{
+  ProbeStats &probe = probes[id];
+  probe.count++;
+  probe.totalNs += ns;
+  if (ns > probe.maxNs)
+    probe.maxNs = ns;
+  probe.bins[ns > 1 ? 31 - __builtin_clz(ns) : 0]++;
+}
+#endif
+
+uint32_t probePercentile(ProbeId id, float percent)
+{
+  const ProbeStats &probe = probes[id];
+  if (!probe.count)
+    return 0;
+
+  uint32_t wanted = ceilf(probe.count * percent / 100);
+  uint32_t seen = 0;
+  for (uint8_t bin = 0; bin < PROBE_BINS; bin++)
+  {
+    seen += probe.bins[bin];
+    if (seen >= wanted)
+    {
+      uint32_t edge = bin < 31 ? 2u << bin : UINT32_MAX;
+      return edge < probe.maxNs ? edge : probe.maxNs;
+    }
+  }
+  return probe.maxNs;
+}
+
+/** Prints a duration with a unit that keeps it at 4 digits at most. */
+static void printDuration(uint32_t ns)
+{
+  if (ns < 10000)
+  {
+    Serial.print(ns);
+    Serial.print("ns");
+  }
+  else if (ns < 10000000)
+  {
+    Serial.print(ns / 1000);
+    Serial.print("us");
+  }
+  else
+  {
+    Serial.print(ns / 1000000);
+    Serial.print("ms");
+  }
+}
+
+void probesDump()
+{
+#ifdef PROBES_DISABLED
+  Serial.println("📊 Probes are compiled out of this build");
+#else
+  Serial.println("📊 Probes, histogram bins as <upper edge:runs");
+  for (uint8_t i = 0; i < PROBE_COUNT; i++)
+  {
+    const ProbeStats &probe = probes[i];
+    if (!probe.count)
+      continue;
+
+    Serial.print("   ");
+    Serial.print(PROBE_NAMES[i]);
+    Serial.print(": ");
+    Serial.print(probe.count);
+    Serial.print(" runs, mean ");
+    printDuration(probe.totalNs / probe.count);
+    Serial.print(", p99 ");
+    printDuration(probePercentile((ProbeId)i, 99));
+    Serial.print(", max ");
+    printDuration(probe.maxNs);
+    Serial.println();
+
+    Serial.print("    ");
+    for (uint8_t bin = 0; bin < PROBE_BINS; bin++)
+      if (probe.bins[bin])
+      {
+        Serial.print(" <");
+        printDuration(bin < 31 ? 2u << bin : UINT32_MAX);
+        Serial.print(":");
+        Serial.print(probe.bins[bin]);
+      }
+    Serial.println();
+  }
+#endif
+}
+
+void probesReset()
+{
+  memset(probes, 0, sizeof(probes));
+}
+
+const ProbeStats &probeStats(ProbeId id)
+{
+  return probes[id];
+}
@@ -0,0 +1,97 @@
+#include <stddef.h>
+#include <string.h>
+#include "profiles.h"
+
+/** A point of a curve: the targets of `day`, moving linearly towards the next point's. */
+struct ProfilePoint
+{
+  uint8_t day;
+  float temp;
+  float humidity;
+};
+
+template <uint8_t Days>
+struct Schedule
+{
+  ProfileDay day[Days];
+};
+
+/** @return Whether `points` start on day 1, go forward and stay within `days`. */
+template <size_t N>
+constexpr bool validCurve(const ProfilePoint (&points)[N], uint8_t days)
+{
+  if (points[0].day != 1 || points[N - 1].day > days)
+    return false;
+  for (size_t i = 1; i < N; i++)
+    if (points[i].day <= points[i - 1].day)
+      return false;
+  return true;
+}
+
+/**
+ * Expands a curve into one entry per day, at compile time. Two points on
+ * consecutive days make a step, points further apart a ramp; the last
+ * point's targets hold to the end of the cycle.
+ */
+template <uint8_t Days, size_t N>
+constexpr Schedule<Days> expand(const ProfilePoint (&points)[N])
+{
+  Schedule<Days> out = {};
+  size_t p = 0;
+  for (uint8_t day = 1; day <= Days; day++)
+  {
+    while (p + 1 < N && points[p + 1].day <= day)
+      p++;
+    const ProfilePoint &from = points[p];
+    const ProfilePoint &to = p + 1 < N ? points[p + 1] : from;
+    float share = to.day == from.day ? 0 : (float)(day - from.day) / (to.day - from.day);
+    out.day[day - 1] = {from.temp + share * (to.temp - from.temp), from.humidity + share * (to.humidity - from.humidity)};
+  }
+  return out;
+}
+
+// Chicken, 21 days: turned until day 17, more humidity for the hatch
+static constexpr ProfilePoint CHICKEN_CURVE[] = {{1, 37.5f, 52.5f}, {17, 37.5f, 52.5f}, {18, 37.5f, 67.5f}};
+static_assert(validCurve(CHICKEN_CURVE, 21), "chicken curve");
+static constexpr Schedule<21> CHICKEN = expand<21>(CHICKEN_CURVE);
+
+// Duck (Pekin), 28 days: lockdown from day 25, a little cooler and much wetter
+static constexpr ProfilePoint DUCK_CURVE[] = {{1, 37.5f, 55.0f}, {24, 37.5f, 55.0f}, {25, 37.2f, 75.0f}};
+static_assert(validCurve(DUCK_CURVE, 28), "duck curve");
+static constexpr Schedule<28> DUCK = expand<28>(DUCK_CURVE);
+
+// Quail (Coturnix), 17 days: lockdown from day 15
+static constexpr ProfilePoint QUAIL_CURVE[] = {{1, 37.5f, 45.0f}, {14, 37.5f, 45.0f}, {15, 37.2f, 65.0f}};
+static_assert(validCurve(QUAIL_CURVE, 17), "quail curve");
+static constexpr Schedule<17> QUAIL = expand<17>(QUAIL_CURVE);
+
+// Goose, 30 days: temperature eased off and humidity raised over the
+// setting days as the embryo makes more heat, lockdown from day 27
+static constexpr ProfilePoint GOOSE_CURVE[] = {{1, 37.5f, 50.0f}, {26, 37.3f, 55.0f}, {27, 37.0f, 75.0f}};
+static_assert(validCurve(GOOSE_CURVE, 30), "goose curve");
+static constexpr Schedule<30> GOOSE = expand<30>(GOOSE_CURVE);
+
+constexpr Profile PROFILES[PROFILE_COUNT] = {
+    {"chicken", 21, 1, 17, 3, 0.3f, 2.5f, CHICKEN.day},
+    {"duck", 28, 1, 24, 4, 0.3f, 2.5f, DUCK.day},
+    {"quail", 17, 1, 14, 3, 0.3f, 2.5f, QUAIL.day},
+    {"goose", 30, 1, 26, 4, 0.3f, 2.5f, GOOSE.day},
+};
+
+static constexpr bool validProfiles()
+{
+  for (const Profile &profile : PROFILES)
+    if (!profile.turnsPerDay || 24 % profile.turnsPerDay || !profile.turnFirst ||
+        profile.turnLast < profile.turnFirst || profile.turnLast >= profile.days)
+      return false;
+  return true;
+}
+static_assert(validProfiles(), "a profile turns outside its cycle, or not a whole number of hours apart");
+
+ProfileId profileId(const char *name)
+{
+  uint8_t id = 0;
+  while (id < PROFILE_COUNT && strcmp(PROFILES[id].name, name))
+    id++;
+  return (ProfileId)id;
+}
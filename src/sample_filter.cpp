@@ -0,0 +1,124 @@
+#include <Arduino.h>
+#include "sample_filter.h"
+
+#define FILTER_MAX_REJECTS 3    // in a row, then the reading is believed
+#define FILTER_STALE 60000UL    // in ms, without a reading the window starts over
+
+// DHT22 range, the I2C parts cover it
+#define FILTER_TEMP_MIN -40.0f
+#define FILTER_TEMP_MAX 80.0f
+
+// noise of the noisiest part, a reading may always move this far
+#define FILTER_TEMP_NOISE 0.2f     // C
+#define FILTER_HUMIDITY_NOISE 1.0f // %RH
+
+/** One chamber's recent readings and filter output. */
+struct FilterSlot
+{
+  float temp[FILTER_MAX_WINDOW]; // accepted readings, a ring
+  float humidity[FILTER_MAX_WINDOW];
+  unsigned long at[FILTER_MAX_WINDOW]; // in ms
+  uint8_t head;                  // next to overwrite
+  uint8_t count;                 // 0 until the first reading
+  uint8_t rejectsInRow;
+  unsigned long acceptedAt;      // in ms, last reading accepted
+  SensorSample average;
+  uint32_t rejected;
+};
+
+static FilterConfig config = {0, 0, 0, 0};
+static FilterSlot slots[MAX_SENSORS];
+
+void filterBegin(const FilterConfig &settings)
+{
+  config = settings;
+  for (FilterSlot &slot : slots)
+    slot = {};
+}
+
+static bool plausible(const FilterSlot &slot, unsigned long now, const SensorSample &sample)
+{
+  if (!(sample.temperature >= FILTER_TEMP_MIN && sample.temperature <= FILTER_TEMP_MAX) ||
+      !(sample.humidity >= 0 && sample.humidity <= 100))
+    return false;
+  if (!slot.count)
+    return true;
+
+  uint8_t last = (slot.head + FILTER_MAX_WINDOW - 1) % FILTER_MAX_WINDOW;
+  float seconds = (now - slot.acceptedAt) / 1000.0f;
+  return (!config.maxTempRate ||
+          fabsf(sample.temperature - slot.temp[last]) <= config.maxTempRate * seconds + FILTER_TEMP_NOISE) &&
+         (!config.maxHumidityRate ||
+          fabsf(sample.humidity - slot.humidity[last]) <= config.maxHumidityRate * seconds + FILTER_HUMIDITY_NOISE);
+}
+
+/** @return The readings of `slot` taken less than `medianSeconds` before the last one, at least that one. */
+static uint8_t window(const FilterSlot &slot)
+{
+  uint8_t n = 1;
+  unsigned long span = config.medianSeconds * 1000;
+  while (n < slot.count && slot.acceptedAt - slot.at[(slot.head + FILTER_MAX_WINDOW - 1 - n) % FILTER_MAX_WINDOW] < span)
+    n++;
+  return n;
+}
+
+/** @return The middle of the last `n` values written to `ring`. */
+static float median(const float *ring, uint8_t head, uint8_t n)
+{
+  float sorted[FILTER_MAX_WINDOW];
+  for (uint8_t i = 0; i < n; i++)
+  {
+    float value = ring[(head + FILTER_MAX_WINDOW - 1 - i) % FILTER_MAX_WINDOW];
+    uint8_t j = i;
+    for (; j > 0 && sorted[j - 1] > value; j--)
+      sorted[j] = sorted[j - 1];
+    sorted[j] = value;
+  }
+  return sorted[n / 2];
+}
+
+bool filterApply(uint8_t chamber, unsigned long now, SensorSample &sample)
+{
+  if (chamber >= MAX_SENSORS)
+    return false;
+  FilterSlot &slot = slots[chamber];
+
+  if (slot.count && now - slot.acceptedAt >= FILTER_STALE)
+    slot.count = 0;
+  if (!plausible(slot, now, sample))
+  {
+    slot.rejected++;
+    if (++slot.rejectsInRow < FILTER_MAX_REJECTS)
+      return false;
+    slot.count = 0; // the chamber really is there now
+  }
+  slot.rejectsInRow = 0;
+
+  float seconds = (now - slot.acceptedAt) / 1000.0f;
+  bool first = !slot.count;
+  slot.temp[slot.head] = sample.temperature;
+  slot.humidity[slot.head] = sample.humidity;
+  slot.at[slot.head] = now;
+  slot.head = (slot.head + 1) % FILTER_MAX_WINDOW;
+  if (slot.count < FILTER_MAX_WINDOW)
+    slot.count++;
+  slot.acceptedAt = now;
+
+  uint8_t n = window(slot);
+  SensorSample middle = {median(slot.temp, slot.head, n), median(slot.humidity, slot.head, n)};
+  if (first || !config.emaSeconds)
+    slot.average = middle;
+  else
+  {
+    float weight = seconds / (config.emaSeconds + seconds);
+    slot.average.temperature += weight * (middle.temperature - slot.average.temperature);
+    slot.average.humidity += weight * (middle.humidity - slot.average.humidity);
+  }
+  sample = slot.average;
+  return true;
+}
+
+uint32_t filterRejected(uint8_t chamber)
+{
+  return chamber < MAX_SENSORS ? slots[chamber].rejected : 0;
+}
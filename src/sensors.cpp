@@ -0,0 +1,203 @@
+#include <Arduino.h>
+#include "sensors.h"
+#include "dht_reader.h"
+#include "i2c_sensors.h"
+
+static_assert(MAX_SENSORS <= DHT_MAX_SENSORS, "every sensor may be a DHT22");
+
+#define DHT22_PERIOD 10000    // in ms, the part needs 2 s between conversions and self-heats at that rate
+#define DHT22_FRAME_WAIT 8    // in ms, start pulse + reply window, the frame interrupt is usually first
+#define I2C_SENSOR_PERIOD 1000 // in ms
+
+/** A configured sensor and its conversion in flight. */
+struct SensorSlot
+{
+  SensorType type;
+  uint8_t pinOrAddress;
+  bool configured;            // calibration read, for the parts that need one
+  bool converting;
+  unsigned long startedAt;    // in ms
+  unsigned long errors;
+  Bme280Calibration calibration;
+};
+
+/** What each type does on sensorBegin(), sensorStart() and sensorPoll(). */
+struct SensorDriver
+{
+  const char *name;
+  uint16_t period;         // in ms
+  uint16_t conversionTime; // in ms
+  uint8_t address;         // default I2C address, 0 for a sensor on its own pin
+  void (*begin)(uint8_t sensor, SensorSlot &slot);
+  bool (*start)(uint8_t sensor, SensorSlot &slot);
+  SensorStatus (*collect)(uint8_t sensor, SensorSlot &slot, SensorSample &out);
+};
+
+static SensorSlot slots[MAX_SENSORS];
+static uint8_t slotCount = 0;
+
+static void dhtSlotBegin(uint8_t sensor, SensorSlot &slot)
+{
+  dhtBegin(sensor, slot.pinOrAddress);
+}
+
+static bool dhtSlotStart(uint8_t sensor, SensorSlot &)
+{
+  return dhtStart(sensor);
+}
+
+static SensorStatus dhtSlotCollect(uint8_t sensor, SensorSlot &, SensorSample &out)
+{
+  DhtSample sample;
+  switch (dhtPoll(sensor, sample))
+  {
+  case DHT_IDLE:
+    return SENSOR_IDLE;
+  case DHT_PENDING:
+    return SENSOR_PENDING;
+  case DHT_OK:
+    out.temperature = sample.temperature;
+    out.humidity = sample.humidity;
+    return SENSOR_OK;
+  default:
+    return SENSOR_FAILED;
+  }
+}
+
+static void busSlotBegin(uint8_t, SensorSlot &)
+{
+}
+
+static bool sht3xSlotStart(uint8_t, SensorSlot &slot)
+{
+  return sht3xStart(slot.pinOrAddress);
+}
+
+static bool sht4xSlotStart(uint8_t, SensorSlot &slot)
+{
+  return sht4xStart(slot.pinOrAddress);
+}
+
+static bool bme280SlotStart(uint8_t, SensorSlot &slot)
+{
+  if (!slot.configured)
+    slot.configured = bme280Begin(slot.pinOrAddress, slot.calibration);
+  return slot.configured && bme280Start(slot.pinOrAddress);
+}
+
+static SensorStatus sht3xSlotCollect(uint8_t, SensorSlot &slot, SensorSample &out)
+{
+  uint8_t frame[SHT_FRAME_LENGTH];
+  return shtRead(slot.pinOrAddress, frame) && sht3xDecode(frame, out) ? SENSOR_OK : SENSOR_FAILED;
+}
+
+static SensorStatus sht4xSlotCollect(uint8_t, SensorSlot &slot, SensorSample &out)
+{
+  uint8_t frame[SHT_FRAME_LENGTH];
+  return shtRead(slot.pinOrAddress, frame) && sht4xDecode(frame, out) ? SENSOR_OK : SENSOR_FAILED;
+}
+
+static SensorStatus bme280SlotCollect(uint8_t, SensorSlot &slot, SensorSample &out)
+{
+  uint8_t frame[BME280_FRAME_LENGTH];
+  if (bme280Read(slot.pinOrAddress, frame) && bme280Decode(frame, slot.calibration, out))
+    return SENSOR_OK;
+  slot.configured = false; // replaced or reset, calibrate again
+  return SENSOR_FAILED;
+}
+
+static const SensorDriver drivers[SENSOR_TYPE_COUNT] = {
+    {"dht22", DHT22_PERIOD, DHT22_FRAME_WAIT, 0, dhtSlotBegin, dhtSlotStart, dhtSlotCollect},
+    {"sht3x", I2C_SENSOR_PERIOD, SHT3X_CONVERSION_MS, SHT3X_ADDRESS, busSlotBegin, sht3xSlotStart, sht3xSlotCollect},
+    {"sht4x", I2C_SENSOR_PERIOD, SHT4X_CONVERSION_MS, SHT4X_ADDRESS, busSlotBegin, sht4xSlotStart, sht4xSlotCollect},
+    {"bme280", I2C_SENSOR_PERIOD, BME280_CONVERSION_MS, BME280_ADDRESS, busSlotBegin, bme280SlotStart,
+     bme280SlotCollect}};
+
+SensorType sensorType(const char *name)
+{
+  uint8_t type = 0;
+  while (type < SENSOR_TYPE_COUNT && strcmp(drivers[type].name, name))
+    type++;
+  return (SensorType)type;
+}
+
+bool sensorOnBus(SensorType type)
+{
+  return drivers[type].address != 0;
+}
+
+uint8_t sensorDefaultAddress(SensorType type)
+{
+  return drivers[type].address;
+}
+
+bool sensorBegin(uint8_t sensor, SensorType type, uint8_t pinOrAddress)
+{
+  if (sensor >= MAX_SENSORS || type >= SENSOR_TYPE_COUNT)
+    return false;
+  for (uint8_t i = 0; i < slotCount; i++)
+    if (i != sensor && sensorOnBus(type) && sensorOnBus(slots[i].type) && slots[i].pinOrAddress == pinOrAddress)
+      return false;
+
+  SensorSlot &slot = slots[sensor];
+  slot = {};
+  slot.type = type;
+  slot.pinOrAddress = pinOrAddress;
+  if (sensor >= slotCount)
+    slotCount = sensor + 1;
+  drivers[type].begin(sensor, slot);
+  return true;
+}
+
+bool sensorStart(uint8_t sensor)
+{
+  if (sensor >= slotCount || slots[sensor].converting)
+    return false;
+  SensorSlot &slot = slots[sensor];
+  if (!drivers[slot.type].start(sensor, slot))
+  {
+    slot.errors++;
+    return false;
+  }
+  slot.converting = true;
+  slot.startedAt = millis();
+  return true;
+}
+
+SensorStatus sensorPoll(uint8_t sensor, SensorSample &out)
+{
+  if (sensor >= slotCount || !slots[sensor].converting)
+    return SENSOR_IDLE;
+  SensorSlot &slot = slots[sensor];
+  const SensorDriver &driver = drivers[slot.type];
+  // the bus parts are left alone until done, the DHT22 reports its frame itself
+  if (sensorOnBus(slot.type) && millis() - slot.startedAt < driver.conversionTime)
+    return SENSOR_PENDING;
+
+  SensorStatus status = driver.collect(sensor, slot, out);
+  if (status == SENSOR_PENDING)
+    return status;
+  slot.converting = false;
+  slot.errors += status != SENSOR_OK;
+  return status;
+}
+
+uint16_t sensorPeriod(uint8_t sensor)
+{
+  return sensor < slotCount ? drivers[slots[sensor].type].period : DHT22_PERIOD;
+}
+
+uint16_t sensorConversionTime(uint8_t sensor)
+{
+  return sensor < slotCount ? drivers[slots[sensor].type].conversionTime : DHT22_FRAME_WAIT;
+}
+
+const char *sensorName(uint8_t sensor)
+{
+  return sensor < slotCount ? drivers[slots[sensor].type].name : "";
+}
+
+unsigned long sensorErrors(uint8_t sensor)
+{
+  return sensor < slotCount ? slots[sensor].errors : 0;
+}
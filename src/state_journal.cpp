@@ -0,0 +1,158 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "state_journal.h"
+#include "channel.h"
+#include "probes.h"
+
+#define JOURNAL_PATH "/state.log"
+#define JOURNAL_TMP_PATH "/state.tmp"
+#define JOURNAL_MAGIC 0xA5
+#define JOURNAL_COMPACT_AT 128 // records, 1 KB
+#define PENDING_SIZE 32        // records between two journalMaintain() calls
+
+struct JournalRecord
+{
+  uint8_t magic;
+  uint8_t key;
+  uint16_t crc; // CRC-16/CCITT over magic, key and value
+  uint32_t value;
+};
+
+struct PendingRecord
+{
+  uint8_t key;
+  uint32_t value;
+};
+
+static uint32_t values[STATE_KEY_COUNT]; // as set, owned by the journalSet() caller
+static bool present[STATE_KEY_COUNT];
+static uint32_t stored[STATE_KEY_COUNT]; // as on flash, owned by journalMaintain()
+static bool storedPresent[STATE_KEY_COUNT];
+static SpscQueue<PendingRecord, PENDING_SIZE> pending;
+static uint16_t recordCount = 0;
+static bool compactionDue = false;
+
+static uint16_t crc16(const uint8_t *data, size_t len)
+{
+  uint16_t crc = 0xFFFF;
+  while (len--)
+  {
+    crc ^= (uint16_t)*data++ << 8;
+    for (uint8_t i = 0; i < 8; i++)
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+static uint16_t recordCrc(const JournalRecord &record)
+{
+  uint8_t bytes[6] = {record.magic, record.key, (uint8_t)record.value, (uint8_t)(record.value >> 8),
+                      (uint8_t)(record.value >> 16), (uint8_t)(record.value >> 24)};
+  return crc16(bytes, sizeof(bytes));
+}
+
+static bool writeRecord(File &file, StateKey key, uint32_t value)
+{
+  JournalRecord record = {JOURNAL_MAGIC, (uint8_t)key, 0, value};
+  record.crc = recordCrc(record);
+  return file.write((const uint8_t *)&record, sizeof(record)) == sizeof(record);
+}
+
+static void writePending()
+{
+  PendingRecord record;
+  if (!pending.pop(record))
+    return;
+
+  File file = LittleFS.open(JOURNAL_PATH, FILE_APPEND);
+  do
+  {
+    if (!file || !writeRecord(file, (StateKey)record.key, record.value))
+      Serial.println("❌ State journal write failed");
+    stored[record.key] = record.value;
+    storedPresent[record.key] = true;
+    recordCount++;
+  } while (pending.pop(record));
+  file.close();
+
+  if (recordCount >= JOURNAL_COMPACT_AT)
+    compactionDue = true;
+}
+
+uint16_t journalBegin()
+{
+  writePending(); // anything set before a restart of the journal
+  recordCount = 0;
+  File file = LittleFS.open(JOURNAL_PATH, FILE_READ);
+  if (!file)
+    return 0;
+
+  JournalRecord record;
+  while (file.read((uint8_t *)&record, sizeof(record)) == sizeof(record))
+  {
+    if (record.magic != JOURNAL_MAGIC || record.key == 0 || record.key >= STATE_KEY_COUNT ||
+        record.crc != recordCrc(record))
+    {
+      // torn or corrupted tail, rewrite the journal without it
+      compactionDue = true;
+      break;
+    }
+    values[record.key] = stored[record.key] = record.value;
+    present[record.key] = storedPresent[record.key] = true;
+    recordCount++;
+  }
+  file.close();
+
+  // Appending after a torn record would misalign everything that follows
+  if (compactionDue)
+    journalMaintain();
+  return recordCount;
+}
+
+uint32_t journalGet(StateKey key, uint32_t fallback)
+{
+  return present[key] ? values[key] : fallback;
+}
+
+void journalSet(StateKey key, uint32_t value)
+{
+  if (present[key] && values[key] == value)
+    return;
+
+  if (!pending.push({(uint8_t)key, value}))
+  {
+    Serial.println("❌ State journal queue full");
+    return;
+  }
+  values[key] = value;
+  present[key] = true;
+}
+
+void journalMaintain()
+{
+  PROBE(PROBE_JOURNAL);
+
+  writePending();
+  if (!compactionDue)
+    return;
+  compactionDue = false;
+
+  File file = LittleFS.open(JOURNAL_TMP_PATH, FILE_WRITE);
+  if (!file)
+    return;
+
+  uint16_t count = 0;
+  bool ok = true;
+  for (uint8_t key = 1; key < STATE_KEY_COUNT; key++)
+    if (storedPresent[key])
+    {
+      ok = ok && writeRecord(file, (StateKey)key, stored[key]);
+      count++;
+    }
+  file.close();
+
+  if (ok && LittleFS.rename(JOURNAL_TMP_PATH, JOURNAL_PATH))
+    recordCount = count;
+  else
+    Serial.println("❌ State journal compaction failed");
+}
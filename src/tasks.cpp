@@ -0,0 +1,240 @@
+#include <Arduino.h>
+#include <atomic>
+#include "tasks.h"
+#include "power.h"
+#include "lcd_manager.h"
+
+#define MAX_WAIT 1000        // in ms, longest a step may ask to be left alone
+#define LIGHT_SLEEP_MIN 10   // in ms, shorter idle times are not worth the wakeup
+#define CONTROL_STACK 4096   // in bytes
+#define SERVICE_STACK 8192   // in bytes, LittleFS and WiFi calls are stack hungry
+#define CONTROL_PRIORITY 10  // above every other application task
+#define SERVICE_PRIORITY 2
+#define STEP_STALL_REPORT 500000 // in us
+
+struct TaskSlot
+{
+  TaskStep step;
+  std::atomic<uint32_t> busyMicros{0};
+  std::atomic<uint32_t> maxStepMicros{0};
+  std::atomic<unsigned long> nextRun{0}; // in ms
+  std::atomic<bool> woken{false};        // wake requested, step not started yet
+  std::atomic<bool> busy{false};
+#ifdef ARDUINO_ARCH_ESP32
+  TaskHandle_t handle = nullptr;
+#endif
+};
+
+static TaskSlot slots[TASK_COUNT];
+static TaskStats stats[TASK_COUNT] = {{"control", 1, 0, 0, 0}, {"service", 0, 0, 0, 0}};
+static unsigned long windowStart = 0; // in ms
+static std::atomic<bool> sleepAllowed{true};
+
+/** @return ms the step asked to wait. */
+static uint32_t runStep(TaskId task)
+{
+  TaskSlot &slot = slots[task];
+  if (!slot.step)
+    return MAX_WAIT;
+
+  slot.busy = true;
+  slot.woken = false;
+  unsigned long start = micros();
+  uint32_t wait = slot.step();
+  uint32_t took = micros() - start;
+  if (wait > MAX_WAIT)
+    wait = MAX_WAIT;
+  slot.nextRun = millis() + wait;
+  slot.busy = false;
+
+  slot.busyMicros += took;
+  if (took > slot.maxStepMicros)
+  {
+    slot.maxStepMicros = took;
+    if (took >= STEP_STALL_REPORT)
+    {
+      Serial.print("⚠️ Slowest ");
+      Serial.print(stats[task].name);
+      Serial.print(" step so far: ");
+      Serial.print(took / 1000);
+      Serial.println(" ms");
+    }
+  }
+  return wait;
+}
+
+static bool due(TaskId task, unsigned long now)
+{
+  return slots[task].woken || (long)(now - slots[task].nextRun) >= 0;
+}
+
+/** @return ms until any step needs to run, 0 if one does or sleep is off. */
+static uint32_t idleFor(unsigned long now)
+{
+  if (!sleepAllowed)
+    return 0;
+  uint32_t idle = MAX_WAIT;
+  for (uint8_t i = 0; i < TASK_COUNT; i++)
+  {
+    if (slots[i].busy || due((TaskId)i, now))
+      return 0;
+    uint32_t left = slots[i].nextRun - now;
+    if (left < idle)
+      idle = left;
+  }
+  return idle;
+}
+
+#ifdef ARDUINO_ARCH_ESP32
+static bool running = false;
+
+static TickType_t waitTicks(uint32_t ms)
+{
+  TickType_t ticks = pdMS_TO_TICKS(ms);
+  return ticks ? ticks : 1; // never spin at this priority
+}
+
+static void controlTask(void *)
+{
+  for (;;)
+  {
+    uint32_t wait = runStep(TASK_CONTROL);
+
+    uint32_t idle = idleFor(millis());
+    if (idle >= LIGHT_SLEEP_MIN)
+    {
+      powerSleep(idle);
+      // the tick count stood still, a blocked service task would oversleep
+      if (due(TASK_SERVICE, millis()))
+        xTaskNotifyGive(slots[TASK_SERVICE].handle);
+      continue;
+    }
+    ulTaskNotifyTake(pdTRUE, waitTicks(wait));
+  }
+}
+
+static void serviceTask(void *)
+{
+  for (;;)
+  {
+    uint32_t wait = runStep(TASK_SERVICE);
+    ulTaskNotifyTake(pdTRUE, waitTicks(wait));
+  }
+}
+#endif
+
+void tasksBegin(TaskStep controlStep, TaskStep serviceStep)
+{
+  slots[TASK_CONTROL].step = controlStep;
+  slots[TASK_SERVICE].step = serviceStep;
+  windowStart = millis();
+  for (uint8_t i = 0; i < TASK_COUNT; i++)
+    slots[i].nextRun = windowStart;
+
+#ifdef ARDUINO_ARCH_ESP32
+  xTaskCreatePinnedToCore(controlTask, "control", CONTROL_STACK, nullptr, CONTROL_PRIORITY,
+                          &slots[TASK_CONTROL].handle, stats[TASK_CONTROL].core);
+  xTaskCreatePinnedToCore(serviceTask, "service", SERVICE_STACK, nullptr, SERVICE_PRIORITY,
+                          &slots[TASK_SERVICE].handle, stats[TASK_SERVICE].core);
+  running = slots[TASK_CONTROL].handle && slots[TASK_SERVICE].handle;
+  if (!running)
+    Serial.println("❌ Task creation failed, running everything from loop()");
+#endif
+}
+
+void tasksRun()
+{
+#ifdef ARDUINO_ARCH_ESP32
+  if (running)
+  {
+    vTaskDelete(NULL);
+    return;
+  }
+#endif
+  // Without tasks nothing really sleeps, the idle time is only booked so the
+  // awake share comes out as the device would see it
+  unsigned long now = millis();
+  if (!due(TASK_CONTROL, now) && !due(TASK_SERVICE, now))
+    return;
+  powerAwake();
+
+  if (due(TASK_CONTROL, now))
+    runStep(TASK_CONTROL);
+  if (due(TASK_SERVICE, millis())) // the control step may have woken it
+    runStep(TASK_SERVICE);
+
+  uint32_t idle = idleFor(millis());
+  if (idle >= LIGHT_SLEEP_MIN)
+    powerSleep(idle);
+}
+
+void tasksWake(TaskId task)
+{
+  slots[task].woken = true;
+#ifdef ARDUINO_ARCH_ESP32
+  if (slots[task].handle)
+    xTaskNotifyGive(slots[task].handle);
+#endif
+}
+
+void IRAM_ATTR tasksWakeFromISR(TaskId task)
+{
+  slots[task].woken = true;
+#ifdef ARDUINO_ARCH_ESP32
+  if (slots[task].handle)
+  {
+    BaseType_t higherPriorityWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(slots[task].handle, &higherPriorityWoken);
+    if (higherPriorityWoken)
+      portYIELD_FROM_ISR();
+  }
+#endif
+}
+
+void tasksAllowSleep(bool allowed)
+{
+  sleepAllowed = allowed;
+}
+
+void tasksReport()
+{
+  unsigned long elapsed = millis() - windowStart;
+  windowStart = millis();
+
+  for (uint8_t i = 0; i < TASK_COUNT; i++)
+  {
+    TaskStats &stat = stats[i];
+    stat.cpu = elapsed ? slots[i].busyMicros.exchange(0) / (elapsed * 10.0f) : 0;
+    stat.maxStepMicros = slots[i].maxStepMicros;
+#ifdef ARDUINO_ARCH_ESP32
+    if (slots[i].handle)
+      stat.stackFree = uxTaskGetStackHighWaterMark(slots[i].handle); // bytes on ESP-IDF
+#endif
+
+    Serial.print("📊 ");
+    Serial.print(stat.name);
+    Serial.print(": CPU ");
+    Serial.print(stat.cpu, 2);
+    Serial.print("%, worst step ");
+    Serial.print(stat.maxStepMicros / 1000.0, 1);
+    Serial.print(" ms");
+    if (stat.stackFree)
+    {
+      Serial.print(", stack free ");
+      Serial.print(stat.stackFree);
+      Serial.print(" B on core ");
+      Serial.print(stat.core);
+    }
+    Serial.println();
+  }
+  powerReport();
+
+  Serial.print("🖥️ LCD: ");
+  Serial.print(lcdBytesPerSecond());
+  Serial.println(" bytes/s over I2C");
+}
+
+const TaskStats &taskStats(TaskId task)
+{
+  return stats[task];
+}
@@ -0,0 +1,775 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include "telemetry_server.h"
+#include "json_writer.h"
+#include "history.h"
+#include "profiles.h"
+#include "alarm_manager.h"
+#include "turner.h"
+
+#define TELEMETRY_MAX_CLIENTS 8
+#define TELEMETRY_REQUEST_MAX 512  // request head, or one incoming WebSocket frame
+#define TELEMETRY_TX_BUFFER 1536  // the state of 8 chambers at their longest
+#define TELEMETRY_BACKLOG 4
+#define TELEMETRY_IDLE_TIMEOUT 5000  // in ms, for requests that never complete
+#define TELEMETRY_SEND_TIMEOUT 1000  // in ms, a client that slow is dropped
+#define TELEMETRY_LISTEN_RETRY 5000  // in ms
+#define HISTORY_DEFAULT_SPAN 86400   // in s, /api/history without `from`
+#define HISTORY_MAX_ENTRIES 1024     // per /api/history answer, about 45 KB; the rest is asked for from `next`
+#define HISTORY_SEND_BUDGET 1000     // in ms, per /api/history answer, as for a client too slow
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define WS_OPCODE_TEXT 0x1
+#define WS_OPCODE_CLOSE 0x8
+#define WS_OPCODE_PING 0x9
+#define WS_OPCODE_PONG 0xA
+
+enum ClientKind : uint8_t
+{
+  CLIENT_FREE,
+  CLIENT_HTTP,     // reading the request head
+  CLIENT_WEBSOCKET // upgraded, receives state frames
+};
+
+struct Client
+{
+  int fd;
+  ClientKind kind;
+  uint16_t received;
+  unsigned long openedAt; // in ms
+  char data[TELEMETRY_REQUEST_MAX];
+};
+
+static Client clients[TELEMETRY_MAX_CLIENTS];
+static char tx[TELEMETRY_TX_BUFFER]; // shared, the service task serves one client at a time
+static int listener = -1;
+static uint16_t port = 0;
+static bool enabled = false;
+static unsigned long listenFailedAt = 0; // in ms
+static uint32_t pushedSequence = 0;
+static TelemetryStats stats = {};
+
+static const char PAGE[] =
+    "<!doctype html><meta name=viewport content='width=device-width'><title>Incubator</title>"
+    "<pre id=s>connecting...</pre><script>"
+    "const s=document.getElementById('s');"
+    "function c(){const w=new WebSocket('ws://'+location.host+'/ws');"
+    "w.onmessage=e=>{const d=JSON.parse(e.data);"
+    "s.textContent=`Temperature ${d.temp} / ${d.target} C\\nHumidity ${d.humidity} %RH\\n`+"
+    "`Heater ${d.heater?'on':'off'}, humidifier ${d.humidifier?'on':'off'}${d.paused?' (paused)':''}\\n`+"
+    "`Day ${d.day}, next turn in ${Math.floor(d.turn_in/60)} min`};"
+    "w.onclose=()=>setTimeout(c,2000)}c()</script>";
+
+/* SHA-1 and base64, for the WebSocket handshake only */
+
+static uint32_t rotl(uint32_t value, uint8_t bits)
+{
+  return (value << bits) | (value >> (32 - bits));
+}
+
+static void sha1(const uint8_t *data, size_t length, uint8_t digest[20])
+{
+  uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+  uint64_t bits = (uint64_t)length * 8;
+  size_t blocks = (length + 8) / 64 + 1; // message, 0x80, padding, 64-bit length
+
+  for (size_t block = 0; block < blocks; block++)
+  {
+    uint32_t w[80];
+    for (uint8_t i = 0; i < 64; i++)
+    {
+      size_t at = block * 64 + i;
+      uint8_t byte;
+      if (at < length)
+        byte = data[at];
+      else if (at == length)
+        byte = 0x80;
+      else if (block == blocks - 1 && i >= 56)
+        byte = bits >> (8 * (63 - i));
+      else
+        byte = 0;
+      if (i % 4 == 0)
+        w[i / 4] = 0;
+      w[i / 4] |= (uint32_t)byte << (8 * (3 - i % 4));
+    }
+    for (uint8_t i = 16; i < 80; i++)
+      w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (uint8_t i = 0; i < 80; i++)
+    {
+      uint32_t f, k;
+      if (i < 20)
+      {
+        f = (b & c) | (~b & d);
+        k = 0x5A827999;
+      }
+      else if (i < 40)
+      {
+        f = b ^ c ^ d;
+        k = 0x6ED9EBA1;
+      }
+      else if (i < 60)
+      {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8F1BBCDC;
+      }
+      else
+      {
+        f = b ^ c ^ d;
+        k = 0xCA62C1D6;
+      }
+      uint32_t t = rotl(a, 5) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = rotl(b, 30);
+      b = a;
+      a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+  }
+
+  for (uint8_t i = 0; i < 20; i++)
+    digest[i] = h[i / 4] >> (8 * (3 - i % 4));
+}
+
+/** Writes `length` bytes as base64 plus a terminator; `out` needs 4/3 of it + 1. */
+static void base64(const uint8_t *data, size_t length, char *out)
+{
+  static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  for (size_t i = 0; i < length; i += 3)
+  {
+    uint32_t group = (uint32_t)data[i] << 16;
+    if (i + 1 < length)
+      group |= data[i + 1] << 8;
+    if (i + 2 < length)
+      group |= data[i + 2];
+    *out++ = alphabet[group >> 18];
+    *out++ = alphabet[(group >> 12) & 63];
+    *out++ = i + 1 < length ? alphabet[(group >> 6) & 63] : '=';
+    *out++ = i + 2 < length ? alphabet[group & 63] : '=';
+  }
+  *out = '\0';
+}
+
+/* Sockets */
+
+static bool sendAll(int fd, const char *data, size_t length)
+{
+  while (length)
+  {
+    ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR)
+      continue;
+    if (sent <= 0)
+      return false;
+    data += sent;
+    length -= sent;
+    stats.bytesSent += sent;
+  }
+  return true;
+}
+
+static void closeClient(Client &client)
+{
+  close(client.fd);
+  client.fd = -1;
+  client.kind = CLIENT_FREE;
+}
+
+static void closeAll()
+{
+  for (Client &client : clients)
+    if (client.kind != CLIENT_FREE)
+      closeClient(client);
+  if (listener >= 0)
+    close(listener);
+  listener = -1;
+}
+
+static bool openListener()
+{
+  if (listenFailedAt && millis() - listenFailedAt < TELEMETRY_LISTEN_RETRY)
+    return false;
+
+  listener = socket(AF_INET, SOCK_STREAM, 0);
+  int on = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+  socklen_t addressLength = sizeof(address);
+  if (listener < 0 || bind(listener, (sockaddr *)&address, sizeof(address)) < 0 ||
+      listen(listener, TELEMETRY_BACKLOG) < 0 ||
+      getsockname(listener, (sockaddr *)&address, &addressLength) < 0)
+  {
+    if (!listenFailedAt)
+    {
+      Serial.print("❌ Telemetry server cannot listen on port ");
+      Serial.println(port);
+    }
+    if (listener >= 0)
+      close(listener);
+    listener = -1;
+    listenFailedAt = millis();
+    return false;
+  }
+
+  fcntl(listener, F_SETFL, fcntl(listener, F_GETFL, 0) | O_NONBLOCK);
+  port = ntohs(address.sin_port);
+  listenFailedAt = 0;
+  Serial.print("🌐 Telemetry server on port ");
+  Serial.println(port);
+  return true;
+}
+
+static void acceptClients()
+{
+  for (;;)
+  {
+    int fd = accept(listener, nullptr, nullptr);
+    if (fd < 0)
+      return;
+
+    Client *slot = nullptr;
+    for (Client &client : clients)
+      if (client.kind == CLIENT_FREE)
+      {
+        slot = &client;
+        break;
+      }
+    if (!slot)
+    {
+      static const char busy[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+      send(fd, busy, sizeof(busy) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+      close(fd);
+      stats.rejected++;
+      continue;
+    }
+
+    // blocking sends with a timeout, receives are polled with MSG_DONTWAIT
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
+    timeval timeout = {TELEMETRY_SEND_TIMEOUT / 1000, (TELEMETRY_SEND_TIMEOUT % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    slot->fd = fd;
+    slot->kind = CLIENT_HTTP;
+    slot->received = 0;
+    slot->openedAt = millis();
+  }
+}
+
+/* Responses */
+
+static bool failSink(const char *, size_t, void *)
+{
+  return false; // the document has to fit the buffer
+}
+
+/** Sends a JsonWriter buffer as one HTTP chunk. */
+static bool chunkSink(const char *data, size_t length, void *context)
+{
+  int fd = *(int *)context;
+  char head[12];
+  int headLength = snprintf(head, sizeof(head), "%x\r\n", (unsigned)length);
+  return sendAll(fd, head, headLength) && sendAll(fd, data, length) && sendAll(fd, "\r\n", 2);
+}
+
+static bool sendHead(int fd, const char *status, const char *type, long length)
+{
+  char head[192];
+  int headLength;
+  if (length >= 0)
+    headLength = snprintf(head, sizeof(head),
+                          "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %ld\r\n"
+                          "Cache-Control: no-store\r\nAccess-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n",
+                          status, type, length);
+  else
+    headLength = snprintf(head, sizeof(head),
+                          "HTTP/1.1 %s\r\nContent-Type: %s\r\nTransfer-Encoding: chunked\r\n"
+                          "Cache-Control: no-store\r\nAccess-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n",
+                          status, type);
+  return sendAll(fd, head, headLength);
+}
+
+static void sendError(int fd, const char *status)
+{
+  if (sendHead(fd, status, "text/plain", strlen(status)))
+    sendAll(fd, status, strlen(status));
+}
+
+static int32_t toTenths(float value)
+{
+  return isnan(value) ? INT32_MIN : lroundf(value * 10);
+}
+
+static void writeState(JsonWriter &json, const ControlState &state, uint32_t unixTime)
+{
+  json.beginObject();
+  json.key("temp");
+  json.tenths(toTenths(state.temp));
+  json.key("humidity");
+  json.tenths(toTenths(state.humidity));
+  json.key("target");
+  json.tenths(toTenths(state.tempTarget));
+  json.key("sensor_ok");
+  json.value(state.isSensorOk);
+  json.key("heater");
+  json.value(state.heaterOn);
+  json.key("humidifier");
+  json.value(state.humidifierOn);
+  json.key("paused");
+  json.value(state.humidifierPaused);
+  json.key("day");
+  json.value((uint32_t)state.currentDay);
+  json.key("profile");
+  json.value(PROFILES[state.profile].name);
+  json.key("turn_in");
+  json.value(state.timeInSeconds);
+  json.key("started");
+  json.value(state.incubationStart);
+  json.key("rejected");
+  json.value(state.samplesRejected);
+  json.key("alarm");
+  json.value(alarmName((AlarmSource)state.alarm));
+  json.key("tray");
+  json.value(!turnerFitted() ? "none" : state.trayMoving ? "moving" : turnerSideName((TurnerSide)state.tray));
+  json.key("time");
+  if (unixTime)
+    json.value(unixTime);
+  else
+    json.null();
+
+  if (state.chamberCount > 1)
+  {
+    json.key("chambers");
+    json.beginArray();
+    for (uint8_t i = 0; i < state.chamberCount; i++)
+    {
+      ChamberMask bit = CHAMBER_BIT(i);
+      json.beginObject();
+      json.key("running");
+      json.value((state.chamberRunning & bit) != 0);
+      json.key("temp");
+      json.tenths(state.chamberTemp[i] == INT16_MIN ? INT32_MIN : state.chamberTemp[i]);
+      json.key("humidity");
+      json.tenths(state.chamberHumidity[i] == INT16_MIN ? INT32_MIN : state.chamberHumidity[i]);
+      json.key("sensor_ok");
+      json.value((state.chamberSensorOk & bit) != 0);
+      json.key("heater");
+      json.value((state.chamberHeater & bit) != 0);
+      json.key("humidifier");
+      json.value((state.chamberHumidifier & bit) != 0);
+      json.key("day");
+      json.value((uint32_t)state.chamberDay[i]);
+      json.key("rejected");
+      json.value(state.chamberRejected[i]);
+      json.endObject();
+    }
+    json.endArray();
+  }
+  json.endObject();
+}
+
+/** @return Length of the state document in `out`, 0 if it did not fit. */
+static size_t stateDocument(char *out, size_t size, const ControlState &state, uint32_t unixTime)
+{
+  JsonWriter json(out, size, failSink, nullptr);
+  writeState(json, state, unixTime);
+  return json.ok() ? json.written() : 0;
+}
+
+/** An /api/history answer being written. */
+struct HistoryReply
+{
+  JsonWriter &json;
+  unsigned long startedAt; // in ms
+  uint32_t entries;
+  uint32_t last; // time of the last entry written
+  uint32_t next; // time of the first entry left out, 0 when complete
+};
+
+static bool writeHistoryEntry(const HistoryEntry &entry, void *context)
+{
+  HistoryReply &reply = *(HistoryReply *)context;
+  // cut short between two seconds only, so that asking from `next` repeats nothing
+  if (reply.entries && entry.time != reply.last &&
+      (reply.entries >= HISTORY_MAX_ENTRIES || millis() - reply.startedAt >= HISTORY_SEND_BUDGET))
+  {
+    reply.next = entry.time;
+    return false;
+  }
+  reply.entries++;
+  reply.last = entry.time;
+
+  JsonWriter &json = reply.json;
+  json.beginObject();
+  json.key("t");
+  json.value(entry.time);
+  if (entry.kind == HISTORY_SAMPLE)
+  {
+    json.key("temp");
+    json.tenths(entry.temp);
+    json.key("humidity");
+    json.tenths(entry.humidity);
+  }
+  else
+  {
+    json.key("heater");
+    json.value((entry.state & HISTORY_HEATER) != 0);
+    json.key("humidifier");
+    json.value((entry.state & HISTORY_HUMIDIFIER) != 0);
+  }
+  json.endObject();
+  return json.ok();
+}
+
+/** @return The unsigned value of `name=` in the query string, or `fallback`. */
+static uint32_t queryValue(const char *query, const char *name, uint32_t fallback)
+{
+  size_t nameLength = strlen(name);
+  for (const char *at = query; at && *at; at = strchr(at, '&'))
+  {
+    if (*at == '&')
+      at++;
+    if (!strncmp(at, name, nameLength) && at[nameLength] == '=')
+      return strtoul(at + nameLength + 1, nullptr, 10);
+  }
+  return fallback;
+}
+
+static void sendHistory(int fd, const char *query, uint32_t unixTime)
+{
+  uint32_t to = queryValue(query, "to", unixTime ? unixTime : UINT32_MAX);
+  uint32_t from = queryValue(query, "from", to > HISTORY_DEFAULT_SPAN ? to - HISTORY_DEFAULT_SPAN : 0);
+  if (!sendHead(fd, "200 OK", "application/json", -1))
+    return;
+
+  JsonWriter json(tx, sizeof(tx), chunkSink, &fd);
+  json.beginObject();
+  json.key("from");
+  json.value(from);
+  json.key("to");
+  json.value(to);
+  json.key("entries");
+  json.beginArray();
+  HistoryReply reply = {json, millis(), 0, 0, 0};
+  historyRead(from, to, writeHistoryEntry, &reply);
+  json.endArray();
+  if (reply.next)
+  {
+    json.key("next");
+    json.value(reply.next);
+  }
+  json.endObject();
+  if (json.flush())
+    sendAll(fd, "0\r\n\r\n", 5);
+}
+
+static void sendConfig(int fd)
+{
+  File file = LittleFS.open("/config.json", FILE_READ);
+  if (!file)
+  {
+    sendError(fd, "404 Not Found");
+    return;
+  }
+  if (sendHead(fd, "200 OK", "application/json", file.size()))
+  {
+    size_t length;
+    while ((length = file.read((uint8_t *)tx, sizeof(tx))) > 0)
+      if (!sendAll(fd, tx, length))
+        break;
+  }
+  file.close();
+}
+
+/** Server-to-client frame, unmasked; `payload` must not overlap the header. */
+static bool sendFrame(int fd, uint8_t opcode, const char *payload, size_t length)
+{
+  uint8_t head[4] = {(uint8_t)(0x80 | opcode)};
+  size_t headLength = 2;
+  if (length < 126)
+    head[1] = length;
+  else
+  {
+    head[1] = 126;
+    head[2] = length >> 8;
+    head[3] = length;
+    headLength = 4;
+  }
+  return sendAll(fd, (const char *)head, headLength) && sendAll(fd, payload, length);
+}
+
+static bool pushState(Client &client, const ControlState &state, uint32_t unixTime)
+{
+  size_t length = stateDocument(tx, sizeof(tx), state, unixTime);
+  if (!sendFrame(client.fd, WS_OPCODE_TEXT, tx, length))
+    return false;
+  stats.frames++;
+  return true;
+}
+
+/** @return The value of header `name`, trimmed and terminated in place, or nullptr. */
+static char *findHeader(char *head, const char *name)
+{
+  size_t nameLength = strlen(name);
+  for (char *line = strstr(head, "\r\n"); line; line = strstr(line, "\r\n"))
+  {
+    line += 2;
+    if (!strncasecmp(line, name, nameLength) && line[nameLength] == ':')
+    {
+      char *value = line + nameLength + 1;
+      while (*value == ' ')
+        value++;
+      char *end = strstr(value, "\r\n");
+      if (end)
+        *end = '\0';
+      return value;
+    }
+  }
+  return nullptr;
+}
+
+static void upgrade(Client &client, char *headers, const ControlState &state, uint32_t unixTime)
+{
+  static const char GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+  char *key = findHeader(headers, "Sec-WebSocket-Key");
+  if (!key || strlen(key) > 32)
+  {
+    sendError(client.fd, "400 Bad Request");
+    closeClient(client);
+    return;
+  }
+  if (telemetryStats().websockets >= TELEMETRY_MAX_WEBSOCKETS)
+  {
+    sendError(client.fd, "503 Service Unavailable");
+    closeClient(client);
+    stats.rejected++;
+    return;
+  }
+
+  char keyed[32 + sizeof(GUID)];
+  strcpy(keyed, key);
+  strcat(keyed, GUID);
+  uint8_t digest[20];
+  sha1((const uint8_t *)keyed, strlen(keyed), digest);
+  char accept[29];
+  base64(digest, sizeof(digest), accept);
+
+  char head[160];
+  int headLength = snprintf(head, sizeof(head),
+                            "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                            "Sec-WebSocket-Accept: %s\r\n\r\n",
+                            accept);
+  client.received = 0;
+  if (!sendAll(client.fd, head, headLength) || !pushState(client, state, unixTime))
+  {
+    closeClient(client);
+    return;
+  }
+  client.kind = CLIENT_WEBSOCKET;
+}
+
+static void answer(Client &client, const ControlState &state, uint32_t unixTime)
+{
+  // request line: METHOD SP target SP version
+  char *method = client.data;
+  char *target = strchr(method, ' ');
+  char *version = target ? strchr(target + 1, ' ') : nullptr;
+  if (!version)
+  {
+    sendError(client.fd, "400 Bad Request");
+    closeClient(client);
+    return;
+  }
+  *target++ = '\0';
+  *version++ = '\0'; // the version line ends where the headers start
+  char *query = strchr(target, '?');
+  if (query)
+    *query++ = '\0';
+
+  stats.requests++;
+  if (strcmp(method, "GET"))
+    sendError(client.fd, "405 Method Not Allowed");
+  else if (!strcmp(target, "/ws"))
+  {
+    upgrade(client, version, state, unixTime);
+    return;
+  }
+  else if (!strcmp(target, "/"))
+  {
+    if (sendHead(client.fd, "200 OK", "text/html", sizeof(PAGE) - 1))
+      sendAll(client.fd, PAGE, sizeof(PAGE) - 1);
+  }
+  else if (!strcmp(target, "/api/state"))
+  {
+    size_t length = stateDocument(tx, sizeof(tx), state, unixTime);
+    if (sendHead(client.fd, "200 OK", "application/json", length))
+      sendAll(client.fd, tx, length);
+  }
+  else if (!strcmp(target, "/api/history"))
+    sendHistory(client.fd, query, unixTime);
+  else if (!strcmp(target, "/api/config"))
+    sendConfig(client.fd);
+  else
+    sendError(client.fd, "404 Not Found");
+  closeClient(client);
+}
+
+/** Handles every complete frame a WebSocket client sent; pings and closes only. */
+static void readFrames(Client &client)
+{
+  uint8_t *data = (uint8_t *)client.data;
+  while (client.received >= 2)
+  {
+    uint8_t opcode = data[0] & 0x0F;
+    size_t length = data[1] & 0x7F;
+    size_t headLength = 2;
+    if (length == 126)
+    {
+      if (client.received < 4)
+        return;
+      length = (data[2] << 8) | data[3];
+      headLength = 4;
+    }
+    else if (length == 127)
+    {
+      closeClient(client); // nothing this large is expected
+      return;
+    }
+    bool masked = data[1] & 0x80;
+    const uint8_t *mask = data + headLength;
+    if (masked)
+      headLength += 4;
+    if (headLength + length > TELEMETRY_REQUEST_MAX)
+    {
+      closeClient(client);
+      return;
+    }
+    if (client.received < headLength + length)
+      return;
+
+    char *payload = client.data + headLength;
+    if (masked)
+      for (size_t i = 0; i < length; i++)
+        payload[i] ^= mask[i % 4];
+
+    if (opcode == WS_OPCODE_CLOSE)
+    {
+      sendFrame(client.fd, WS_OPCODE_CLOSE, payload, length < 2 ? length : 2);
+      closeClient(client);
+      return;
+    }
+    if (opcode == WS_OPCODE_PING && length < 126 && !sendFrame(client.fd, WS_OPCODE_PONG, payload, length))
+    {
+      closeClient(client);
+      return;
+    }
+
+    client.received -= headLength + length;
+    memmove(client.data, client.data + headLength + length, client.received);
+  }
+}
+
+static void serve(Client &client, const ControlState &state, uint32_t unixTime)
+{
+  size_t room = TELEMETRY_REQUEST_MAX - 1 - client.received;
+  ssize_t got = room ? recv(client.fd, client.data + client.received, room, MSG_DONTWAIT) : 0;
+  if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+  {
+    closeClient(client); // closed by the peer, or a request head that does not fit
+    return;
+  }
+  if (got > 0)
+    client.received += got;
+
+  if (client.kind == CLIENT_WEBSOCKET)
+  {
+    readFrames(client);
+    return;
+  }
+
+  client.data[client.received] = '\0';
+  if (strstr(client.data, "\r\n\r\n"))
+    answer(client, state, unixTime);
+  else if (millis() - client.openedAt >= TELEMETRY_IDLE_TIMEOUT)
+    closeClient(client);
+}
+
+void telemetryBegin(uint16_t listenPort)
+{
+  port = listenPort;
+  enabled = true;
+  for (Client &client : clients)
+  {
+    client.fd = -1;
+    client.kind = CLIENT_FREE;
+  }
+}
+
+void telemetryPoll(const ControlState &state, uint32_t sequence, bool online, uint32_t unixTime)
+{
+  if (!enabled)
+    return;
+  if (!online)
+  {
+    if (listener >= 0)
+      closeAll();
+    return;
+  }
+  if (listener < 0 && !openListener())
+    return;
+
+  acceptClients();
+  bool push = sequence != pushedSequence;
+  pushedSequence = sequence;
+  for (Client &client : clients)
+  {
+    if (client.kind != CLIENT_FREE)
+      serve(client, state, unixTime);
+    if (push && client.kind == CLIENT_WEBSOCKET && !pushState(client, state, unixTime))
+      closeClient(client);
+  }
+}
+
+uint16_t telemetryPort()
+{
+  return listener >= 0 ? port : 0;
+}
+
+TelemetryStats telemetryStats()
+{
+  TelemetryStats now = stats;
+  now.clients = now.websockets = 0;
+  for (const Client &client : clients)
+  {
+    now.clients += client.kind != CLIENT_FREE;
+    now.websockets += client.kind == CLIENT_WEBSOCKET;
+  }
+  return now;
+}
+
+size_t telemetryMemory()
+{
+  return sizeof(clients) + sizeof(tx);
+}
@@ -0,0 +1,196 @@
+#include <Arduino.h>
+#include <string.h>
+#include "thermal_model.h"
+#include "state_journal.h"
+
+#define REFERENCE_TEMP 37.0f // C, keeps the regression well conditioned
+#define HEATER_LAG 20.0f     // s, the heater element takes this long to warm up or cool down
+#define FIT_WINDOW 60000     // ms between two fit updates
+#define FORGETTING 0.995f    // per update, ~3 hours of memory
+#define FIT_LAG (FORGETTING / (1 - FORGETTING) * FIT_WINDOW / 1000) // s, how far a drifting fit trails
+#define TREND_SMOOTHING (1.0f / 240) // per update, the offset trend is averaged over about 4 hours
+#define TREND_HORIZON (FIT_LAG + 10800) // s, longest extrapolation of the offset trend
+#define COVARIANCE_LIMIT 100.0f
+#define FIT_MIN_UPDATES 60   // one hour of healthy data before the fit is trusted
+#define PERSIST_EVERY 60     // updates between two journal writes
+
+static float fallbackGain, fallbackLoss;
+
+// theta = {gain, loss, offset}, P its covariance
+static float theta[3];
+static float P[3][3];
+static uint16_t updates = 0;
+static float offsetTrend = 0; // d(offset)/dt in C/s per s, mostly the room warming up or cooling down
+static unsigned long fittedAt = 0;
+
+static bool heaterOn = false;
+static float heaterOutput = 0; // lagged heater power, 0..1
+static float estimate;
+static unsigned long advancedAt = 0;
+
+static bool windowOpen = false;
+static float windowTemp;
+static float windowHeat; // integral of heaterOutput over the window, in s
+static unsigned long windowStart;
+
+static uint32_t floatBits(float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static float bitsFloat(uint32_t bits)
+{
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static bool plausible()
+{
+  // heats with the heater on, cools with it off
+  return theta[0] > 0 && theta[2] < 0 && theta[0] + theta[2] > 0;
+}
+
+static void resetCovariance(float value)
+{
+  memset(P, 0, sizeof(P));
+  for (uint8_t i = 0; i < 3; i++)
+    P[i][i] = value;
+}
+
+static float rate(float temp, unsigned long now)
+{
+  if (!thermalModelLearned())
+    return heaterOn ? fallbackGain : -fallbackLoss;
+  float loss = theta[1] < 0 ? theta[1] : 0;
+  // The fit describes the room as it was FIT_LAG ago, and during a sensor
+  // dropout it ages further: follow the room's drift meanwhile.
+  float age = FIT_LAG + (now - fittedAt) / 1000.0f;
+  float offset = theta[2] + offsetTrend * (age < TREND_HORIZON ? age : TREND_HORIZON);
+  return theta[0] * heaterOutput + loss * (temp - REFERENCE_TEMP) + offset;
+}
+
+/** Integrates the heater lag and the estimate up to now, in steps of at most 1 s. */
+static void advance()
+{
+  unsigned long now = millis();
+  float dt = (now - advancedAt) / 1000.0f;
+  advancedAt = now;
+  while (dt > 0)
+  {
+    float step = dt < 1 ? dt : 1;
+    estimate += rate(estimate, now) * step;
+    heaterOutput += ((heaterOn ? 1.0f : 0.0f) - heaterOutput) * step / HEATER_LAG;
+    windowHeat += heaterOutput * step;
+    dt -= step;
+  }
+}
+
+static void fit(const float phi[3], float slope)
+{
+  float Pphi[3];
+  float denominator = FORGETTING;
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    Pphi[i] = P[i][0] * phi[0] + P[i][1] * phi[1] + P[i][2] * phi[2];
+    denominator += phi[i] * Pphi[i];
+  }
+
+  float error = slope - (theta[0] * phi[0] + theta[1] * phi[1] + theta[2] * phi[2]);
+  float offset = theta[2];
+  for (uint8_t i = 0; i < 3; i++)
+    theta[i] += Pphi[i] / denominator * error;
+
+  unsigned long now = millis();
+  if (updates >= FIT_MIN_UPDATES)
+    offsetTrend += ((theta[2] - offset) / ((now - fittedAt) / 1000.0f) - offsetTrend) * TREND_SMOOTHING;
+  fittedAt = now;
+
+  // P = (P - P phi phi' P / denominator) / forgetting, bounded so that
+  // directions the data stops exciting cannot wind up
+  for (uint8_t i = 0; i < 3; i++)
+    for (uint8_t j = 0; j < 3; j++)
+    {
+      P[i][j] = (P[i][j] - Pphi[i] * Pphi[j] / denominator) / FORGETTING;
+      if (i == j && P[i][j] > COVARIANCE_LIMIT)
+        P[i][j] = COVARIANCE_LIMIT;
+    }
+
+  if (updates < UINT16_MAX)
+    updates++;
+  if (updates % PERSIST_EVERY == 0 && plausible())
+  {
+    journalSet(STATE_MODEL_GAIN, floatBits(theta[0]));
+    journalSet(STATE_MODEL_LOSS, floatBits(theta[1]));
+    journalSet(STATE_MODEL_OFFSET, floatBits(theta[2]));
+  }
+}
+
+void thermalModelBegin(float gainPerSecond, float lossPerSecond, float temp)
+{
+  fallbackGain = gainPerSecond;
+  fallbackLoss = lossPerSecond;
+  estimate = temp;
+  advancedAt = millis();
+
+  theta[0] = bitsFloat(journalGet(STATE_MODEL_GAIN, 0));
+  theta[1] = bitsFloat(journalGet(STATE_MODEL_LOSS, 0));
+  theta[2] = bitsFloat(journalGet(STATE_MODEL_OFFSET, 0));
+  if (plausible())
+  {
+    // trusted right away, and still refined
+    updates = FIT_MIN_UPDATES;
+    resetCovariance(1);
+  }
+  else
+  {
+    updates = 0;
+    memset(theta, 0, sizeof(theta));
+    resetCovariance(COVARIANCE_LIMIT);
+  }
+}
+
+void thermalModelHeater(bool on)
+{
+  advance();
+  heaterOn = on;
+}
+
+void thermalModelObserve(float temp)
+{
+  advance();
+  estimate = temp;
+
+  unsigned long now = millis();
+  if (windowOpen && now - windowStart >= FIT_WINDOW)
+  {
+    float seconds = (now - windowStart) / 1000.0f;
+    // a window stretched by a sensor dropout says nothing reliable
+    if (now - windowStart < 2 * FIT_WINDOW)
+    {
+      float phi[3] = {windowHeat / seconds, (windowTemp + temp) / 2 - REFERENCE_TEMP, 1};
+      fit(phi, (temp - windowTemp) / seconds);
+    }
+    windowOpen = false;
+  }
+  if (!windowOpen)
+  {
+    windowOpen = true;
+    windowStart = now;
+    windowTemp = temp;
+    windowHeat = 0;
+  }
+}
+
+float thermalModelEstimate()
+{
+  advance();
+  return estimate;
+}
+
+bool thermalModelLearned()
+{
+  return updates >= FIT_MIN_UPDATES && plausible();
+}
@@ -1,61 +1,214 @@
 #include <Arduino.h>
+#include <esp_sntp.h>
+#include <esp_timer.h>
 #include "time_manager.h"
 #include "wifi_manager.h"
+#include "shared_state.h"
+#include "fnv1a.h"
 
 extern bool timeSynced;
-extern unsigned long lastTurnTimestamp;
-extern byte intervalHours;
-extern byte currentDay;
-extern unsigned long incubationStartTimestamp;
-extern unsigned long dayLastCheck;
-extern int timeInSeconds;
-extern unsigned long lastSyncAttempt;
 extern bool wifiConnected;
-extern bool timeSynced;
+extern bool isTimeSyncing;
+extern unsigned long lastSyncAttempt;
+extern bool wifiStayOnline;
+
+#define RETAINED_MAGIC 0x434C4B31 // "CLK1"
 
-void syncTime()
+static const uint16_t SYNC_TIMEOUT = 10000;                  // in ms
+static const int64_t DRIFT_MIN_SPAN = 6 * 3600 * 1000LL;     // in ms, anchors good to 20 ms make that 1 ppm
+static const int32_t DRIFT_MAX_PPB = 200000;                 // a crystal is within 50 ppm, more is a bad answer
+
+/** The clock as kept in RTC memory across a reset. */
+struct RetainedClock
 {
-  configTime(0, 0, "pool.ntp.org", "time.nist.gov");
-  Serial.println("Waiting for time sync...");
+  uint32_t magic;
+  uint8_t source;
+  uint64_t unixMs;
+  uint64_t uptime;
+  int32_t driftPpb;
+  uint32_t check;      // of the fields above
+  uint64_t alive;      // uptimeMillis() on the last control step
+  uint64_t aliveCheck; // ~alive
+};
 
-  struct tm timeinfo;
-  bool success = getLocalTime(&timeinfo);
-  byte attempt = 0;
-  while (!success && attempt < 20)
+static RTC_NOINIT_ATTR RetainedClock retained;
+
+static unsigned long syncStartedAt = 0; // in ms
+static time_t syncSecond = 0;          // the answer, until the next second starts
+static ServiceState published = {};
+static bool publishDue = false;
+static uint64_t driftFromUnixMs = 0; // first NTP answer of this boot
+static uint64_t driftFromUptime = 0;
+
+static uint32_t retainedCheck(const RetainedClock &clock)
+{
+  uint32_t hash = fnv1a(FNV1A_INIT, &clock.magic, sizeof(clock.magic));
+  hash = fnv1a(hash, &clock.source, sizeof(clock.source));
+  hash = fnv1a(hash, &clock.unixMs, sizeof(clock.unixMs));
+  hash = fnv1a(hash, &clock.uptime, sizeof(clock.uptime));
+  return fnv1a(hash, &clock.driftPpb, sizeof(clock.driftPpb));
+}
+
+/** @return Unix time of `clock` at `uptime`, in ms. */
+static uint64_t unixMsAt(const ServiceState &clock, uint64_t uptime)
+{
+  int64_t elapsed = (int64_t)(uptime - clock.clockUptime);
+  return clock.clockUnixMs + elapsed - elapsed * clock.clockDriftPpb / 1000000000;
+}
+
+/** Sets the clock to `unixMs` at `uptime`, for the control task and the next reset. */
+static void anchor(uint64_t unixMs, uint64_t uptime, ClockSource source)
+{
+  published.clockSource = source;
+  published.clockUnixMs = unixMs;
+  published.clockUptime = uptime;
+  published.syncCount++;
+  publishDue = true;
+
+  retained = {RETAINED_MAGIC, source, unixMs, uptime, published.clockDriftPpb, 0, uptime, ~uptime};
+  retained.check = retainedCheck(retained);
+}
+
+/** Measures the drift from the first NTP answer of this boot to this one. */
+static void measureDrift(uint64_t unixMs, uint64_t uptime)
+{
+  if (!driftFromUptime)
   {
-    delay(500);
-    attempt++;
-    success = getLocalTime(&timeinfo);
+    driftFromUnixMs = unixMs;
+    driftFromUptime = uptime;
+    return;
   }
+  int64_t span = (int64_t)(unixMs - driftFromUnixMs);
+  if (span < DRIFT_MIN_SPAN)
+    return;
+  int64_t ppb = ((int64_t)(uptime - driftFromUptime) - span) * 1000000000 / span;
+  if (ppb >= -DRIFT_MAX_PPB && ppb <= DRIFT_MAX_PPB)
+    published.clockDriftPpb = ppb;
+}
 
-  if (!success)
+uint64_t uptimeMillis()
+{
+  return esp_timer_get_time() / 1000;
+}
+
+void clockBegin(uint32_t checkpoint, int32_t driftPpb)
+{
+  if (driftPpb >= -DRIFT_MAX_PPB && driftPpb <= DRIFT_MAX_PPB)
+    published.clockDriftPpb = driftPpb;
+
+  if (retained.magic == RETAINED_MAGIC && retained.check == retainedCheck(retained) && retained.source != CLOCK_UNSET)
   {
-    Serial.println("❌ NTP sync failed. Treating as offline.");
-    timeSynced = false;
-    wifiConnected = false;
-    return;
+    // where it stopped, give or take the last control step; the uptime
+    // restarted with this boot
+    ServiceState before = {};
+    before.clockUnixMs = retained.unixMs;
+    before.clockUptime = retained.uptime;
+    before.clockDriftPpb = retained.driftPpb;
+    bool alive = retained.aliveCheck == ~retained.alive && retained.alive >= retained.uptime;
+    published.clockDriftPpb = retained.driftPpb;
+    anchor(unixMsAt(before, alive ? retained.alive : retained.uptime), 0, (ClockSource)retained.source);
+    Serial.println("🕒 Clock kept across the reset");
+  }
+  else if (checkpoint)
+  {
+    anchor(checkpoint * 1000ULL, uptimeMillis(), CLOCK_ESTIMATED);
+    Serial.println("🕒 Clock resumed from the journal, behind by the time the power was off");
   }
+  else
+    retained.magic = 0;
+}
 
-  unsigned long currentTimestamp = mktime(&timeinfo);
-  timeSynced = true;
-  Serial.println("✅ Time synced");
-  wifiDisconnect();
+void clockAlive()
+{
+  uint64_t now = uptimeMillis();
+  retained.alive = now;
+  retained.aliveCheck = ~now;
+}
+
+uint32_t clockUnix(const ServiceState &clock, uint64_t uptime)
+{
+  return clock.clockSource == CLOCK_UNSET ? 0 : unixMsAt(clock, uptime) / 1000;
+}
+
+uint32_t clockNow()
+{
+  return clockUnix(published, uptimeMillis());
+}
+
+ClockSource clockSource()
+{
+  return (ClockSource)published.clockSource;
+}
 
-  float passedHours = (currentTimestamp - lastTurnTimestamp) / 3600.0;
-  timeInSeconds = lastTurnTimestamp ? (intervalHours - fmod(passedHours, intervalHours)) * 3600 : intervalHours * 3600;
-  currentDay = incubationStartTimestamp ? ((currentTimestamp - incubationStartTimestamp) / (24 * 3600)) + 1 : 0;
-   
-  dayLastCheck = millis();
-  lastSyncAttempt = dayLastCheck;
+int32_t clockDrift()
+{
+  return published.clockDriftPpb;
 }
 
-unsigned long getUnixTimestamp()
+void startTimeSync()
 {
-  struct tm currentTime;
-  if (!getLocalTime(&currentTime))
+  configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+  Serial.println("Waiting for time sync...");
+  isTimeSyncing = true;
+  syncStartedAt = millis();
+  syncSecond = 0;
+}
+
+bool handleTimeSync()
+{
+  if (!isTimeSyncing)
+    return false;
+
+  struct tm timeinfo;
+  if (!syncSecond)
   {
-    timeSynced = false;
-    return 0;
+    if (sntp_get_sync_status() != SNTP_SYNC_STATUS_COMPLETED || !getLocalTime(&timeinfo, 0))
+    {
+      if (millis() - syncStartedAt < SYNC_TIMEOUT)
+        return false; // still waiting, check again next loop pass
+
+      isTimeSyncing = false;
+      Serial.println("❌ NTP sync failed. Treating as offline.");
+      timeSynced = false;
+      wifiConnected = false;
+      return true;
+    }
+    // the system clock holds the answer now, the radio is no longer needed
+    if (!wifiStayOnline)
+      wifiDisconnect();
+    // the time reads in whole seconds: anchoring on the start of the next
+    // one makes the clock good to a loop pass instead of up to a second
+    syncSecond = mktime(&timeinfo);
+    return false;
   }
-  return mktime(&currentTime);
-}
\ No newline at end of file
+  if (!getLocalTime(&timeinfo, 0) || mktime(&timeinfo) == syncSecond)
+    return false;
+
+  isTimeSyncing = false;
+  syncSecond = 0;
+  uint64_t unixMs = (uint64_t)mktime(&timeinfo) * 1000;
+  uint64_t uptime = uptimeMillis();
+  timeSynced = true;
+  if (published.clockSource == CLOCK_UNSET)
+    Serial.println("✅ Time synced");
+  else
+  {
+    Serial.print("✅ Time synced, the clock was off by ");
+    Serial.print((long)((int64_t)(unixMsAt(published, uptime) - unixMs)));
+    Serial.println(" ms");
+  }
+
+  measureDrift(unixMs, uptime);
+  anchor(unixMs, uptime, CLOCK_NTP);
+  lastSyncAttempt = millis();
+  return true;
+}
+
+bool publishTimeState()
+{
+  if (!publishDue)
+    return false;
+  serviceState.publish(published);
+  publishDue = false;
+  return true;
+}
@@ -0,0 +1,323 @@
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "turner.h"
+
+#define TURNER_MAX_SEGMENTS 2
+
+static const uint16_t START_STEP_HZ = 200;       // the ramp's first and last steps
+static const uint32_t SETTLE_US = 2000;          // driver wake-up and DIR setup before the first step
+static const uint32_t REVERSE_PAUSE_US = 200000; // motor off between two segments
+static const uint32_t DC_POLL_US = 2000;         // end-stop checks of a DC motor
+
+/**
+ * One run in one direction, `limit` steps (stepper) or ms (DC) at most.
+ * A run towards the end-stop ends on the switch and fails at the limit;
+ * the others end at the limit.
+ */
+struct Segment
+{
+  bool home;         // direction
+  bool untilEndStop;
+  bool leavesHome;   // the switch has to open within the first eighth of the travel
+  uint32_t limit;
+  uint32_t expect;   // steps the ramp plans for, the whole run when not stopped by the switch
+};
+
+enum Phase : uint8_t
+{
+  PHASE_START, // the motor is off, the next tick starts the segment
+  PHASE_RUN
+};
+
+static TurnerConfig config = {};
+static TurnerPins pins = {};
+static esp_timer_handle_t timer = nullptr;
+static void (*stopCallback)() = nullptr;
+
+// motion, written by the control task while stopped, then by the timer task
+static Segment segments[TURNER_MAX_SEGMENTS];
+static uint8_t segmentCount = 0;
+static uint8_t segmentAt = 0;
+static Phase phase = PHASE_START;
+static bool stepHigh = false;
+static uint32_t done = 0;      // steps, or ms for a DC motor, of the segment
+static int64_t segmentStartUs = 0;
+static int64_t motionStartUs = 0;
+static TurnerSide target = TURNER_UNKNOWN;
+static volatile bool moving = false;
+static volatile TurnerResult outcome = TURNER_IDLE;
+
+static TurnerSide side = TURNER_UNKNOWN;
+static TurnerStats stats = {};
+
+static void drive(bool on)
+{
+  if (config.motor == TURNER_STEPPER)
+    digitalWrite(pins.enable, on ? LOW : HIGH);
+  else
+    digitalWrite(pins.enable, on ? HIGH : LOW);
+}
+
+static bool endStopClosed()
+{
+  return digitalRead(pins.endStop) == LOW;
+}
+
+static void finish(bool ok)
+{
+  drive(false);
+  if (config.motor == TURNER_STEPPER)
+    digitalWrite(pins.step, LOW);
+  stepHigh = false;
+  stats.lastMoveMs = (esp_timer_get_time() - motionStartUs) / 1000;
+  if (ok)
+    stats.turns++;
+  else
+    stats.failures++;
+  outcome = ok ? TURNER_DONE : TURNER_FAILED;
+  moving = false;
+  if (stopCallback)
+    stopCallback();
+}
+
+/** Ends the segment, successfully or not, and lines up the next one. */
+static void endSegment(bool ok)
+{
+  if (!ok || ++segmentAt == segmentCount)
+  {
+    finish(ok);
+    return;
+  }
+  drive(false);
+  phase = PHASE_START;
+  esp_timer_start_once(timer, REVERSE_PAUSE_US);
+}
+
+/**
+ * @return us the level of the step pulse is held for, after `done` steps
+ * of `segment`: half a period of the trapezoidal speed profile.
+ */
+static uint32_t halfPeriod(const Segment &segment)
+{
+  uint32_t fromStart = done;
+  uint32_t toEnd = segment.expect > done ? segment.expect - done : 0;
+  uint32_t along = fromStart < toEnd ? fromStart : toEnd;
+  uint32_t ramp = config.rampSteps ? config.rampSteps : 1;
+  uint32_t hz = along >= ramp ? config.stepHz : START_STEP_HZ + (config.stepHz - START_STEP_HZ) * along / ramp;
+  return 500000 / hz;
+}
+
+/** @return whether the segment's checks still pass; ends it otherwise. */
+static bool checkEndStop(const Segment &segment, uint32_t releaseBy)
+{
+  bool closed = endStopClosed();
+  if (segment.untilEndStop && closed)
+  {
+    endSegment(true);
+    return false;
+  }
+  if (segment.leavesHome && done >= releaseBy && closed)
+  {
+    endSegment(false); // still on the switch: the tray did not move
+    return false;
+  }
+  if (done >= segment.limit)
+  {
+    endSegment(!segment.untilEndStop);
+    return false;
+  }
+  return true;
+}
+
+static void onTimer(void *)
+{
+  const Segment &segment = segments[segmentAt];
+  if (phase == PHASE_START)
+  {
+    digitalWrite(pins.dir, segment.home ? HIGH : LOW);
+    drive(true);
+    done = 0;
+    segmentStartUs = esp_timer_get_time();
+    phase = PHASE_RUN;
+    esp_timer_start_once(timer, config.motor == TURNER_STEPPER ? SETTLE_US : DC_POLL_US);
+    return;
+  }
+
+  if (config.motor == TURNER_DC)
+  {
+    done = (esp_timer_get_time() - segmentStartUs) / 1000;
+    if (checkEndStop(segment, config.travelMs / 8))
+      esp_timer_start_once(timer, DC_POLL_US);
+    return;
+  }
+
+  // stepper: the falling edge holds the level as long as the rising one
+  if (stepHigh)
+  {
+    digitalWrite(pins.step, LOW);
+    stepHigh = false;
+    esp_timer_start_once(timer, halfPeriod(segment));
+    return;
+  }
+  if (!checkEndStop(segment, config.travelSteps / 8))
+    return;
+  digitalWrite(pins.step, HIGH);
+  stepHigh = true;
+  done++;
+  stats.steps++;
+  esp_timer_start_once(timer, halfPeriod(segment));
+}
+
+/** Runs the segments lined up, towards `to`. */
+static void start(TurnerSide to)
+{
+  target = to;
+  segmentAt = 0;
+  phase = PHASE_START;
+  outcome = TURNER_BUSY;
+  moving = true;
+  motionStartUs = esp_timer_get_time();
+  esp_timer_start_once(timer, 1);
+}
+
+/** Lines up a run over `eighths` of the travel, after those already lined up. */
+static void addSegment(bool home, uint8_t eighths, bool untilEndStop)
+{
+  uint32_t travel = config.motor == TURNER_STEPPER ? config.travelSteps : config.travelMs;
+  bool fromHome = segmentCount ? segments[segmentCount - 1].untilEndStop : side == TURNER_HOME;
+  Segment &segment = segments[segmentCount++];
+  segment.home = home;
+  segment.untilEndStop = untilEndStop;
+  segment.leavesHome = !home && fromHome;
+  segment.expect = config.motor == TURNER_STEPPER ? travel * eighths / 8 : 0;
+  // the switch is looked for a quarter of the travel beyond where it should be
+  segment.limit = untilEndStop ? travel * (eighths + 2) / 8 : travel * eighths / 8;
+}
+
+void turnerBegin(const TurnerConfig &turnerConfig, const TurnerPins &turnerPins)
+{
+  config = turnerConfig;
+  pins = turnerPins;
+  if (config.motor == TURNER_NONE)
+    return;
+  if (config.stepHz < START_STEP_HZ)
+    config.stepHz = START_STEP_HZ;
+
+  pinMode(pins.dir, OUTPUT);
+  pinMode(pins.enable, OUTPUT);
+  drive(false);
+  if (config.motor == TURNER_STEPPER)
+  {
+    pinMode(pins.step, OUTPUT);
+    digitalWrite(pins.step, LOW);
+  }
+  pinMode(pins.endStop, INPUT); // GPIO 34 to 39 have no pull-up, the switch needs its own
+
+  esp_timer_create_args_t args = {};
+  args.callback = onTimer;
+  args.name = "turner";
+  esp_timer_create(&args, &timer);
+
+  side = endStopClosed() ? TURNER_HOME : TURNER_UNKNOWN;
+}
+
+bool turnerFitted()
+{
+  return config.motor != TURNER_NONE;
+}
+
+bool turnerTurn()
+{
+  if (!turnerFitted() || moving)
+    return false;
+  segmentCount = 0;
+  if (side == TURNER_HOME)
+  {
+    addSegment(false, 8, false);
+    start(TURNER_AWAY);
+  }
+  else
+  {
+    addSegment(true, side == TURNER_LEVEL ? 4 : 8, true);
+    start(TURNER_HOME);
+  }
+  return true;
+}
+
+bool turnerLevel()
+{
+  if (!turnerFitted() || moving || side == TURNER_LEVEL)
+    return false;
+  segmentCount = 0;
+  if (side == TURNER_AWAY)
+    addSegment(true, 4, false);
+  else
+  {
+    if (side == TURNER_UNKNOWN)
+      addSegment(true, 8, true);
+    addSegment(false, 4, false);
+  }
+  start(TURNER_LEVEL);
+  return true;
+}
+
+TurnerSide turnerSide()
+{
+  return moving ? target : side;
+}
+
+const char *turnerSideName(TurnerSide side)
+{
+  static const char *const NAMES[] = {"home", "away", "level", "unknown"};
+  return NAMES[side <= TURNER_UNKNOWN ? side : TURNER_UNKNOWN];
+}
+
+TurnerResult turnerPoll()
+{
+  if (moving)
+    return TURNER_BUSY;
+  TurnerResult result = outcome;
+  if (result == TURNER_DONE || result == TURNER_FAILED)
+  {
+    side = result == TURNER_DONE ? target : TURNER_UNKNOWN;
+    outcome = TURNER_IDLE;
+  }
+  return result;
+}
+
+bool turnerMoving()
+{
+  return moving;
+}
+
+void turnerOnStop(void (*onStop)())
+{
+  stopCallback = onStop;
+}
+
+TurnerStats turnerStats()
+{
+  return stats;
+}
+
+void turnerReport()
+{
+  static const char *const MOTORS[] = {"none, turned by hand", "stepper", "DC"};
+  Serial.print("🔄 Turner: ");
+  Serial.print(MOTORS[config.motor]);
+  if (!turnerFitted())
+  {
+    Serial.println();
+    return;
+  }
+  Serial.print(", tray ");
+  Serial.print(turnerSideName(turnerSide()));
+  Serial.print(moving ? " (moving)" : "");
+  Serial.print(", ");
+  Serial.print(stats.turns);
+  Serial.print(" motions, ");
+  Serial.print(stats.failures);
+  Serial.print(" failed, last took ");
+  Serial.print(stats.lastMoveMs);
+  Serial.println(" ms");
+}
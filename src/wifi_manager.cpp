@@ -1,16 +1,181 @@
 #include <WiFi.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
 #include "wifi_manager.h"
+#include "time_manager.h"
+#include "fnv1a.h"
+#ifdef ARDUINO_ARCH_ESP32
+#include <esp_netif.h>
+#include <esp_netif_net_stack.h>
+#include <lwip/dhcp.h>
+#include <lwip/prot/dhcp.h>
+#endif
 
-extern const char *ssid;
-extern const char *pwd;
 extern bool wifiConnected;
 extern bool isWifiConnecting;
 extern bool timeSynced;
 
+#define RETAINED_MAGIC 0x57494631 // "WIF1"
+
+static const uint16_t CACHED_TIMEOUT = 2000; // in ms, a known channel associates in a few hundred
+
+/** The network of the last connection, as kept in RTC memory across a reset. */
+struct RetainedNetwork
+{
+  uint32_t magic;
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+  uint32_t leasedAt; // unix time DHCP granted the IP, 0 if unknown
+  uint32_t lease;    // granted lease time (T0) in s, 0 if unknown
+  uint32_t check;    // of the fields above and the SSID
+};
+
+static RTC_NOINIT_ATTR RetainedNetwork network;
+
+static char ssid[WIFI_SSID_MAX + 1] = "";
+static char pwd[WIFI_PWD_MAX + 1] = "";
+
+static WifiPath path = WIFI_PATH_SCAN; // of the attempt in progress
+static bool leaseReused = false;
+static bool renewing = false; // a reused lease handed back to DHCP, see handleWifi()
+static unsigned long attemptStartedAt = 0; // in ms, wifiConnect()
+static unsigned long pathStartedAt = 0;    // in ms, the current path
+static bool radioOn = false;
+static unsigned long radioOnAt = 0; // in ms
+static WifiStats stats = {};
+
+static uint32_t networkCheck(const RetainedNetwork &known)
+{
+  uint32_t hash = fnv1a(FNV1A_INIT, &known.magic, sizeof(known.magic));
+  hash = fnv1a(hash, known.bssid, sizeof(known.bssid));
+  hash = fnv1a(hash, &known.channel, sizeof(known.channel));
+  hash = fnv1a(hash, &known.ip, sizeof(known.ip));
+  hash = fnv1a(hash, &known.gateway, sizeof(known.gateway));
+  hash = fnv1a(hash, &known.subnet, sizeof(known.subnet));
+  hash = fnv1a(hash, &known.dns, sizeof(known.dns));
+  hash = fnv1a(hash, &known.leasedAt, sizeof(known.leasedAt));
+  hash = fnv1a(hash, &known.lease, sizeof(known.lease));
+  return fnv1a(hash, ssid, strlen(ssid)); // another wifi.json, another network
+}
+
+static bool networkKnown()
+{
+  return network.magic == RETAINED_MAGIC && network.check == networkCheck(network);
+}
+
+/** @return The lease time (T0) DHCP granted the current link, in s, 0 if unknown or static. */
+static uint32_t grantedLease()
+{
+#ifdef ARDUINO_ARCH_ESP32
+  esp_netif_t *station = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+  struct netif *netif = station ? (struct netif *)esp_netif_get_netif_impl(station) : nullptr;
+  struct dhcp *dhcp = netif ? netif_dhcp_data(netif) : nullptr;
+  return dhcp && dhcp->state == DHCP_STATE_BOUND ? dhcp->offered_t0_lease : 0;
+#else
+  return WiFi.dhcpLeaseTime();
+#endif
+}
+
+/**
+ * @return Whether the remembered lease is past its T1, half the granted
+ * time, when a DHCP client would renew it; an unknown one always is.
+ */
+static bool leaseRenewDue()
+{
+  uint32_t now = clockNow();
+  return !network.leasedAt || !network.lease || now < network.leasedAt || now - network.leasedAt >= network.lease / 2;
+}
+
+/** Scans for the SSID and asks DHCP for an IP. */
+static void beginScan()
+{
+  path = WIFI_PATH_SCAN;
+  leaseReused = false;
+  WiFi.config(IPAddress(), IPAddress(), IPAddress()); // back to DHCP
+  WiFi.begin(ssid, pwd);
+  pathStartedAt = millis();
+}
+
+/** Joins the remembered access point on its channel, with its lease until T1. */
+static void beginCached()
+{
+  path = WIFI_PATH_CACHED;
+  leaseReused = !leaseRenewDue();
+  if (leaseReused)
+    WiFi.config(IPAddress(network.ip), IPAddress(network.gateway), IPAddress(network.subnet), IPAddress(network.dns));
+  else
+    WiFi.config(IPAddress(), IPAddress(), IPAddress());
+  WiFi.begin(ssid, pwd, network.channel, network.bssid);
+  pathStartedAt = millis();
+}
+
+/** Remembers the network just joined, for the next attempt. */
+static void rememberNetwork()
+{
+  const uint8_t *bssid = WiFi.BSSID();
+  if (!bssid)
+    return;
+  uint32_t leasedAt = leaseReused ? network.leasedAt : clockNow();
+  uint32_t lease = leaseReused ? network.lease : grantedLease();
+  network.magic = RETAINED_MAGIC;
+  memcpy(network.bssid, bssid, sizeof(network.bssid));
+  network.channel = WiFi.channel();
+  network.ip = (uint32_t)WiFi.localIP();
+  network.gateway = (uint32_t)WiFi.gatewayIP();
+  network.subnet = (uint32_t)WiFi.subnetMask();
+  network.dns = (uint32_t)WiFi.dnsIP();
+  network.leasedAt = leasedAt;
+  network.lease = lease;
+  network.check = networkCheck(network);
+}
+
+bool wifiLoadCredentials(const char *path)
+{
+  File file = LittleFS.open(path, FILE_READ);
+  if (!file)
+  {
+    Serial.println("Error opening wifi file");
+    return false;
+  }
+
+  StaticJsonDocument<192> doc; // both values at their longest
+  DeserializationError error = deserializeJson(doc, file);
+  file.close();
+  if (error != DeserializationError::Ok)
+  {
+    Serial.println("Error deserializing wifi file");
+    return false;
+  }
+
+  const char *newSsid = doc["ssid"] | "";
+  const char *newPwd = doc["pwd"] | "";
+  if (strlen(newSsid) > WIFI_SSID_MAX || strlen(newPwd) > WIFI_PWD_MAX)
+  {
+    Serial.println("❌ SSID or password in the wifi file is too long");
+    return false;
+  }
+  strcpy(ssid, newSsid);
+  strcpy(pwd, newPwd);
+  return true;
+}
+
 void wifiConnect()
 {
+  if (!radioOn)
+  {
+    radioOn = true;
+    radioOnAt = millis();
+  }
   WiFi.mode(WIFI_STA);
-  WiFi.begin(ssid, pwd);
+  attemptStartedAt = millis();
+  if (networkKnown())
+    beginCached();
+  else
+    beginScan();
   WiFi.setAutoReconnect(true);
   isWifiConnecting = true;
 }
@@ -20,18 +185,77 @@ void wifiDisconnect()
   WiFi.disconnect(true);
   WiFi.mode(WIFI_OFF);
   wifiConnected = false;
+  renewing = false;
+  if (radioOn)
+  {
+    radioOn = false;
+    stats.radioOnMs += millis() - radioOnAt;
+  }
 }
 
 void onWiFiConnected()
 {
   wifiConnected = true;
+  if (isWifiConnecting)
+  {
+    uint32_t took = millis() - attemptStartedAt;
+    stats.connects[path]++;
+    stats.connectMs[path] += took;
+    if (took > stats.maxConnectMs[path])
+      stats.maxConnectMs[path] = took;
+    if (leaseReused)
+      stats.leaseReuses++;
+    Serial.print("✅ WiFi Connected in ");
+    Serial.print(took);
+    Serial.println(path == WIFI_PATH_CACHED ? " ms, remembered network" : " ms, after a scan");
+  }
+  else
+    Serial.println("✅ WiFi Connected");
   isWifiConnecting = false;
-  Serial.println("✅ WiFi Connected");
   Serial.print("IP: ");
   Serial.println(WiFi.localIP());
+  rememberNetwork();
   timeSynced = false; // force time resync in loop();
 }
 
+void wifiForgetNetwork()
+{
+  network.magic = 0;
+}
+
+WifiStats wifiStats()
+{
+  WifiStats current = stats;
+  if (radioOn)
+    current.radioOnMs += millis() - radioOnAt;
+  return current;
+}
+
+void wifiReport()
+{
+  WifiStats current = wifiStats();
+  static const char *const PATHS[WIFI_PATH_COUNT] = {"remembered", "scan"};
+  for (uint8_t i = 0; i < WIFI_PATH_COUNT; i++)
+  {
+    Serial.print("📶 ");
+    Serial.print(PATHS[i]);
+    Serial.print(": ");
+    Serial.print(current.connects[i]);
+    Serial.print(" connects, mean ");
+    Serial.print(current.connects[i] ? current.connectMs[i] / current.connects[i] : 0);
+    Serial.print(" ms, max ");
+    Serial.print(current.maxConnectMs[i]);
+    Serial.println(" ms");
+  }
+  Serial.print("📶 ");
+  Serial.print(current.fallbacks);
+  Serial.print(" fallbacks to a scan, ");
+  Serial.print(current.leaseReuses);
+  Serial.print(" connects without DHCP, radio on for ");
+  Serial.print((uint32_t)(current.radioOnMs / 1000));
+  Serial.println(" s");
+}
+
 void handleWifi()
 {
   bool isCurrentlyConnected = (WiFi.status() == WL_CONNECTED);
@@ -39,10 +263,36 @@ void handleWifi()
   if (isCurrentlyConnected && !wifiConnected)
     onWiFiConnected();
 
+  // the access point moved, changed channel or is gone: find it again
+  if (isWifiConnecting && !isCurrentlyConnected && path == WIFI_PATH_CACHED && millis() - pathStartedAt >= CACHED_TIMEOUT)
+  {
+    Serial.println("⚠️ Remembered network did not answer, scanning");
+    stats.fallbacks++;
+    wifiForgetNetwork();
+    WiFi.disconnect();
+    beginScan();
+  }
+
+  // a link that stays up on a reused lease never talks to DHCP: hand it
+  // back at T1, as a DHCP client would renew, before the router reassigns it
+  if (wifiConnected && leaseReused && leaseRenewDue())
+  {
+    Serial.println("🔄 Renewing the reused lease over DHCP");
+    leaseReused = false;
+    renewing = true;
+    WiFi.config(IPAddress(), IPAddress(), IPAddress());
+  }
+  if (renewing && wifiConnected && grantedLease())
+  {
+    renewing = false;
+    rememberNetwork();
+  }
+
   if (!isCurrentlyConnected && wifiConnected)
   {
     Serial.println("❌ WiFi Connection Lost");
     wifiConnected = false;
     timeSynced = false;
+    renewing = false;
   }
 }
\ No newline at end of file